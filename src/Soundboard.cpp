@@ -5,19 +5,36 @@
 #include <obs-hotkey.h>
 #include <obs-module.h>
 #include <util/platform.h>
+#include <util/profiler.hpp>
 #include <util/util.hpp>
 
 #include "plugin-support.h"
 
 #include "components/SceneTree.hpp"
 #include "components/MediaControls.hpp"
+#include "dialogs/EngineStats.hpp"
 #include "dialogs/MediaEdit.hpp"
+#include "dialogs/PadEdit.hpp"
+#include "engine/AudioDecoder.hpp"
+#include "engine/BoardSnapshot.hpp"
+#include "engine/ClipCache.hpp"
+#include "engine/OfflineRender.hpp"
+#include "engine/SoundboardSource.hpp"
+#include "models/ClipStore.hpp"
 #include "models/MediaData.hpp"
 
 #include <QAction>
+#include <QCollator>
+#include <QDir>
+#include <QDirIterator>
 #include <QDockWidget>
 #include <QDragEnterEvent>
+#include <QFileDialog>
 #include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QGuiApplication>
+#include <QHash>
+#include <QInputDialog>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QMainWindow>
@@ -25,6 +42,19 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QObject>
+#include <QPainter>
+#include <QProgressDialog>
+#include <QScreen>
+#include <QSet>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <utility>
 
 #include "moc_Soundboard.cpp"
 
@@ -33,7 +63,246 @@
 #define QTStr(str) QString(obs_module_text(str))
 #define MainStr(str) QString(obs_frontend_get_locale_string(str))
 
+// State of an offline render, shared between the dialog and the render.
+struct RenderJob {
+	std::atomic<uint64_t> frames = 0;
+	std::atomic<uint64_t> totalFrames = 0;
+	std::atomic<bool> canceled = false;
+	// Set by the render task once it no longer touches the clip cache.
+	std::promise<void> done;
+	std::shared_future<void> finished = done.get_future().share();
+};
+
+// One import. The dropped files and every directory are scanned by tasks on
+// the global thread pool, then the files are inserted on the UI thread in
+// batches.
+struct FolderScan {
+	// A sound file found by the scan, with the size and modification time
+	// the watcher starts from.
+	struct File {
+		QString path;
+		qint64 size = -1;
+		qint64 modified = -1;
+	};
+
+	std::mutex mutex;
+	QList<File> files;
+	std::atomic<int> pending = 0;
+	std::atomic<int> found = 0;
+	std::atomic<bool> canceled = false;
+	// Called by the last task to finish.
+	std::function<void()> finished;
+
+	QSet<QString> names;
+	qsizetype next = 0;
+};
+
 namespace {
+// Output channels below this one are used by OBS itself.
+constexpr int minOutputChannel = 7;
+
+// How often the tiles look for sounds that started while nothing played.
+constexpr int idleProgressInterval = 100;
+
+// Files are checked once they have not changed for this long, so a file
+// that is still being written is only reloaded when it is complete.
+constexpr int fileChangeDelay = 500;
+
+// Bottom of the tile level meters.
+constexpr double minMeterDb = -60.0;
+
+int meterPercent(float peak)
+{
+	if (peak <= 0.0f)
+		return 0;
+
+	double db = 20.0 * std::log10((double)peak);
+	return (int)(std::clamp((db - minMeterDb) / -minMeterDb, 0.0, 1.0) * 100.0);
+}
+
+// Row of a sound in the list. The row keeps only what the list draws, its
+// UUID and tooltip are read from the store when something asks for them.
+class SoundItem : public QListWidgetItem {
+	uint32_t id;
+
+public:
+	SoundItem(const QString &name, uint32_t id_) : QListWidgetItem(name), id(id_) {}
+
+	QListWidgetItem *clone() const override { return new SoundItem(*this); }
+
+	QVariant data(int role) const override
+	{
+		const ClipStore &store = ClipStore::get();
+
+		if (!store.contains(id))
+			return QListWidgetItem::data(role);
+
+		switch (role) {
+		case Qt::UserRole:
+			return store.getUUID(id);
+		case MediaIdRole:
+			return id;
+		case Qt::ToolTipRole:
+			return toolTip(store);
+		default:
+			return QListWidgetItem::data(role);
+		}
+	}
+
+private:
+	QVariant toolTip(const ClipStore &store) const
+	{
+		const QString &path = store.getPath(id);
+
+		if (path.isEmpty())
+			return QVariant();
+
+		if (!QFileInfo::exists(path))
+			return QTStr("Probe.Missing").arg(path);
+
+		if (!store.isProbed(id))
+			return QVariant();
+
+		AudioProbe probe = store.getProbe(id);
+
+		if (!probe.playable)
+			return QTStr("Probe.Unplayable").arg(QT_UTF8(probe.error.c_str()));
+
+		return QTStr("Probe.Info")
+			.arg(QT_UTF8(probe.codec.c_str()), QT_UTF8(probe.container.c_str()))
+			.arg(probe.sampleRate)
+			.arg(probe.channels)
+			.arg(probe.durationMs / 1000.0, 0, 'f', 1);
+	}
+};
+
+constexpr int minBoardVoices = 32;
+constexpr int maxBoardVoices = 256;
+
+// Overlapping sounds can be retriggered while they still play, so give each
+// of them a few voices. Layer pads start one voice per layer.
+int countVoices(obs_data_array_t *array)
+{
+	int voices = 0;
+
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		OBSDataAutoRelease settings = obs_data_array_item(array, i);
+		PadType type = (PadType)obs_data_get_int(settings, "pad_type");
+
+		if (type == PadType::Layers) {
+			OBSDataArrayAutoRelease layers = obs_data_get_array(settings, "layers");
+			voices += (int)obs_data_array_count(layers);
+		} else if (obs_data_get_bool(settings, "overlap")) {
+			voices += 4;
+		} else {
+			voices++;
+		}
+	}
+
+	return std::clamp(voices, minBoardVoices, maxBoardVoices);
+}
+
+// Files inserted into the list per turn of the event loop while importing.
+constexpr qsizetype importBatchSize = 200;
+
+// Files are recognized by their contents, so a misnamed file is still
+// imported. Probing later tells whether it can actually be played.
+bool isAudioFile(const QFileInfo &info)
+{
+	return info.isFile() && sniffAudioFile(QT_TO_UTF8(info.filePath()));
+}
+
+QString getUniqueName(const QString &name, const QSet<QString> &names)
+{
+	if (!names.contains(name))
+		return name;
+
+	for (int i = 2;; i++) {
+		QString out = name + " " + QString::number(i);
+
+		if (!names.contains(out))
+			return out;
+	}
+}
+
+bool isImportable(const QFileInfo &info)
+{
+	return isAudioFile(info) && info.size() > 0;
+}
+
+FolderScan::File scannedFile(const QFileInfo &info)
+{
+	return {info.absoluteFilePath(), info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
+
+// Hands the files found by one task to the scan, the last task to finish
+// completes it.
+void finishScanTask(const std::shared_ptr<FolderScan> &scan, const QList<FolderScan::File> &files)
+{
+	{
+		std::lock_guard<std::mutex> lock(scan->mutex);
+		scan->files += files;
+	}
+
+	scan->found += (int)files.size();
+
+	if (--scan->pending == 0) {
+		std::function<void()> finished = std::move(scan->finished);
+		finished();
+	}
+}
+
+void scanDirectory(std::shared_ptr<FolderScan> scan, const QString &dir)
+{
+	// Every directory is profiled on its own, like the clip decodes.
+	ProfileScope("Soundboard::scanDirectory");
+
+	QList<FolderScan::File> files;
+	QDirIterator it(dir, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+
+	while (it.hasNext() && !scan->canceled) {
+		it.next();
+		QFileInfo info = it.fileInfo();
+
+		// Linked directories are skipped, they can point back up the tree.
+		if (info.isDir() && !info.isSymLink()) {
+			scan->pending++;
+			QThreadPool::globalInstance()->start(
+				[scan, path = info.filePath()]() { scanDirectory(scan, path); });
+		} else if (isImportable(info)) {
+			files << scannedFile(info);
+		}
+	}
+
+	finishScanTask(scan, files);
+}
+
+// Sorts the dropped paths into directories and loose files. Sniffing a file
+// reads it, which can stall on a slow drive, so this runs on the pool too.
+void scanPaths(std::shared_ptr<FolderScan> scan, const QStringList &paths)
+{
+	ProfileScope("Soundboard::scanPaths");
+
+	QList<FolderScan::File> files;
+
+	for (const QString &path : paths) {
+		if (scan->canceled)
+			break;
+
+		QFileInfo info(path);
+
+		if (info.isDir()) {
+			scan->pending++;
+			QThreadPool::globalInstance()->start(
+				[scan, dir = info.absoluteFilePath()]() { scanDirectory(scan, dir); });
+		} else if (isImportable(info)) {
+			files << scannedFile(info);
+		}
+	}
+
+	finishScanTask(scan, files);
+}
+
 QString getDefaultString(QString name = "")
 {
 	if (name.isEmpty())
@@ -79,6 +348,22 @@ void onEvent(enum obs_frontend_event event, void *data)
 		break;
 	};
 }
+
+// The render in progress, if any. It is only touched on the UI thread.
+std::weak_ptr<RenderJob> activeRender;
+
+// Cancels the render in progress and waits for its task, which uses the
+// clip cache and may outlive the dock.
+void stopRender()
+{
+	std::shared_ptr<RenderJob> job = activeRender.lock();
+
+	if (!job)
+		return;
+
+	job->canceled = true;
+	job->finished.wait();
+}
 } // namespace
 
 Soundboard::Soundboard(QWidget *parent) : QWidget(parent), ui(new Ui_Soundboard)
@@ -112,258 +397,1711 @@ Soundboard::Soundboard(QWidget *parent) : QWidget(parent), ui(new Ui_Soundboard)
 	addAction(renameMedia);
 
 	connect(ui->list->itemDelegate(), &QAbstractItemDelegate::closeEditor, this, &Soundboard::mediaNameEdited);
+
+	progressTimer.setTimerType(Qt::PreciseTimer);
+	connect(&progressTimer, &QTimer::timeout, this, &Soundboard::updateProgress);
+	progressTimer.start(idleProgressInterval);
+
+	watcher = new QFileSystemWatcher(this);
+	connect(watcher, &QFileSystemWatcher::fileChanged, this, &Soundboard::pathChanged);
+	connect(watcher, &QFileSystemWatcher::directoryChanged, this, &Soundboard::pathChanged);
+
+	changeTimer.setSingleShot(true);
+	changeTimer.setInterval(fileChangeDelay);
+	connect(&changeTimer, &QTimer::timeout, this, &Soundboard::checkChangedFiles);
+
+	boardTimer.setSingleShot(true);
+	boardTimer.setInterval(0);
+	connect(&boardTimer, &QTimer::timeout, this, &Soundboard::updateBoard);
+
+	// Sounds are not QObjects, they all report through one hub.
+	MediaSignals *mediaSignals = MediaSignals::get();
+	connect(mediaSignals, &MediaSignals::hotkeyPressed, this, &Soundboard::play);
+	connect(mediaSignals, &MediaSignals::renamed, this, &Soundboard::itemRenamed);
+	connect(mediaSignals, &MediaSignals::changed, this, [this]() { boardTimer.start(); });
+
+	auto nextSound = [](void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed) {
+		if (pressed)
+			QMetaObject::invokeMethod(static_cast<Soundboard *>(data), &Soundboard::queueNext);
+	};
+
+	auto previousSound = [](void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed) {
+		if (pressed)
+			QMetaObject::invokeMethod(static_cast<Soundboard *>(data), &Soundboard::queuePrevious);
+	};
+
+	auto clearSounds = [](void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed) {
+		if (pressed)
+			QMetaObject::invokeMethod(static_cast<Soundboard *>(data), &Soundboard::clearQueue);
+	};
+
+	nextHotkey = obs_hotkey_register_frontend("Soundboard.Next", obs_module_text("NextHotkey"), nextSound, this);
+	previousHotkey = obs_hotkey_register_frontend("Soundboard.Previous", obs_module_text("PreviousHotkey"),
+						      previousSound, this);
+	clearQueueHotkey = obs_hotkey_register_frontend("Soundboard.ClearQueue", obs_module_text("ClearQueueHotkey"),
+							clearSounds, this);
 }
 
 Soundboard::~Soundboard()
 {
+	obs_hotkey_unregister(nextHotkey);
+	obs_hotkey_unregister(previousHotkey);
+	obs_hotkey_unregister(clearQueueHotkey);
+
 	obs_frontend_remove_event_callback(onEvent, this);
 	obs_frontend_remove_save_callback(onSave, this);
+
+	stopRender();
+}
+
+MediaObj *Soundboard::getCurrentMediaObj()
+{
+	QListWidgetItem *item = ui->list->currentItem();
+
+	if (!item)
+		return nullptr;
+
+	QString uuid = item->data(Qt::UserRole).toString();
+	return MediaObj::findByUUID(uuid);
+}
+
+QListWidgetItem *Soundboard::findItem(MediaObj *obj)
+{
+	return obj ? items.value(obj->getId()) : nullptr;
+}
+
+void Soundboard::releaseClip(const QString &path, const MediaObj *ignore)
+{
+	if (MediaObj::isPathUsed(path, ignore))
+		return;
+
+	unwatchFile(path);
+
+	if (ClipCache *cache = ClipCache::get())
+		cache->remove(QT_TO_UTF8(path));
+}
+
+void Soundboard::prewarmPad(MediaObj *obj)
+{
+	ClipCache *cache = ClipCache::get();
+
+	if (!cache)
+		return;
+
+	// Decode every sound of the pad up front and keep it resident, so
+	// pressing the pad never has to wait for any of them.
+	for (const MediaLayer &layer : obj->getLayers()) {
+		if (MediaObj *media = layer.getMedia())
+			cache->acquire(QT_TO_UTF8(media->getPath()));
+	}
+}
+
+QStringList Soundboard::getSoundNames()
+{
+	QStringList names;
+
+	for (int i = 0; i < ui->list->count(); i++) {
+		QListWidgetItem *item = ui->list->item(i);
+		MediaObj *obj = MediaObj::findByUUID(item->data(Qt::UserRole).toString());
+
+		if (obj && !obj->isPad())
+			names << obj->getName();
+	}
+
+	return names;
+}
+
+void Soundboard::createSource()
+{
+	ProfileScope("Soundboard::createSource");
+
+	if (obs_obj_invalid(source)) {
+		OBSDataAutoRelease settings = getSourceSettings();
+		source = obs_source_create(SOUNDBOARD_SOURCE_ID, obs_module_text("Soundboard"), settings, nullptr);
+		obs_source_set_hidden(source, true);
+
+		ui->mediaControls->SetSource(source.Get());
+	}
+
+	createCueSource();
+	applyTempo();
+	obs_set_output_source(outputChannel, source);
+
+	for (SoundboardBus &bus : buses)
+		obs_set_output_source(bus.channel, bus.source);
+
+	boardTimer.start();
+}
+
+void Soundboard::applyTempo()
+{
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+
+	if (sbs)
+		sbs->setTempo(tempo, gridBeats);
+
+	for (SoundboardBus &bus : buses) {
+		sbs = SoundboardSource::fromSource(bus.source);
+
+		if (sbs)
+			sbs->setTempo(tempo, gridBeats);
+	}
+}
+
+obs_data_t *Soundboard::getSourceSettings()
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "max_voices", maxVoices);
+	return settings;
+}
+
+void Soundboard::createCueSource()
+{
+	if (obs_obj_invalid(cueSource)) {
+		OBSDataAutoRelease settings = getSourceSettings();
+		cueSource = obs_source_create(SOUNDBOARD_SOURCE_ID, obs_module_text("CueSource"), settings, nullptr);
+		obs_source_set_hidden(cueSource, true);
+
+		ui->cueControls->SetSource(cueSource.Get());
+	}
+
+	// The cue bus needs an output channel to stay active, monitor only
+	// keeps it out of the stream and recording.
+	obs_source_set_monitoring_type(cueSource, OBS_MONITORING_TYPE_MONITOR_ONLY);
+
+	if (cueChannel < 0 || isChannelUsed(cueChannel, cueSource))
+		cueChannel = findFreeChannel();
+
+	if (cueChannel >= 0)
+		obs_set_output_source(cueChannel, cueSource);
+}
+
+SoundboardBus *Soundboard::findBus(const QString &name)
+{
+	for (SoundboardBus &bus : buses) {
+		if (bus.name == name)
+			return &bus;
+	}
+
+	return nullptr;
+}
+
+obs_source_t *Soundboard::getBusSource(const QString &name)
+{
+	SoundboardBus *bus = name.isEmpty() ? nullptr : findBus(name);
+	return bus ? bus->source.Get() : source.Get();
+}
+
+obs_source_t *Soundboard::createBusSource(const QString &name)
+{
+	QString sourceName = QTStr("BusSource").arg(name);
+	OBSDataAutoRelease settings = getSourceSettings();
+	obs_source_t *busSource = obs_source_create(SOUNDBOARD_SOURCE_ID, QT_TO_UTF8(sourceName), settings, nullptr);
+	obs_source_set_hidden(busSource, true);
+
+	return busSource;
+}
+
+bool Soundboard::isChannelUsed(int channel, obs_source_t *ignore)
+{
+	if (channel == outputChannel && source.Get() != ignore)
+		return true;
+
+	for (SoundboardBus &bus : buses) {
+		if (bus.channel == channel && bus.source.Get() != ignore)
+			return true;
+	}
+
+	if (channel == cueChannel && cueSource.Get() != ignore)
+		return true;
+
+	// Other plugins can use output channels too, so only take a channel
+	// nobody is using.
+	OBSSourceAutoRelease current = obs_get_output_source(channel);
+	return current && current.Get() != ignore;
+}
+
+int Soundboard::findFreeChannel()
+{
+	for (int channel = MAX_CHANNELS - 1; channel >= minOutputChannel; channel--) {
+		if (!isChannelUsed(channel))
+			return channel;
+	}
+
+	return -1;
+}
+
+bool Soundboard::setChannel(int &channel, obs_source_t *busSource)
+{
+	bool ok = false;
+	int newChannel = QInputDialog::getInt(this, QTStr("OutputChannel.Title"), QTStr("OutputChannel.Text"),
+					      channel + 1, minOutputChannel + 1, MAX_CHANNELS, 1, &ok);
+
+	if (!ok || newChannel - 1 == channel)
+		return false;
+
+	newChannel--;
+
+	if (isChannelUsed(newChannel, busSource)) {
+		QMessageBox::warning(this, QTStr("ChannelUsed.Title"), QTStr("ChannelUsed.Text"));
+		return false;
+	}
+
+	obs_set_output_source(channel, nullptr);
+	channel = newChannel;
+	obs_set_output_source(channel, busSource);
+
+	return true;
+}
+
+void Soundboard::addBus()
+{
+	bool ok = false;
+	QString name = QInputDialog::getText(this, QTStr("AddBus.Title"), QTStr("AddBus.Text"), QLineEdit::Normal,
+					     QString(), &ok)
+			       .trimmed();
+
+	if (!ok)
+		return;
+
+	if (name.isEmpty()) {
+		QMessageBox::warning(this, MainStr("EmptyName.Title"), MainStr("EmptyName.Text"));
+		return;
+	}
+
+	if (findBus(name) || name == QTStr("MainBus")) {
+		QMessageBox::warning(this, MainStr("NameExists.Title"), MainStr("NameExists.Text"));
+		return;
+	}
+
+	int channel = findFreeChannel();
+
+	if (channel < 0) {
+		QMessageBox::warning(this, QTStr("ChannelUsed.Title"), QTStr("NoFreeChannel.Text"));
+		return;
+	}
+
+	SoundboardBus bus;
+	bus.name = name;
+	bus.channel = channel;
+	bus.source = createBusSource(name);
+
+	obs_set_output_source(bus.channel, bus.source);
+	buses.push_back(std::move(bus));
+
+	applyTempo();
+	boardTimer.start();
+}
+
+void Soundboard::renameBus(const QString &name)
+{
+	SoundboardBus *bus = findBus(name);
+
+	if (!bus)
+		return;
+
+	bool ok = false;
+	QString newName = QInputDialog::getText(this, MainStr("Rename"), QTStr("AddBus.Text"), QLineEdit::Normal,
+						name, &ok)
+				  .trimmed();
+
+	if (!ok || newName == name)
+		return;
+
+	if (newName.isEmpty()) {
+		QMessageBox::warning(this, MainStr("EmptyName.Title"), MainStr("EmptyName.Text"));
+		return;
+	}
+
+	if (findBus(newName) || newName == QTStr("MainBus")) {
+		QMessageBox::warning(this, MainStr("NameExists.Title"), MainStr("NameExists.Text"));
+		return;
+	}
+
+	bus->name = newName;
+	obs_source_set_name(bus->source, QT_TO_UTF8(QTStr("BusSource").arg(newName)));
+
+	for (int i = 0; i < ui->list->count(); i++) {
+		MediaObj *obj = MediaObj::findByUUID(ui->list->item(i)->data(Qt::UserRole).toString());
+
+		if (obj && obj->getBus() == name)
+			obj->setBus(newName);
+	}
 }
 
-MediaObj *Soundboard::getCurrentMediaObj()
-{
-	QListWidgetItem *item = ui->list->currentItem();
+void Soundboard::removeBus(const QString &name)
+{
+	QMessageBox::StandardButton reply = QMessageBox::question(this, MainStr("ConfirmRemove.Title"),
+								  MainStr("ConfirmRemove.Text").arg(name),
+								  QMessageBox::Yes | QMessageBox::No);
+
+	if (reply == QMessageBox::No)
+		return;
+
+	for (auto it = buses.begin(); it != buses.end(); ++it) {
+		if (it->name != name)
+			continue;
+
+		obs_set_output_source(it->channel, nullptr);
+		buses.erase(it);
+		break;
+	}
+
+	// Sounds on the removed bus go back to the main bus.
+	for (int i = 0; i < ui->list->count(); i++) {
+		MediaObj *obj = MediaObj::findByUUID(ui->list->item(i)->data(Qt::UserRole).toString());
+
+		if (obj && obj->getBus() == name)
+			obj->setBus(QString());
+	}
+
+	boardTimer.start();
+}
+
+OBSDataArray Soundboard::saveMedia()
+{
+	ProfileScope("Soundboard::saveMedia");
+
+	OBSDataArrayAutoRelease array = obs_data_array_create();
+
+	for (int i = 0; i < ui->list->count(); i++) {
+		QListWidgetItem *item = ui->list->item(i);
+		QString uuid = item->data(Qt::UserRole).toString();
+
+		MediaObj *obj = MediaObj::findByUUID(uuid);
+
+		OBSDataAutoRelease settings = obs_data_create();
+		ClipStore::get().save(obj->getId(), settings);
+
+		if (obj->isPad()) {
+			OBSDataArrayAutoRelease layers = obs_data_array_create();
+
+			for (const MediaLayer &layer : obj->getLayers()) {
+				MediaObj *media = layer.getMedia();
+
+				if (!media)
+					continue;
+
+				OBSDataAutoRelease layerData = obs_data_create();
+				obs_data_set_string(layerData, "name", QT_TO_UTF8(media->getName()));
+				obs_data_set_int(layerData, "offset", layer.offset);
+				obs_data_set_double(layerData, "gain", (double)layer.gain);
+				obs_data_array_push_back(layers, layerData);
+			}
+
+			obs_data_set_int(settings, "pad_type", (int)obj->getPadType());
+			obs_data_set_array(settings, "layers", layers);
+
+			if (obj->getPadType() == PadType::Variations) {
+				obs_data_set_int(settings, "variation_mode", (int)obj->getVariationMode());
+				obs_data_set_int(settings, "variation_index", obj->getVariationIndex());
+			}
+		}
+
+		OBSDataArrayAutoRelease hotkeyArray = obs_hotkey_save(obj->getHotkey());
+		obs_data_set_array(settings, "sound_hotkey", hotkeyArray);
+
+		obs_data_array_push_back(array, settings);
+	};
+
+	return array.Get();
+}
+
+void Soundboard::loadMedia(OBSDataArray array)
+{
+	ProfileScope("Soundboard::loadMedia");
+
+	QList<QPair<MediaObj *, OBSDataArray>> pads;
+
+	ui->list->BeginBatch();
+
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		OBSDataAutoRelease settings = obs_data_array_item(array, i);
+
+		obs_data_set_default_string(settings, "name", obs_module_text("Sound"));
+
+		QString name = obs_data_get_string(settings, "name");
+		QString path = obs_data_get_string(settings, "path");
+
+		OBSDataArrayAutoRelease hotkeyArray = obs_data_get_array(settings, "sound_hotkey");
+
+		MediaObj *obj = add(name, path);
+		obs_hotkey_load(obj->getHotkey(), hotkeyArray);
+		ClipStore::get().load(obj->getId(), settings);
+
+		PadType type = (PadType)obs_data_get_int(settings, "pad_type");
+
+		if (type == PadType::Layers || type == PadType::Variations) {
+			OBSDataArrayAutoRelease layers = obs_data_get_array(settings, "layers");
+
+			obs_data_set_default_int(settings, "variation_index", -1);
+
+			obj->setPadType(type);
+			obj->setVariationMode((VariationMode)obs_data_get_int(settings, "variation_mode"));
+			obj->setVariationIndex((int)obs_data_get_int(settings, "variation_index"));
+			pads.append({obj, layers.Get()});
+		} else {
+			probeMedia(obj, ui->list->item(ui->list->count() - 1));
+		}
+	}
+
+	ui->list->EndBatch();
+
+	// Layers refer to sounds by name, so they can only be resolved once
+	// every sound has been loaded.
+	for (auto &pad : pads) {
+		QList<MediaLayer> layers;
+
+		for (size_t i = 0; i < obs_data_array_count(pad.second); i++) {
+			OBSDataAutoRelease layerData = obs_data_array_item(pad.second, i);
+
+			obs_data_set_default_double(layerData, "gain", 1.0);
+
+			MediaObj *media = MediaObj::findByName(obs_data_get_string(layerData, "name"));
+
+			if (!media || media->isPad())
+				continue;
+
+			MediaLayer layer;
+			layer.media = media->getId();
+			layer.offset = (int)obs_data_get_int(layerData, "offset");
+			layer.gain = (float)obs_data_get_double(layerData, "gain");
+			layers.append(layer);
+		}
+
+		pad.first->setLayers(layers);
+		prewarmPad(pad.first);
+	}
+}
+
+OBSDataArray Soundboard::saveQueue()
+{
+	OBSDataArrayAutoRelease array = obs_data_array_create();
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+	qsizetype pos = sbs ? (qsizetype)sbs->getEngine().getQueuePosition() : 0;
+
+	// Only the sounds that have not been played yet are kept.
+	for (qsizetype i = pos; i < queue.size(); i++) {
+		MediaObj *obj = MediaObj::fromId(queue[i]);
+
+		if (!obj)
+			continue;
+
+		OBSDataAutoRelease item = obs_data_create();
+		obs_data_set_string(item, "name", QT_TO_UTF8(obj->getName()));
+		obs_data_array_push_back(array, item);
+	}
+
+	return array.Get();
+}
+
+void Soundboard::loadQueue(OBSDataArray array)
+{
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		OBSDataAutoRelease item = obs_data_array_item(array, i);
+		MediaObj *obj = MediaObj::findByName(obs_data_get_string(item, "name"));
+
+		if (obj)
+			enqueue(obj, false);
+	}
+}
+
+OBSDataArray Soundboard::saveBuses()
+{
+	OBSDataArrayAutoRelease array = obs_data_array_create();
+
+	for (SoundboardBus &bus : buses) {
+		OBSDataAutoRelease busData = obs_data_create();
+		OBSDataAutoRelease sourceData = obs_save_source(bus.source);
+
+		obs_data_set_string(busData, "name", QT_TO_UTF8(bus.name));
+		obs_data_set_int(busData, "channel", bus.channel);
+		obs_data_set_obj(busData, "source", sourceData);
+		obs_data_array_push_back(array, busData);
+	}
+
+	return array.Get();
+}
+
+void Soundboard::loadBuses(OBSDataArray array)
+{
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		OBSDataAutoRelease busData = obs_data_array_item(array, i);
+		OBSDataAutoRelease sourceData = obs_data_get_obj(busData, "source");
+
+		SoundboardBus bus;
+		bus.name = obs_data_get_string(busData, "name");
+		bus.channel = (int)obs_data_get_int(busData, "channel");
+
+		if (bus.name.isEmpty() || findBus(bus.name))
+			continue;
+
+		if (sourceData) {
+			OBSDataAutoRelease settings = getSourceSettings();
+			obs_data_set_obj(sourceData, "settings", settings);
+			bus.source = obs_load_source(sourceData);
+		}
+
+		if (obs_obj_invalid(bus.source))
+			bus.source = createBusSource(bus.name);
+
+		obs_source_set_hidden(bus.source, true);
+		buses.push_back(std::move(bus));
+	}
+}
+
+void Soundboard::save(OBSData saveData)
+{
+	ProfileScope("Soundboard::save");
+
+	QMainWindow *window = (QMainWindow *)obs_frontend_get_main_window();
+	QDockWidget *dock = static_cast<QDockWidget *>(parent());
+
+	OBSDataArray array = saveMedia();
+	obs_data_set_array(saveData, "soundboard_array", array);
+
+	OBSDataArray queueArray = saveQueue();
+	obs_data_set_array(saveData, "queue", queueArray);
+	obs_data_set_bool(saveData, "playlist_mode", playlistMode);
+	obs_data_set_double(saveData, "tempo", tempo);
+	obs_data_set_double(saveData, "quantize_beats", gridBeats);
+	obs_data_set_int(saveData, "output_channel", outputChannel);
+
+	OBSDataArray busArray = saveBuses();
+	obs_data_set_array(saveData, "buses", busArray);
+
+	if (!obs_obj_invalid(cueSource)) {
+		OBSDataAutoRelease cueData = obs_save_source(cueSource);
+		obs_data_set_obj(saveData, "cue_source", cueData);
+		obs_data_set_int(saveData, "cue_channel", cueChannel);
+	}
+
+	obs_data_set_bool(saveData, "preview_on_click", previewOnClick);
+
+	OBSDataArrayAutoRelease nextHotkeyArray = obs_hotkey_save(nextHotkey);
+	obs_data_set_array(saveData, "next_hotkey", nextHotkeyArray);
+
+	OBSDataArrayAutoRelease previousHotkeyArray = obs_hotkey_save(previousHotkey);
+	obs_data_set_array(saveData, "previous_hotkey", previousHotkeyArray);
+
+	OBSDataArrayAutoRelease clearQueueHotkeyArray = obs_hotkey_save(clearQueueHotkey);
+	obs_data_set_array(saveData, "clear_queue_hotkey", clearQueueHotkeyArray);
+
+	if (!obs_obj_invalid(source)) {
+		OBSDataAutoRelease sourceData = obs_save_source(source);
+		obs_data_set_obj(saveData, "soundboard_source", sourceData);
+	}
+
+	obs_data_set_bool(saveData, "dock_visible", dock->isVisible());
+	obs_data_set_bool(saveData, "dock_floating", dock->isFloating());
+	obs_data_set_string(saveData, "dock_geometry", dock->saveGeometry().toBase64().constData());
+	obs_data_set_int(saveData, "dock_area", window->dockWidgetArea(dock));
+	obs_data_set_bool(saveData, "grid_mode", ui->list->GetGridMode());
+
+	MediaObj *obj = getCurrentMediaObj();
+
+	if (obj)
+		obs_data_set_string(saveData, "current_sound", QT_TO_UTF8(obj->getName()));
+
+	obs_data_set_bool(saveData, "use_countdown", ui->mediaControls->countDownTimer);
+}
+
+void Soundboard::loadSource(OBSData saveData)
+{
+	OBSDataAutoRelease sourceData = obs_data_get_obj(saveData, "soundboard_source");
+
+	if (sourceData) {
+		// Older versions played the sounds through a media source, keep its
+		// filters and audio settings but switch it over to the soundboard
+		// source.
+		obs_data_set_string(sourceData, "id", SOUNDBOARD_SOURCE_ID);
+		obs_data_set_string(sourceData, "versioned_id", SOUNDBOARD_SOURCE_ID);
+		OBSDataAutoRelease settings = getSourceSettings();
+		obs_data_set_obj(sourceData, "settings", settings);
+		source = obs_load_source(sourceData);
+		obs_source_set_hidden(source, true);
+
+		if (obs_obj_invalid(source))
+			return;
+
+		ui->mediaControls->SetSource(source.Get());
+	}
+}
+
+void Soundboard::load(OBSData saveData)
+{
+	ProfileScope("Soundboard::load");
+
+	QMainWindow *window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
+	QDockWidget *dock = window->findChild<QDockWidget *>("SoundboardDock");
+
+	obs_data_set_default_double(saveData, "tempo", 120.0);
+	obs_data_set_default_double(saveData, "quantize_beats", 1.0);
+	tempo = obs_data_get_double(saveData, "tempo");
+	gridBeats = obs_data_get_double(saveData, "quantize_beats");
+
+	obs_data_set_default_int(saveData, "output_channel", 63);
+	outputChannel = (int)obs_data_get_int(saveData, "output_channel");
+
+	// The engine pools are sized when a source is created, so size them
+	// for the board before any source is loaded.
+	OBSDataArrayAutoRelease array = obs_data_get_array(saveData, "soundboard_array");
+	maxVoices = countVoices(array);
+
+	loadSource(saveData);
+
+	OBSDataArrayAutoRelease busArray = obs_data_get_array(saveData, "buses");
+	loadBuses(busArray.Get());
+
+	OBSDataAutoRelease cueData = obs_data_get_obj(saveData, "cue_source");
+
+	if (cueData) {
+		obs_data_set_default_int(saveData, "cue_channel", -1);
+		cueChannel = (int)obs_data_get_int(saveData, "cue_channel");
+		OBSDataAutoRelease settings = getSourceSettings();
+		obs_data_set_obj(cueData, "settings", settings);
+		cueSource = obs_load_source(cueData);
+
+		if (!obs_obj_invalid(cueSource)) {
+			obs_source_set_hidden(cueSource, true);
+			ui->cueControls->SetSource(cueSource.Get());
+		}
+	}
+
+	previewOnClick = obs_data_get_bool(saveData, "preview_on_click");
+
+	if (obs_obj_invalid(source))
+		createSource();
+	else
+		applyTempo();
+
+	loadMedia(array.Get());
+
+	OBSDataArrayAutoRelease queueArray = obs_data_get_array(saveData, "queue");
+	loadQueue(queueArray.Get());
+	playlistMode = obs_data_get_bool(saveData, "playlist_mode");
+	boardTimer.start();
+
+	OBSDataArrayAutoRelease nextHotkeyArray = obs_data_get_array(saveData, "next_hotkey");
+	obs_hotkey_load(nextHotkey, nextHotkeyArray);
+
+	OBSDataArrayAutoRelease previousHotkeyArray = obs_data_get_array(saveData, "previous_hotkey");
+	obs_hotkey_load(previousHotkey, previousHotkeyArray);
+
+	OBSDataArrayAutoRelease clearQueueHotkeyArray = obs_data_get_array(saveData, "clear_queue_hotkey");
+	obs_hotkey_load(clearQueueHotkey, clearQueueHotkeyArray);
+
+	const char *geometry = obs_data_get_string(saveData, "dock_geometry");
+
+	if (geometry && *geometry)
+		dock->restoreGeometry(QByteArray::fromBase64(QByteArray(geometry)));
+
+	const auto dockArea = static_cast<Qt::DockWidgetArea>(obs_data_get_int(saveData, "dock_area"));
+
+	if (dockArea)
+		window->addDockWidget(dockArea, dock);
+
+	bool visible = obs_data_get_bool(saveData, "dock_visible");
+	dock->setVisible(visible);
+
+	obs_data_set_default_bool(saveData, "dock_floating", true);
+	bool floating = obs_data_get_bool(saveData, "dock_floating");
+	dock->setFloating(floating);
+
+	obs_data_set_default_bool(saveData, "grid_mode", true);
+	bool grid = obs_data_get_bool(saveData, "grid_mode");
+	ui->list->SetGridMode(grid);
+
+	QString lastSound = obs_data_get_string(saveData, "current_sound");
+
+	if (!lastSound.isEmpty()) {
+		MediaObj *obj = MediaObj::findByName(lastSound);
+		QListWidgetItem *item = findItem(obj);
+
+		if (item)
+			ui->list->setCurrentItem(item);
+		else
+			ui->list->setCurrentRow(0);
+	} else {
+		ui->list->setCurrentRow(0);
+	}
+
+	bool countdown = obs_data_get_bool(saveData, "use_countdown");
+	ui->mediaControls->countDownTimer = countdown;
+}
+
+void Soundboard::clear()
+{
+	ui->mediaControls->countDownTimer = false;
+	ui->mediaControls->SetSource(nullptr);
+
+	obs_set_output_source(outputChannel, nullptr);
+	source = nullptr;
+	outputChannel = 63;
+
+	for (SoundboardBus &bus : buses)
+		obs_set_output_source(bus.channel, nullptr);
+
+	buses.clear();
+
+	ui->cueControls->SetSource(nullptr);
+
+	if (cueChannel >= 0)
+		obs_set_output_source(cueChannel, nullptr);
+
+	cueSource = nullptr;
+	cueChannel = -1;
+	previewOnClick = false;
+
+	queue.clear();
+	playlistMode = false;
+	tempo = 120.0;
+	gridBeats = 1.0;
+
+	for (int i = 0; i < ui->list->count(); i++) {
+		QListWidgetItem *item = ui->list->item(i);
+		QString uuid = item->data(Qt::UserRole).toString();
+
+		MediaObj *obj = MediaObj::findByUUID(uuid);
+		delete obj;
+		obj = nullptr;
+	}
+
+	// The names and paths of the old collection are not kept around.
+	ClipStore::get().clear();
+
+	ui->list->clear();
+	items.clear();
+	progressIds.clear();
+
+	QStringList watched = watcher->files() + watcher->directories();
+
+	if (!watched.isEmpty())
+		watcher->removePaths(watched);
+
+	watchedDirs.clear();
+	fileStamps.clear();
+	changedPaths.clear();
+	missingPaths.clear();
+	changeTimer.stop();
+
+	// Drops the references to the sources right away.
+	boardTimer.stop();
+	publishBoard(nullptr);
+
+	if (ClipCache *cache = ClipCache::get())
+		cache->clear();
+
+	updateActions();
+}
+
+void Soundboard::play(MediaObj *obj, uint64_t timestamp)
+{
+	ProfileScope("Soundboard::play");
+
+	if (playlistMode && !obj->isPad()) {
+		enqueue(obj);
+		return;
+	}
+
+	// Outside of playlist mode a hotkey only gets here if a clip the board
+	// pinned was replaced or failed. The sound is loaded below, and the
+	// board is published again with the new clip.
+	if (timestamp)
+		boardTimer.start();
+
+	// Every bus has its own source that is always running, so routing a
+	// sound only picks which engine the command is sent to.
+	SoundboardSource *sbs = SoundboardSource::fromSource(getBusSource(obj->getBus()));
+
+	if (!sbs)
+		return;
+
+	PlayOptions options;
+	options.gain = obj->getVolume();
+	options.loop = obj->loopEnabled();
+	options.mode = obj->overlapEnabled() ? TriggerMode::Overlap : TriggerMode::Replace;
+	options.timestamp = timestamp;
+	options.quantize = obj->quantizeEnabled();
+	options.tag = obj->getId();
+	// Hotkeys are timed in their callback, clicks when they get here.
+	options.triggerTime = timestamp ? timestamp : os_gettime_ns();
+
+	trigger(sbs, obj, options);
+
+	QListWidgetItem *item = findItem(obj);
+	ui->list->setCurrentItem(item);
+}
+
+void Soundboard::trigger(SoundboardSource *sbs, MediaObj *obj, PlayOptions &options)
+{
+	switch (obj->getPadType()) {
+	case PadType::Sound:
+		sbs->play(QT_TO_UTF8(obj->getPath()), options);
+		break;
+	case PadType::Layers: {
+		ClipCache *cache = ClipCache::get();
+		std::vector<SoundLayer> layers;
+
+		if (!cache)
+			break;
+
+		for (const MediaLayer &layer : obj->getLayers()) {
+			MediaObj *media = layer.getMedia();
+
+			if (media)
+				layers.push_back({cache->acquire(QT_TO_UTF8(media->getPath())), layer.gain,
+						  layer.offset});
+		}
+
+		sbs->playLayers(layers, options);
+		break;
+	}
+	case PadType::Variations: {
+		QList<MediaLayer> variations;
+
+		for (const MediaLayer &layer : obj->getLayers()) {
+			if (layer.getMedia())
+				variations.append(layer);
+		}
+
+		int index = obj->nextVariation((int)variations.size());
+
+		if (index < 0)
+			break;
+
+		const MediaLayer &variation = variations[index];
+		options.gain *= variation.gain;
+
+		sbs->play(QT_TO_UTF8(variation.getMedia()->getPath()), options);
+		break;
+	}
+	}
+}
+
+void Soundboard::updateProgress()
+{
+	QHash<uint32_t, int> progress;
+	QHash<uint32_t, int> levels;
+	uint64_t now = os_gettime_ns();
+
+	// A hotkey that played from the board selects its sound, like a click.
+	if (MediaObj *played = MediaObj::fromId(takeBoardTrigger()))
+		ui->list->setCurrentItem(findItem(played));
+
+	// The cue bus is not on air, so only the output buses are shown.
+	auto collect = [&](obs_source_t *busSource) {
+		SoundboardSource *sbs = SoundboardSource::fromSource(busSource);
+
+		if (!sbs)
+			return;
+
+		VoiceTable table = sbs->getEngine().getVoiceTable();
+
+		for (uint32_t i = 0; i < table.count; i++) {
+			const VoiceSnapshot &voice = table.voices[i];
+			double position = (double)voice.position;
+
+			// Move the position on from the end of the last block, the
+			// table only changes once per block.
+			if (!table.paused)
+				position += ((double)now - (double)table.timestamp) * table.sampleRate / 1000000000.0;
+
+			double fraction = voice.duration ? position / (double)voice.duration : 0.0;
+			int value = (int)(std::clamp(fraction, 0.0, 1.0) * 1000.0);
+
+			// The newest voice of a sound comes first in the table.
+			if (!progress.contains(voice.tag))
+				progress.insert(voice.tag, value);
+
+			// Layer pads show the loudest of their layers.
+			levels[voice.tag] = std::max(levels.value(voice.tag), meterPercent(voice.peak));
+		}
+	};
+
+	collect(source);
+
+	for (SoundboardBus &bus : buses)
+		collect(bus.source);
+
+	// Only the tiles of sounds that play now or played on the last update
+	// can change, and of those only the changed ones are updated, so the
+	// view only repaints their rects.
+	QSet<uint32_t> ids = progressIds;
+
+	for (auto it = progress.cbegin(); it != progress.cend(); ++it)
+		ids.insert(it.key());
+
+	progressIds.clear();
+
+	for (uint32_t id : ids) {
+		QListWidgetItem *item = items.value(id);
+
+		if (!item)
+			continue;
+
+		int value = progress.value(id, -1);
+		int level = levels.value(id, 0);
+
+		if (item->data(MediaProgressRole).toInt() != value)
+			item->setData(MediaProgressRole, value);
+		if (item->data(MediaLevelRole).toInt() != level)
+			item->setData(MediaLevelRole, level);
+
+		if (value >= 0 || level > 0)
+			progressIds.insert(id);
+	}
+
+	int interval = idleProgressInterval;
+
+	if (!progress.isEmpty()) {
+		QScreen *display = screen();
+		qreal rate = display ? display->refreshRate() : 60.0;
+		interval = std::max(1, (int)(1000.0 / std::max(rate, 1.0)));
+	}
+
+	if (progressTimer.interval() != interval)
+		progressTimer.setInterval(interval);
+}
+
+QStringList Soundboard::getEngineStats()
+{
+	QStringList lines;
+
+	auto addSource = [&lines](const QString &name, obs_source_t *busSource) {
+		SoundboardSource *sbs = SoundboardSource::fromSource(busSource);
+
+		if (!sbs)
+			return;
+
+		lines << name;
+
+		for (const std::string &line : sbs->getStatsReport())
+			lines << "  " + QT_UTF8(line.c_str());
+
+		lines << "";
+	};
+
+	addSource(QTStr("MainBus"), source);
+
+	for (SoundboardBus &bus : buses)
+		addSource(bus.name, bus.source);
+
+	addSource(QTStr("CueBus"), cueSource);
+
+	for (const std::string &line : SoundboardSource::getCacheReport())
+		lines << QT_UTF8(line.c_str());
+
+	ClipStore &store = ClipStore::get();
+	size_t sounds = store.size();
+	size_t bytes = store.memoryUsage();
+
+	lines << QString("Sound settings: %1 sounds, %2 KB, %3 bytes per sound")
+			 .arg((qulonglong)sounds)
+			 .arg(bytes / 1024.0, 0, 'f', 1)
+			 .arg((qulonglong)(sounds ? bytes / sounds : 0));
+
+	ProbeSummary probes = store.summarizeProbes();
+	lines << QString("Probed sounds: %1, %2 unplayable, %3 minutes in total")
+			 .arg((qulonglong)probes.probed)
+			 .arg((qulonglong)probes.unplayable)
+			 .arg(probes.durationMs / 60000.0, 0, 'f', 1);
+
+	return lines;
+}
+
+void Soundboard::showEngineStats()
+{
+	if (engineStats) {
+		engineStats->raise();
+		engineStats->activateWindow();
+		return;
+	}
+
+	engineStats = new EngineStats([this]() { return getEngineStats(); }, this);
+	engineStats->setAttribute(Qt::WA_DeleteOnClose);
+	engineStats->show();
+}
+
+// Renders a trigger script offline. The script is a JSON file:
+//
+// {"sample_rate": 48000, "channels": 2, "block_frames": 1024,
+//  "duration_ms": 0, "tempo": 0, "grid_beats": 1, "expected_hash": "",
+//  "triggers": [{"sound": "Name", "time_ms": 0, "mode": "overlap",
+//                "gain": 1.0, "loop": false, "quantize": false}]}
+//
+// A trigger names a sound on the board or gives a "path". When the script
+// has an expected hash, a different output is reported as a failure.
+void Soundboard::renderScript()
+{
+	// One render at a time, the dialog of the running one is modal.
+	if (renderProgress)
+		return;
+
+	QString scriptPath = QFileDialog::getOpenFileName(this, QTStr("RenderScript.Open"), QString(),
+							  "JSON (*.json)");
+
+	if (scriptPath.isEmpty())
+		return;
+
+	RenderScript script;
+	std::string error;
+
+	if (!loadRenderScript(QT_TO_UTF8(scriptPath), script, error)) {
+		blog(LOG_WARNING, "Soundboard: %s", error.c_str());
+		QMessageBox::warning(this, QTStr("RenderScript.Title"), QTStr("RenderScript.Invalid"));
+		return;
+	}
+
+	// Sounds named by the script are looked up here, the render itself
+	// never touches the board.
+	for (OfflineTrigger &trigger : script.triggers) {
+		if (trigger.sound.empty())
+			continue;
+
+		MediaObj *obj = MediaObj::findByName(QT_UTF8(trigger.sound.c_str()));
+
+		if (!obj || obj->getPadType() != PadType::Sound) {
+			QMessageBox::warning(this, QTStr("RenderScript.Title"),
+					     QTStr("RenderScript.UnknownSound").arg(QT_UTF8(trigger.sound.c_str())));
+			return;
+		}
+
+		trigger.path = QT_TO_UTF8(obj->getPath());
+	}
+
+	QString defaultPath = QFileInfo(scriptPath).dir().filePath(QFileInfo(scriptPath).completeBaseName() + ".wav");
+	QString wavPath = QFileDialog::getSaveFileName(this, QTStr("RenderScript.Save"), defaultPath, "WAV (*.wav)");
+
+	if (wavPath.isEmpty())
+		return;
+
+	script.settings.config.maxVoices = (size_t)maxVoices;
+	script.settings.config.maxScheduled = (size_t)maxVoices * 8;
+	// Sounds the board already decoded are not decoded again.
+	script.settings.cache = ClipCache::get();
+
+	auto job = std::make_shared<RenderJob>();
+	activeRender = job;
+	script.settings.progress = [job](uint64_t frames, uint64_t totalFrames) {
+		job->frames = frames;
+		job->totalFrames = totalFrames;
+		return !job->canceled;
+	};
+
+	renderProgress = new QProgressDialog(QTStr("RenderScript.Rendering"), MainStr("Cancel"), 0, 0, this);
+	renderProgress->setWindowTitle(QTStr("RenderScript.Title"));
+	renderProgress->setWindowModality(Qt::WindowModal);
+	renderProgress->setMinimumDuration(500);
+	renderProgress->setAutoClose(false);
+	renderProgress->setAutoReset(false);
+	renderProgress->setAttribute(Qt::WA_DeleteOnClose);
+
+	connect(renderProgress, &QProgressDialog::canceled, this, [job]() { job->canceled = true; });
+
+	// The dialog stays busy while the sounds are decoded, the length of the
+	// render is known after that.
+	QProgressDialog *dialog = renderProgress;
+	QTimer *timer = new QTimer(dialog);
+	connect(timer, &QTimer::timeout, dialog, [dialog, job]() {
+		uint64_t total = job->totalFrames;
+
+		if (!total)
+			return;
+
+		if (!dialog->maximum())
+			dialog->setRange(0, 1000);
+
+		dialog->setValue((int)std::min<uint64_t>(job->frames * 1000 / total, 1000));
+	});
+	timer->start(100);
+
+	// The dock can be destroyed while the render runs, the result is then
+	// dropped.
+	QPointer<Soundboard> board(this);
+	QThreadPool::globalInstance()->start([board, job, script, scriptPath, wavPath]() {
+		ProfileScope("Soundboard::render");
+
+		OfflineRenderResult result = renderOffline(script.triggers, script.settings, QT_TO_UTF8(wavPath));
+		QString expected = QT_UTF8(script.expectedHash.c_str());
+
+		QMetaObject::invokeMethod(
+			qApp,
+			[board, result, scriptPath, expected]() {
+				if (board)
+					board->renderFinished(result, scriptPath, expected);
+			},
+			Qt::QueuedConnection);
+		job->done.set_value();
+	});
+}
+
+void Soundboard::renderFinished(const OfflineRenderResult &result, const QString &scriptPath, const QString &expected)
+{
+	if (renderProgress)
+		renderProgress->close();
+
+	if (result.canceled)
+		return;
+
+	if (!result.success) {
+		blog(LOG_WARNING, "Soundboard: Render of '%s' failed: %s", QT_TO_UTF8(scriptPath),
+		     result.error.c_str());
+		QMessageBox::warning(this, QTStr("RenderScript.Title"), QT_UTF8(result.error.c_str()));
+		return;
+	}
+
+	QString hash = QT_UTF8(formatRenderHash(result.hash).c_str());
+
+	blog(LOG_INFO, "Soundboard: Rendered '%s', %llu frames, hash %s", QT_TO_UTF8(scriptPath),
+	     (unsigned long long)result.frames, QT_TO_UTF8(hash));
+
+	if (!expected.isEmpty() && expected != hash) {
+		blog(LOG_WARNING, "Soundboard: Render of '%s' does not match the expected hash %s",
+		     QT_TO_UTF8(scriptPath), QT_TO_UTF8(expected));
+		QMessageBox::warning(this, QTStr("RenderScript.Title"),
+				     QTStr("RenderScript.Mismatch").arg(hash, expected));
+		return;
+	}
+
+	QMessageBox::information(this, QTStr("RenderScript.Title"), QTStr("RenderScript.Done").arg(hash));
+}
+
+void Soundboard::preview(MediaObj *obj)
+{
+	SoundboardSource *sbs = SoundboardSource::fromSource(cueSource);
+
+	if (!sbs)
+		return;
+
+	// The cue bus shares the clip cache with the on-air buses, so a preview
+	// never decodes a sound again.
+	PlayOptions options;
+	options.gain = obj->getVolume();
+	options.loop = obj->loopEnabled();
+	options.tag = obj->getId();
+	options.triggerTime = os_gettime_ns();
+
+	trigger(sbs, obj, options);
+}
+
+void Soundboard::enqueue(MediaObj *obj, bool autoStart)
+{
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+
+	if (!sbs || obj->isPad())
+		return;
+
+	PlaybackEngine &engine = sbs->getEngine();
+	size_t count = (size_t)queue.size();
+
+	// Start a new queue once everything queued so far has been played, so
+	// the queue does not keep growing during a long session.
+	if (count && engine.getQueueSize() == count && engine.getQueuePosition() >= count)
+		clearQueue();
+
+	if ((size_t)queue.size() >= engine.getConfig().maxQueueItems) {
+		blog(LOG_WARNING, "Soundboard: Queue is full, '%s' was not added", QT_TO_UTF8(obj->getName()));
+		return;
+	}
+
+	queue.append(obj->getId());
+	sbs->enqueue(QT_TO_UTF8(obj->getPath()), obj->getVolume(), obj->getId(), autoStart);
+}
+
+void Soundboard::clearQueue()
+{
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+
+	if (sbs)
+		sbs->clearQueue();
+
+	queue.clear();
+}
+
+void Soundboard::queueNext()
+{
+	obs_source_media_next(source);
+}
+
+void Soundboard::queuePrevious()
+{
+	obs_source_media_previous(source);
+}
+
+void Soundboard::setTempo()
+{
+	bool ok = false;
+	double bpm = QInputDialog::getDouble(this, QTStr("Tempo.Title"), QTStr("Tempo.Text"), tempo, 20.0, 400.0, 2,
+					     &ok);
+
+	if (!ok)
+		return;
+
+	tempo = bpm;
+	applyTempo();
+}
+
+void Soundboard::itemRenamed(MediaObj *obj)
+{
+	QListWidgetItem *item = findItem(obj);
+
+	if (item)
+		item->setText(obj->getName());
+}
+
+MediaObj *Soundboard::add(const QString &name_, const QString &path)
+{
+	ProfileScope("Soundboard::add");
+
+	MediaObj *obj = createItem(getDefaultString(name_), path);
+	watchFile(path);
+	ui->list->setCurrentRow(ui->list->count() - 1);
+
+	updateActions();
+
+	return obj;
+}
+
+MediaObj *Soundboard::createItem(const QString &name, const QString &path)
+{
+	MediaObj *obj = new MediaObj(name, path);
+
+	QListWidgetItem *item = new SoundItem(name, obj->getId());
+	item->setData(MediaProgressRole, -1);
+	ui->list->addItem(item);
+	items.insert(obj->getId(), item);
+
+	boardTimer.start();
+
+	return obj;
+}
+
+void Soundboard::probeMedia(MediaObj *obj, QListWidgetItem *item)
+{
+	QFileInfo info(obj->getPath());
+	qint64 size = info.size();
+	qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+	if (obj->isProbeCurrent(size, modified)) {
+		updateMediaStatus(obj, item);
+		return;
+	}
+
+	// Sounds using the same file share one probe.
+	QString path = obj->getPath();
+
+	if (probing.contains(path))
+		return;
+
+	probing.insert(path);
+
+	QThreadPool::globalInstance()->start([this, path, size, modified]() {
+		ProfileScope("Soundboard::probe");
+
+		AudioProbe probe = probeAudioFile(QT_TO_UTF8(path));
+
+		QMetaObject::invokeMethod(
+			this,
+			[this, path, probe, size, modified]() {
+				probing.remove(path);
+
+				// The sounds are looked up again by path, they may
+				// have been removed or given a new file meanwhile.
+				for (MediaObj *obj : MediaObj::findByPath(path)) {
+					obj->setProbe(probe, size, modified);
+					updateMediaStatus(obj);
+				}
+			},
+			Qt::QueuedConnection);
+	});
+}
+
+void Soundboard::updateMediaStatus(MediaObj *obj, QListWidgetItem *item)
+{
+	if (!item)
+		item = findItem(obj);
+
+	if (!item)
+		return;
+
+	// The tooltip is built by the item when it is shown, only whether the
+	// sound can play is kept on it.
+	if (!QFileInfo::exists(obj->getPath()))
+		item->setData(MediaPlayableRole, false);
+	else if (obj->isProbed())
+		item->setData(MediaPlayableRole, obj->getProbe().playable);
+}
+
+void Soundboard::watchFile(const QString &path)
+{
+	if (path.isEmpty())
+		return;
+
+	QString dir = QFileInfo(path).absolutePath();
+	QSet<QString> &files = watchedDirs[dir];
+
+	if (files.contains(path))
+		return;
+
+	files.insert(path);
+
+	QFileInfo info(path);
 
-	if (!item)
-		return nullptr;
+	if (info.exists())
+		fileStamps.insert(path, {info.size(), info.lastModified().toMSecsSinceEpoch()});
 
-	QString uuid = item->data(Qt::UserRole).toString();
-	return MediaObj::findByUUID(uuid);
+	// Editors that save by replacing the file drop the watch on the file,
+	// the directory tells when it comes back. A missing file is only
+	// watched through its directory.
+	if (files.size() == 1 && QFileInfo::exists(dir))
+		watcher->addPath(dir);
+
+	if (QFileInfo::exists(path))
+		watcher->addPath(path);
 }
 
-QListWidgetItem *Soundboard::findItem(MediaObj *obj)
+// The scan already saw the imported files, so they are watched without
+// looking at them again and the watcher takes a whole batch in one call.
+void Soundboard::watchFiles(const QStringList &paths, const QList<FileStamp> &stamps)
 {
-	for (int i = 0; i < ui->list->count(); i++) {
-		QListWidgetItem *item = ui->list->item(i);
-		QString uuid = item->data(Qt::UserRole).toString();
+	QStringList added;
+
+	for (qsizetype i = 0; i < paths.size(); i++) {
+		const QString &path = paths[i];
+		QString dir = QFileInfo(path).absolutePath();
+		QSet<QString> &files = watchedDirs[dir];
+
+		if (files.contains(path))
+			continue;
+
+		files.insert(path);
+		fileStamps.insert(path, stamps[i]);
 
-		if (uuid == obj->getUUID())
-			return item;
+		if (files.size() == 1)
+			added << dir;
+
+		added << path;
 	}
 
-	return nullptr;
+	if (!added.isEmpty())
+		watcher->addPaths(added);
 }
 
-void Soundboard::createSource()
+void Soundboard::unwatchFile(const QString &path)
 {
-	if (obs_obj_invalid(source)) {
-		source = obs_source_create("ffmpeg_source", obs_module_text("Soundboard"), nullptr, nullptr);
-		obs_source_set_hidden(source, true);
+	QString dir = QFileInfo(path).absolutePath();
+	auto it = watchedDirs.find(dir);
 
-		ui->mediaControls->SetSource(source.Get());
+	if (it == watchedDirs.end() || !it->remove(path))
+		return;
+
+	fileStamps.remove(path);
+
+	if (watcher->files().contains(path))
+		watcher->removePath(path);
+
+	if (it->isEmpty()) {
+		watcher->removePath(dir);
+		watchedDirs.erase(it);
 	}
+}
 
-	obs_set_output_source(63, source);
+void Soundboard::pathChanged(const QString &path)
+{
+	// Saving a file often fires several changes in a row, they are
+	// handled together once the file has settled.
+	changedPaths.insert(path);
+	changeTimer.start();
 }
 
-OBSDataArray Soundboard::saveMedia()
+void Soundboard::checkChangedFiles()
 {
-	OBSDataArrayAutoRelease array = obs_data_array_create();
+	QSet<QString> paths;
 
-	for (int i = 0; i < ui->list->count(); i++) {
-		QListWidgetItem *item = ui->list->item(i);
-		QString uuid = item->data(Qt::UserRole).toString();
+	for (const QString &path : std::as_const(changedPaths)) {
+		auto it = watchedDirs.find(path);
 
-		MediaObj *obj = MediaObj::findByUUID(uuid);
+		if (it != watchedDirs.end())
+			paths.unite(*it);
+		else
+			paths.insert(path);
+	}
 
-		OBSDataAutoRelease settings = obs_data_create();
-		obs_data_set_string(settings, "name", QT_TO_UTF8(obj->getName()));
-		obs_data_set_string(settings, "path", QT_TO_UTF8(obj->getPath()));
-		obs_data_set_bool(settings, "loop", obj->loopEnabled());
-		obs_data_set_double(settings, "volume", (double)obj->getVolume());
+	changedPaths.clear();
 
-		OBSDataArrayAutoRelease hotkeyArray = obs_hotkey_save(obj->getHotkey());
-		obs_data_set_array(settings, "sound_hotkey", hotkeyArray);
+	ClipCache *cache = ClipCache::get();
+	QStringList files = watcher->files();
+	QSet<QString> watchedFiles(files.begin(), files.end());
+	QStringList rewatch;
 
-		obs_data_array_push_back(array, settings);
-	};
+	for (const QString &path : std::as_const(paths)) {
+		std::vector<MediaObj *> objs = MediaObj::findByPath(path);
 
-	return array.Get();
-}
+		if (objs.empty())
+			continue;
 
-void Soundboard::loadMedia(OBSDataArray array)
-{
-	for (size_t i = 0; i < obs_data_array_count(array); i++) {
-		OBSDataAutoRelease settings = obs_data_array_item(array, i);
+		QFileInfo info(path);
 
-		obs_data_set_default_string(settings, "name", obs_module_text("Sound"));
-		obs_data_set_default_double(settings, "volume", 1.0);
+		if (!info.exists()) {
+			missingPaths.insert(path);
+			fileStamps.remove(path);
 
-		QString name = obs_data_get_string(settings, "name");
-		QString path = obs_data_get_string(settings, "path");
-		bool loop = obs_data_get_bool(settings, "loop");
-		float volume = (float)obs_data_get_double(settings, "volume");
+			for (MediaObj *obj : objs)
+				updateMediaStatus(obj);
 
-		OBSDataArrayAutoRelease hotkeyArray = obs_data_get_array(settings, "sound_hotkey");
+			continue;
+		}
 
-		MediaObj *obj = add(name, path);
-		obs_hotkey_load(obj->getHotkey(), hotkeyArray);
-		obj->setLoopEnabled(loop);
-		obj->setVolume(volume);
-	}
-}
+		// A file that was replaced has to be watched again.
+		if (!watchedFiles.contains(path))
+			rewatch.append(path);
 
-void Soundboard::save(OBSData saveData)
-{
-	QMainWindow *window = (QMainWindow *)obs_frontend_get_main_window();
-	QDockWidget *dock = static_cast<QDockWidget *>(parent());
+		bool restored = missingPaths.remove(path);
 
-	OBSDataArray array = saveMedia();
-	obs_data_set_array(saveData, "soundboard_array", array);
+		// Changes to other files in the directory leave this one alone,
+		// whether or not it has been probed yet.
+		FileStamp stamp{info.size(), info.lastModified().toMSecsSinceEpoch()};
+		bool changed = !(fileStamps.value(path) == stamp);
 
-	if (!obs_obj_invalid(source)) {
-		OBSDataAutoRelease sourceData = obs_save_source(source);
-		obs_data_set_obj(saveData, "soundboard_source", sourceData);
-	}
+		fileStamps.insert(path, stamp);
 
-	obs_data_set_bool(saveData, "dock_visible", dock->isVisible());
-	obs_data_set_bool(saveData, "dock_floating", dock->isFloating());
-	obs_data_set_string(saveData, "dock_geometry", dock->saveGeometry().toBase64().constData());
-	obs_data_set_int(saveData, "dock_area", window->dockWidgetArea(dock));
-	obs_data_set_bool(saveData, "grid_mode", ui->list->GetGridMode());
+		if (!changed) {
+			if (restored) {
+				for (MediaObj *obj : objs)
+					updateMediaStatus(obj);
+			}
 
-	MediaObj *obj = getCurrentMediaObj();
+			continue;
+		}
 
-	if (obj)
-		obs_data_set_string(saveData, "current_sound", QT_TO_UTF8(obj->getName()));
+		if (cache)
+			cache->reload(QT_TO_UTF8(path));
 
-	obs_data_set_bool(saveData, "use_countdown", ui->mediaControls->countDownTimer);
+		for (MediaObj *obj : objs)
+			probeMedia(obj);
+	}
+
+	if (!rewatch.isEmpty())
+		watcher->addPaths(rewatch);
 }
 
-void Soundboard::loadSource(OBSData saveData)
+void Soundboard::updateBoard()
 {
-	OBSDataAutoRelease sourceData = obs_data_get_obj(saveData, "soundboard_source");
+	ProfileScope("Soundboard::updateBoard");
 
-	if (sourceData) {
-		obs_data_set_obj(sourceData, "settings", nullptr);
-		source = obs_load_source(sourceData);
-		obs_source_set_hidden(source, true);
+	auto board = std::make_unique<BoardSnapshot>();
+	ClipCache *cache = ClipCache::get();
 
-		if (obs_obj_invalid(source))
-			return;
+	QHash<QString, uint32_t> busIndex;
+	board->buses.emplace_back(source.Get());
 
-		ui->mediaControls->SetSource(source.Get());
+	for (SoundboardBus &bus : buses) {
+		busIndex.insert(bus.name, (uint32_t)board->buses.size());
+		board->buses.emplace_back(bus.source.Get());
 	}
-}
 
-void Soundboard::load(OBSData saveData)
-{
-	QMainWindow *window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
-	QDockWidget *dock = window->findChild<QDockWidget *>("SoundboardDock");
+	// Sounds that are not resident yet start loading, so the board can pin
+	// their clip.
+	auto pin = [cache](const std::string &path) -> std::shared_ptr<ClipEntry> {
+		if (!cache || path.empty())
+			return nullptr;
 
-	loadSource(saveData);
+		std::shared_ptr<ClipEntry> clip = cache->find(path);
+		return clip ? clip : cache->acquire(path);
+	};
 
-	OBSDataArrayAutoRelease array = obs_data_get_array(saveData, "soundboard_array");
-	loadMedia(array.Get());
+	QHash<QString, MediaObj *> sounds;
 
-	const char *geometry = obs_data_get_string(saveData, "dock_geometry");
+	for (MediaObj *obj : MediaObj::getAll())
+		sounds.insert(obj->getUUID(), obj);
 
-	if (geometry && *geometry)
-		dock->restoreGeometry(QByteArray::fromBase64(QByteArray(geometry)));
+	for (int i = 0; i < ui->list->count(); i++) {
+		MediaObj *obj = sounds.value(ui->list->item(i)->data(Qt::UserRole).toString());
 
-	const auto dockArea = static_cast<Qt::DockWidgetArea>(obs_data_get_int(saveData, "dock_area"));
+		// In playlist mode every sound is queued by the UI.
+		if (!obj || (playlistMode && !obj->isPad()))
+			continue;
 
-	if (dockArea)
-		window->addDockWidget(dockArea, dock);
+		uint32_t index = handleIndex(obj->getId());
 
-	bool visible = obs_data_get_bool(saveData, "dock_visible");
-	dock->setVisible(visible);
+		if (index >= board->clips.size())
+			board->clips.resize(index + 1);
 
-	obs_data_set_default_bool(saveData, "dock_floating", true);
-	bool floating = obs_data_get_bool(saveData, "dock_floating");
-	dock->setFloating(floating);
+		ClipDescriptor &desc = board->clips[index];
+		desc.handle = obj->getId();
 
-	obs_data_set_default_bool(saveData, "grid_mode", true);
-	bool grid = obs_data_get_bool(saveData, "grid_mode");
-	ui->list->SetGridMode(grid);
+		if (obj->isPad()) {
+			for (const MediaLayer &layer : obj->getLayers()) {
+				MediaObj *media = layer.getMedia();
 
-	QString lastSound = obs_data_get_string(saveData, "current_sound");
+				if (media)
+					desc.pads.push_back({pin(QT_TO_UTF8(media->getPath())), layer.gain,
+							     layer.offset});
+			}
+		}
 
-	if (!lastSound.isEmpty()) {
-		MediaObj *obj = MediaObj::findByName(lastSound);
-		QListWidgetItem *item = findItem(obj);
+		switch (obj->getPadType()) {
+		case PadType::Sound:
+			desc.clip = pin(QT_TO_UTF8(obj->getPath()));
+			break;
+		case PadType::Layers:
+			desc.type = BoardPad::Layers;
+			break;
+		case PadType::Variations:
+			desc.type = BoardPad::Variations;
+			desc.group = (uint32_t)board->groups.size();
+			board->groups.push_back(obj->getVariationGroup());
+			break;
+		}
 
-		if (item)
-			ui->list->setCurrentItem(item);
-		else
-			ui->list->setCurrentRow(0);
-	} else {
-		ui->list->setCurrentRow(0);
+		desc.gain = obj->getVolume();
+		desc.mode = obj->overlapEnabled() ? TriggerMode::Overlap : TriggerMode::Replace;
+		desc.loop = obj->loopEnabled();
+		desc.quantize = obj->quantizeEnabled();
+		desc.bus = busIndex.value(obj->getBus(), 0);
 	}
 
-	bool countdown = obs_data_get_bool(saveData, "use_countdown");
-	ui->mediaControls->countDownTimer = countdown;
+	publishBoard(std::move(board));
 }
 
-void Soundboard::clear()
+void Soundboard::importFolder()
 {
-	ui->mediaControls->countDownTimer = false;
-	ui->mediaControls->SetSource(nullptr);
-	source = nullptr;
+	QString dir = QFileDialog::getExistingDirectory(this, QTStr("ImportFolder.Title"));
 
-	prevPath = "";
-
-	for (int i = 0; i < ui->list->count(); i++) {
-		QListWidgetItem *item = ui->list->item(i);
-		QString uuid = item->data(Qt::UserRole).toString();
+	if (!dir.isEmpty())
+		importPaths({dir});
+}
 
-		MediaObj *obj = MediaObj::findByUUID(uuid);
-		delete obj;
-		obj = nullptr;
+void Soundboard::importPaths(const QStringList &paths)
+{
+	// Files dropped while an import runs are imported after it.
+	if (importProgress) {
+		pendingImports += paths;
+		return;
 	}
 
-	ui->list->clear();
+	if (paths.isEmpty())
+		return;
 
-	updateActions();
+	auto scan = std::make_shared<FolderScan>();
+
+	importProgress = new QProgressDialog(QTStr("ImportFolder.Scanning").arg(0), MainStr("Cancel"), 0, 0, this);
+	importProgress->setWindowTitle(QTStr("ImportFolder.Title"));
+	importProgress->setWindowModality(Qt::WindowModal);
+	importProgress->setMinimumDuration(500);
+	importProgress->setAutoClose(false);
+	importProgress->setAutoReset(false);
+	importProgress->setAttribute(Qt::WA_DeleteOnClose);
+
+	connect(importProgress, &QProgressDialog::canceled, this, [scan]() { scan->canceled = true; });
+
+	QProgressDialog *dialog = importProgress;
+	QTimer *timer = new QTimer(dialog);
+	connect(timer, &QTimer::timeout, dialog, [dialog, scan]() {
+		dialog->setLabelText(QTStr("ImportFolder.Scanning").arg(scan->found.load()));
+	});
+	timer->start(100);
+
+	// Loose files and directories are all looked at on the thread pool, the
+	// UI thread only inserts what was found.
+	scan->pending = 1;
+	scan->finished = [this, scan]() {
+		QMetaObject::invokeMethod(this, [this, scan]() { insertFiles(scan); }, Qt::QueuedConnection);
+	};
+
+	QThreadPool::globalInstance()->start([scan, paths]() { scanPaths(scan, paths); });
 }
 
-void Soundboard::play(MediaObj *obj)
+void Soundboard::insertFiles(std::shared_ptr<FolderScan> scan)
 {
-	QString path = obj->getPath();
-
-	if (prevPath == path) {
-		obs_source_media_restart(source);
+	if (scan->canceled || scan->files.isEmpty()) {
+		finishImport();
 		return;
 	}
 
-	prevPath = path;
-
-	QListWidgetItem *item = findItem(obj);
-
-	OBSDataAutoRelease settings = obs_data_create();
-	obs_data_set_bool(settings, "looping", obj->loopEnabled());
-	obs_data_set_string(settings, "local_file", QT_TO_UTF8(path));
-	obs_data_set_bool(settings, "is_local_file", true);
-	obs_source_update(source, settings);
+	// The tasks finish in any order, sort so the board follows the folders.
+	// Paths the collator sees as equal are ordered exactly, so a file found
+	// twice ends up next to itself.
+	QCollator collator;
+	collator.setNumericMode(true);
+	collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+	using File = FolderScan::File;
+	std::sort(scan->files.begin(), scan->files.end(), [&collator](const File &a, const File &b) {
+		int order = collator.compare(a.path, b.path);
+		return order ? order < 0 : a.path < b.path;
+	});
+	scan->files.erase(std::unique(scan->files.begin(), scan->files.end(),
+				      [](const File &a, const File &b) { return a.path == b.path; }),
+			  scan->files.end());
+
+	// Looking names up in a set keeps naming a large import linear.
+	for (int i = 0; i < ui->list->count(); i++)
+		scan->names.insert(ui->list->item(i)->text());
+
+	// The dialog is gone if it was closed, the import then runs on without
+	// it.
+	if (importProgress) {
+		importProgress->setLabelText(QTStr("ImportFolder.Adding"));
+		importProgress->setRange(0, (int)scan->files.size());
+	}
 
-	ui->list->setCurrentItem(item);
+	ui->list->BeginBatch();
+	insertBatch(scan);
 }
 
-void Soundboard::itemRenamed(MediaObj *obj)
+void Soundboard::insertBatch(std::shared_ptr<FolderScan> scan)
 {
-	QListWidgetItem *item = findItem(obj);
+	qsizetype end = std::min(scan->next + importBatchSize, scan->files.size());
+	QStringList paths;
+	QList<FileStamp> stamps;
 
-	if (item)
-		item->setText(obj->getName());
-}
+	for (; scan->next < end && !scan->canceled; scan->next++) {
+		const FolderScan::File &file = scan->files[scan->next];
+		QString name = getUniqueName(QFileInfo(file.path).fileName(), scan->names);
 
-MediaObj *Soundboard::add(const QString &name_, const QString &path)
-{
-	QString name = getDefaultString(name_);
+		scan->names.insert(name);
+		probeMedia(createItem(name, file.path), ui->list->item(ui->list->count() - 1));
 
-	MediaObj *obj = new MediaObj(name, path);
+		paths << file.path;
+		stamps << FileStamp{file.size, file.modified};
+	}
 
-	QListWidgetItem *item = new QListWidgetItem(name);
-	item->setData(Qt::UserRole, obj->getUUID());
-	ui->list->addItem(item);
-	ui->list->setCurrentItem(item);
+	watchFiles(paths, stamps);
+
+	if (scan->next < scan->files.size() && !scan->canceled) {
+		if (importProgress)
+			importProgress->setValue((int)scan->next);
+
+		QTimer::singleShot(0, this, [this, scan]() { insertBatch(scan); });
+		return;
+	}
+
+	ui->list->EndBatch();
 
-	connect(obj, &MediaObj::hotkeyPressed, this, &Soundboard::play);
-	connect(obj, &MediaObj::renamed, this, &Soundboard::itemRenamed);
+	if (ui->list->count())
+		ui->list->setCurrentRow(ui->list->count() - 1);
 
 	updateActions();
+	finishImport();
+}
 
-	return obj;
+void Soundboard::finishImport()
+{
+	// The dialog is only deleted later, let go of it now so the next import
+	// can start.
+	QProgressDialog *dialog = importProgress;
+	importProgress = nullptr;
+
+	if (dialog)
+		dialog->close();
+
+	if (!pendingImports.isEmpty()) {
+		QStringList paths = pendingImports;
+		pendingImports.clear();
+		importPaths(paths);
+	}
 }
 
 void Soundboard::on_actionAdd_triggered()
@@ -377,6 +2115,9 @@ void Soundboard::on_actionAdd_triggered()
 
 		MediaObj *obj = add(name, path);
 		obj->setLoopEnabled(loop);
+		obj->setOverlapEnabled(edit.overlapChecked());
+		obj->setQuantizeEnabled(edit.quantizeChecked());
+		probeMedia(obj);
 	};
 
 	connect(&edit, &QDialog::accepted, this, added);
@@ -385,6 +2126,49 @@ void Soundboard::on_actionAdd_triggered()
 	edit.exec();
 }
 
+void Soundboard::addPad(PadType type)
+{
+	PadEdit edit(type, getSoundNames(), this);
+
+	auto added = [&, this]() {
+		MediaObj *obj = add(edit.getName(), "");
+		obj->setPadType(type);
+		obj->setLayers(edit.getLayers());
+		obj->setVariationMode(edit.getVariationMode());
+		obj->setOverlapEnabled(edit.overlapChecked());
+		obj->setQuantizeEnabled(edit.quantizeChecked());
+		prewarmPad(obj);
+	};
+
+	connect(&edit, &QDialog::accepted, this, added);
+
+	edit.setName(getDefaultString(QTStr(type == PadType::Layers ? "LayerPad" : "VariationGroup")));
+	edit.exec();
+}
+
+void Soundboard::editPad(MediaObj *obj)
+{
+	PadEdit edit(obj->getPadType(), getSoundNames(), this);
+
+	auto edited = [&, this]() {
+		obj->setName(edit.getName());
+		obj->setLayers(edit.getLayers());
+		obj->setVariationMode(edit.getVariationMode());
+		obj->setOverlapEnabled(edit.overlapChecked());
+		obj->setQuantizeEnabled(edit.quantizeChecked());
+		prewarmPad(obj);
+	};
+
+	connect(&edit, &QDialog::accepted, this, edited);
+
+	edit.setName(obj->getName());
+	edit.setLayers(obj->getLayers());
+	edit.setVariationMode(obj->getVariationMode());
+	edit.setOverlapChecked(obj->overlapEnabled());
+	edit.setQuantizeChecked(obj->quantizeEnabled());
+	edit.exec();
+}
+
 void Soundboard::on_actionEdit_triggered()
 {
 	MediaObj *obj = getCurrentMediaObj();
@@ -392,16 +2176,30 @@ void Soundboard::on_actionEdit_triggered()
 	if (!obj)
 		return;
 
+	if (obj->isPad()) {
+		editPad(obj);
+		return;
+	}
+
 	MediaEdit edit(this);
 
 	auto edited = [&]() {
 		QString name = edit.getName();
 		QString path = edit.getPath();
+		QString oldPath = obj->getPath();
 		bool loop = edit.loopChecked();
 
 		obj->setName(name);
 		obj->setPath(path);
 		obj->setLoopEnabled(loop);
+		obj->setOverlapEnabled(edit.overlapChecked());
+		obj->setQuantizeEnabled(edit.quantizeChecked());
+
+		if (path != oldPath) {
+			releaseClip(oldPath);
+			watchFile(path);
+			probeMedia(obj);
+		}
 	};
 
 	connect(&edit, &QDialog::accepted, this, edited);
@@ -409,14 +2207,22 @@ void Soundboard::on_actionEdit_triggered()
 	edit.setName(obj->getName());
 	edit.setPath(obj->getPath());
 	edit.setLoopChecked(obj->loopEnabled());
+	edit.setOverlapChecked(obj->overlapEnabled());
+	edit.setQuantizeChecked(obj->quantizeEnabled());
 	edit.exec();
-
-	prevPath = "";
 }
 
 void Soundboard::on_list_itemClicked()
 {
-	play(getCurrentMediaObj());
+	MediaObj *obj = getCurrentMediaObj();
+
+	if (!obj)
+		return;
+
+	if (previewOnClick)
+		preview(obj);
+	else
+		play(obj);
 }
 
 void Soundboard::updateActions()
@@ -459,8 +2265,12 @@ void Soundboard::on_actionRemove_triggered()
 		return;
 
 	QListWidgetItem *item = findItem(obj);
+	items.remove(obj->getId());
+	progressIds.remove(obj->getId());
 	delete ui->list->takeItem(ui->list->row(item));
-	obj->deleteLater();
+	releaseClip(obj->getPath(), obj);
+	delete obj;
+	boardTimer.start();
 
 	updateActions();
 }
@@ -477,6 +2287,17 @@ void Soundboard::on_actionDuplicate_triggered()
 	bool loop = obj->loopEnabled();
 	MediaObj *newObj = add(name, path);
 	newObj->setLoopEnabled(loop);
+	newObj->setOverlapEnabled(obj->overlapEnabled());
+	newObj->setQuantizeEnabled(obj->quantizeEnabled());
+	newObj->setVolume(obj->getVolume());
+	newObj->setPadType(obj->getPadType());
+	newObj->setLayers(obj->getLayers());
+	newObj->setVariationMode(obj->getVariationMode());
+
+	if (obj->isProbed()) {
+		newObj->setProbe(obj->getProbe(), obj->getProbeSize(), obj->getProbeModified());
+		updateMediaStatus(newObj, ui->list->item(ui->list->count() - 1));
+	}
 }
 
 void Soundboard::on_list_customContextMenuRequested(const QPoint &pos)
@@ -486,6 +2307,9 @@ void Soundboard::on_list_customContextMenuRequested(const QPoint &pos)
 	QMenu popup(this);
 
 	popup.addAction(ui->actionAdd);
+	popup.addAction(QTStr("ImportFolder"), this, &Soundboard::importFolder);
+	popup.addAction(QTStr("AddLayerPad"), this, [this]() { addPad(PadType::Layers); });
+	popup.addAction(QTStr("AddVariationGroup"), this, [this]() { addPad(PadType::Variations); });
 	popup.addAction(MainStr("Basic.Filters"), this, [this]() { obs_frontend_open_source_filters(source); });
 	popup.addSeparator();
 
@@ -496,8 +2320,114 @@ void Soundboard::on_list_customContextMenuRequested(const QPoint &pos)
 		popup.addAction(ui->actionRemove);
 		popup.addAction(ui->actionDuplicate);
 		popup.addSeparator();
+
+		popup.addAction(QTStr("Preview"), this, [this]() {
+			MediaObj *obj = getCurrentMediaObj();
+
+			if (obj)
+				preview(obj);
+		});
+
+		QAction *queueAction = popup.addAction(QTStr("AddToQueue"), this, [this]() {
+			MediaObj *obj = getCurrentMediaObj();
+
+			if (obj)
+				enqueue(obj);
+		});
+
+		MediaObj *obj = getCurrentMediaObj();
+		queueAction->setEnabled(obj && !obj->isPad());
+
+		QMenu *routeMenu = popup.addMenu(QTStr("OutputBus"));
+
+		auto addRoute = [&, this](const QString &text, const QString &name) {
+			QAction *action = routeMenu->addAction(text, this, [this, name]() {
+				MediaObj *obj = getCurrentMediaObj();
+
+				if (obj)
+					obj->setBus(name);
+			});
+			action->setCheckable(true);
+			action->setChecked(obj && (obj->getBus() == name || (!findBus(obj->getBus()) && name.isEmpty())));
+		};
+
+		addRoute(QTStr("MainBus"), QString());
+
+		for (SoundboardBus &bus : buses)
+			addRoute(bus.name, bus.name);
+	}
+
+	QAction *clearQueueAction = popup.addAction(QTStr("ClearQueue"), this, &Soundboard::clearQueue);
+	clearQueueAction->setEnabled(!queue.isEmpty());
+
+	QAction *playlistAction = popup.addAction(QTStr("PlaylistMode"), this,
+						  [this](bool checked) {
+							  playlistMode = checked;
+							  boardTimer.start();
+						  });
+	playlistAction->setCheckable(true);
+	playlistAction->setChecked(playlistMode);
+
+	QAction *previewAction = popup.addAction(QTStr("PreviewOnClick"), this,
+						 [this](bool checked) { previewOnClick = checked; });
+	previewAction->setCheckable(true);
+	previewAction->setChecked(previewOnClick);
+
+	QMenu quantizeMenu(QTStr("Quantization"));
+	quantizeMenu.addAction(QTStr("Tempo"), this, &Soundboard::setTempo);
+	quantizeMenu.addSeparator();
+
+	auto addGrid = [&, this](const char *text, double beats) {
+		QAction *action = quantizeMenu.addAction(QTStr(text), this, [this, beats]() {
+			gridBeats = beats;
+			applyTempo();
+		});
+		action->setCheckable(true);
+		action->setChecked(gridBeats == beats);
+	};
+
+	addGrid("Grid.Bar", 4.0);
+	addGrid("Grid.Beat", 1.0);
+	addGrid("Grid.Half", 0.5);
+	addGrid("Grid.Quarter", 0.25);
+
+	popup.addMenu(&quantizeMenu);
+
+	QMenu busMenu(QTStr("Buses"));
+	busMenu.addAction(QTStr("AddBus"), this, &Soundboard::addBus);
+	busMenu.addSeparator();
+
+	QMenu *cueMenu = busMenu.addMenu(QTStr("CueBus"));
+	cueMenu->addAction(MainStr("Basic.Filters"), this, [this]() { obs_frontend_open_source_filters(cueSource); });
+
+	QMenu *mainMenu = busMenu.addMenu(QTStr("MainBus"));
+	mainMenu->addAction(MainStr("Basic.Filters"), this, [this]() { obs_frontend_open_source_filters(source); });
+	mainMenu->addAction(QTStr("OutputChannel").arg(outputChannel + 1), this,
+			    [this]() { setChannel(outputChannel, source); });
+
+	for (SoundboardBus &bus : buses) {
+		QString name = bus.name;
+		QMenu *menu = busMenu.addMenu(name);
+
+		menu->addAction(MainStr("Basic.Filters"), this, [this, name]() {
+			SoundboardBus *bus = findBus(name);
+
+			if (bus)
+				obs_frontend_open_source_filters(bus->source);
+		});
+		menu->addAction(QTStr("OutputChannel").arg(bus.channel + 1), this, [this, name]() {
+			SoundboardBus *bus = findBus(name);
+
+			if (bus)
+				setChannel(bus->channel, bus->source);
+		});
+		menu->addAction(MainStr("Rename"), this, [this, name]() { renameBus(name); });
+		menu->addAction(MainStr("Remove"), this, [this, name]() { removeBus(name); });
 	}
 
+	popup.addMenu(&busMenu);
+	popup.addAction(QTStr("EngineStats"), this, &Soundboard::showEngineStats);
+	popup.addAction(QTStr("RenderScript"), this, &Soundboard::renderScript);
 	popup.addSeparator();
 
 	QMenu subMenu(MainStr("Basic.Main.ListMode"));
@@ -542,25 +2472,14 @@ void Soundboard::dragMoveEvent(QDragMoveEvent *event)
 
 void Soundboard::dropEvent(QDropEvent *event)
 {
-	QStringList supportedExt;
-	supportedExt << "mp3"
-		     << "aac"
-		     << "ogg"
-		     << "wav"
-		     << "flac";
+	QStringList paths;
 
-	foreach(const QUrl &url, event->mimeData()->urls())
-	{
-		QString path = url.toLocalFile();
-		QFileInfo fi(path);
-		QString name = fi.fileName();
-		QString ext = fi.suffix();
-
-		if (!supportedExt.contains(ext))
-			continue;
-
-		add(name, path);
+	for (const QUrl &url : event->mimeData()->urls()) {
+		if (url.isLocalFile())
+			paths << url.toLocalFile();
 	}
+
+	importPaths(paths);
 }
 
 void Soundboard::editMediaName()
@@ -617,6 +2536,51 @@ void MediaRenameDelegate::setEditorData(QWidget *editor, const QModelIndex &inde
 		lineEdit->selectAll();
 }
 
+void MediaRenameDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	QStyledItemDelegate::paint(painter, option, index);
+
+	// A sound whose file can not be played is struck through, so it is
+	// noticed before it is pressed on air.
+	QVariant playable = index.data(MediaPlayableRole);
+
+	if (playable.isValid() && !playable.toBool()) {
+		int y = option.rect.center().y();
+
+		painter->save();
+		painter->setPen(QPen(QColor(220, 60, 60), 2));
+		painter->drawLine(option.rect.left() + 4, y, option.rect.right() - 4, y);
+		painter->restore();
+	}
+
+	int progress = index.data(MediaProgressRole).toInt();
+
+	if (progress < 0)
+		return;
+
+	// A playing sound gets a bar along the bottom of its tile.
+	QRect bar = option.rect.adjusted(2, 0, -2, -2);
+	bar.setTop(bar.bottom() - 2);
+
+	QRect filled = bar;
+	filled.setWidth(bar.width() * progress / 1000);
+
+	// And a level meter along its right edge.
+	int level = index.data(MediaLevelRole).toInt();
+	QRect meter = option.rect.adjusted(0, 2, -2, -6);
+	meter.setLeft(meter.right() - 2);
+	meter.setTop(meter.bottom() - meter.height() * level / 100);
+
+	painter->save();
+	painter->fillRect(bar, option.palette.color(QPalette::Mid));
+	painter->fillRect(filled, option.palette.color(QPalette::Highlight));
+
+	if (level > 0)
+		painter->fillRect(meter, option.palette.color(QPalette::Highlight));
+
+	painter->restore();
+}
+
 bool MediaRenameDelegate::eventFilter(QObject *editor, QEvent *event)
 {
 	if (event->type() == QEvent::KeyPress) {
@@ -645,6 +2609,8 @@ bool obs_module_load(void)
 {
 	blog(LOG_INFO, "Soundboard plugin version %s is loaded", PLUGIN_VERSION);
 
+	SoundboardSource::registerSource();
+
 	return true;
 }
 
@@ -658,7 +2624,12 @@ void obs_module_post_load(void)
 	obs_frontend_pop_ui_translation();
 }
 
-void obs_module_unload(void) {}
+void obs_module_unload(void)
+{
+	publishBoard(nullptr);
+	stopRender();
+	ClipCache::shutdown();
+}
 
 MODULE_EXPORT const char *obs_module_description(void)
 {
@@ -4,33 +4,163 @@
 
 #include <obs.hpp>
 
+#include <QHash>
+#include <QList>
 #include <QPointer>
+#include <QSet>
 #include <QStyledItemDelegate>
+#include <QTimer>
 
 #include <memory>
+#include <vector>
 
+class EngineStats;
 class MediaControls;
 class MediaObj;
 class QListWidgetItem;
+class QFileSystemWatcher;
+class QProgressDialog;
 class SceneTree;
+class SoundboardSource;
 class Ui_Soundboard;
 
+enum class PadType;
+struct FolderScan;
+struct OfflineRenderResult;
+struct PlayOptions;
+
+enum MediaItemRole {
+	MediaIdRole = Qt::UserRole + 1,
+	// Playback progress of the sound in thousandths, -1 when it is silent.
+	MediaProgressRole,
+	// Peak level of the sound in percent of the meter range.
+	MediaLevelRole,
+	// False once probing found that the sound's file can not be played.
+	MediaPlayableRole,
+};
+
+// An extra output for sounds, with its own source, filters and output
+// channel.
+struct SoundboardBus {
+	QString name;
+	OBSSourceAutoRelease source;
+	int channel = 0;
+};
+
 class Soundboard : public QWidget {
 	Q_OBJECT
 
 private:
-	QString prevPath;
 	std::unique_ptr<Ui_Soundboard> ui;
 
 	MediaObj *getCurrentMediaObj();
 	QListWidgetItem *findItem(MediaObj *obj);
 
 	OBSSourceAutoRelease source;
+	int outputChannel = 63;
+
+	std::vector<SoundboardBus> buses;
+
+	// Monitor only bus used to preview sounds without putting them on air.
+	OBSSourceAutoRelease cueSource;
+	int cueChannel = -1;
+	bool previewOnClick = false;
 
 	bool actionsEnabled = false;
 
 	QAction *renameMedia = nullptr;
 
+	// Handles of the queued sounds.
+	QList<uint32_t> queue;
+	bool playlistMode = false;
+
+	double tempo = 120.0;
+	double gridBeats = 1.0;
+
+	// Voices of every soundboard source, sized from the loaded board.
+	int maxVoices = 32;
+
+	QTimer progressTimer;
+	// List items by sound id, and the ids whose items show progress or a
+	// level, so a progress update only touches the playing sounds.
+	QHash<uint32_t, QListWidgetItem *> items;
+	QSet<uint32_t> progressIds;
+
+	QPointer<EngineStats> engineStats;
+	QPointer<QProgressDialog> importProgress;
+	// Paths to import once the running import is done.
+	QStringList pendingImports;
+	QPointer<QProgressDialog> renderProgress;
+	// Files that are being probed.
+	QSet<QString> probing;
+
+	QFileSystemWatcher *watcher = nullptr;
+	// Watched directories and the sound files in them.
+	QHash<QString, QSet<QString>> watchedDirs;
+	// Size and modification time of each watched file when it was last
+	// seen, so a change to a directory only reloads the files that changed.
+	struct FileStamp {
+		qint64 size = -1;
+		qint64 modified = -1;
+
+		bool operator==(const FileStamp &other) const
+		{
+			return size == other.size && modified == other.modified;
+		}
+	};
+	QHash<QString, FileStamp> fileStamps;
+	// Files and directories that changed since they were last checked.
+	QSet<QString> changedPaths;
+	// Watched files that were found missing.
+	QSet<QString> missingPaths;
+	QTimer changeTimer;
+
+	// Publishes the board once the current round of edits is done.
+	QTimer boardTimer;
+
+	obs_hotkey_id nextHotkey = OBS_INVALID_HOTKEY_ID;
+	obs_hotkey_id previousHotkey = OBS_INVALID_HOTKEY_ID;
+	obs_hotkey_id clearQueueHotkey = OBS_INVALID_HOTKEY_ID;
+
+	void releaseClip(const QString &path, const MediaObj *ignore = nullptr);
+	void prewarmPad(MediaObj *obj);
+	QStringList getSoundNames();
+	void addPad(PadType type);
+	void editPad(MediaObj *obj);
+	void applyTempo();
+	obs_data_t *getSourceSettings();
+	void createCueSource();
+	void trigger(SoundboardSource *sbs, MediaObj *obj, PlayOptions &options);
+	void updateProgress();
+	QStringList getEngineStats();
+	void showEngineStats();
+	void renderScript();
+	void renderFinished(const OfflineRenderResult &result, const QString &scriptPath, const QString &expected);
+	MediaObj *createItem(const QString &name, const QString &path);
+	void importPaths(const QStringList &paths);
+	void importFolder();
+	void insertFiles(std::shared_ptr<FolderScan> scan);
+	void insertBatch(std::shared_ptr<FolderScan> scan);
+	void finishImport();
+	void probeMedia(MediaObj *obj, QListWidgetItem *item = nullptr);
+	void updateMediaStatus(MediaObj *obj, QListWidgetItem *item = nullptr);
+	void watchFile(const QString &path);
+	void watchFiles(const QStringList &paths, const QList<FileStamp> &stamps);
+	void unwatchFile(const QString &path);
+	void pathChanged(const QString &path);
+	void checkChangedFiles();
+	void updateBoard();
+
+	SoundboardBus *findBus(const QString &name);
+	obs_source_t *getBusSource(const QString &name);
+	obs_source_t *createBusSource(const QString &name);
+	bool isChannelUsed(int channel, obs_source_t *ignore = nullptr);
+	int findFreeChannel();
+	bool setChannel(int &channel, obs_source_t *busSource);
+	void addBus();
+	void renameBus(const QString &name);
+	void removeBus(const QString &name);
+
 private slots:
 	void on_list_itemClicked();
 	void on_actionAdd_triggered();
@@ -41,7 +171,14 @@ private slots:
 	void on_actionDuplicate_triggered();
 
 	MediaObj *add(const QString &name, const QString &path);
-	void play(MediaObj *obj);
+	void play(MediaObj *obj, uint64_t timestamp = 0);
+	void preview(MediaObj *obj);
+
+	void enqueue(MediaObj *obj, bool autoStart = true);
+	void clearQueue();
+	void queueNext();
+	void queuePrevious();
+	void setTempo();
 
 	void editMediaName();
 	void mediaNameEdited(QWidget *editor);
@@ -54,6 +191,10 @@ public:
 
 	OBSDataArray saveMedia();
 	void loadMedia(OBSDataArray array);
+	OBSDataArray saveQueue();
+	void loadQueue(OBSDataArray array);
+	OBSDataArray saveBuses();
+	void loadBuses(OBSDataArray array);
 	void loadSource(OBSData saveData);
 	void clear();
 
@@ -75,6 +216,8 @@ class MediaRenameDelegate : public QStyledItemDelegate {
 public:
 	MediaRenameDelegate(QObject *parent);
 	virtual void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+	virtual void paint(QPainter *painter, const QStyleOptionViewItem &option,
+			   const QModelIndex &index) const override;
 
 protected:
 	virtual bool eventFilter(QObject *editor, QEvent *event) override;
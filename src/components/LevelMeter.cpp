@@ -0,0 +1,100 @@
+#include "LevelMeter.hpp"
+
+#include <QPainter>
+
+#include <algorithm>
+#include <cmath>
+
+#include "moc_LevelMeter.cpp"
+
+namespace {
+constexpr float minDb = -60.0f;
+constexpr float clipDb = -1.0f;
+// How fast the peak tick falls back, in dB per second.
+constexpr float peakDecay = 20.0f;
+
+float toDb(float level)
+{
+	return level > 0.0f ? 20.0f * std::log10(level) : minDb;
+}
+
+float toFraction(float db)
+{
+	return std::clamp((db - minDb) / -minDb, 0.0f, 1.0f);
+}
+} // namespace
+
+LevelMeter::LevelMeter(QWidget *parent) : QWidget(parent)
+{
+	setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
+
+	clipColor.setRgb(0xd0, 0x3a, 0x3a);
+	reset();
+}
+
+void LevelMeter::setLevels(const float *newPeaks, const float *rms, int count)
+{
+	float decay = decayTimer.isValid() ? peakDecay * (float)decayTimer.restart() / 1000.0f : 0.0f;
+
+	if (!decayTimer.isValid())
+		decayTimer.start();
+
+	channels = std::min(count, maxChannels);
+
+	for (int c = 0; c < channels; c++) {
+		levels[c] = toDb(rms[c]);
+		peaks[c] = std::max(toDb(newPeaks[c]), peaks[c] - decay);
+	}
+
+	update();
+}
+
+void LevelMeter::reset()
+{
+	for (int c = 0; c < maxChannels; c++) {
+		levels[c] = minDb;
+		peaks[c] = minDb;
+	}
+
+	decayTimer.invalidate();
+	update();
+}
+
+QColor LevelMeter::getClipColor() const
+{
+	return clipColor;
+}
+
+void LevelMeter::setClipColor(QColor color)
+{
+	clipColor = color;
+}
+
+QSize LevelMeter::sizeHint() const
+{
+	return QSize(48, 22);
+}
+
+void LevelMeter::paintEvent(QPaintEvent *)
+{
+	QPainter painter(this);
+
+	int count = std::max(channels, 1);
+	int barHeight = std::max(1, (height() - (count - 1)) / count);
+	int width = this->width();
+
+	for (int c = 0; c < count; c++) {
+		QRect bar(0, c * (barHeight + 1), width, barHeight);
+		painter.fillRect(bar, palette().color(QPalette::Mid));
+
+		if (c >= channels)
+			continue;
+
+		QColor color = levels[c] >= clipDb ? clipColor : palette().color(QPalette::Highlight);
+		painter.fillRect(QRect(bar.left(), bar.top(), (int)(width * toFraction(levels[c])), barHeight), color);
+
+		int peak = (int)((width - 1) * toFraction(peaks[c]));
+		painter.fillRect(QRect(peak, bar.top(), 1, barHeight),
+				 peaks[c] >= clipDb ? clipColor : palette().color(QPalette::Text));
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QWidget>
+
+// Compact horizontal meter with one bar per channel. The bar shows the RMS
+// level, the tick shows the peak, which falls back slowly.
+class LevelMeter : public QWidget {
+	Q_OBJECT
+	Q_PROPERTY(QColor clipColor READ getClipColor WRITE setClipColor DESIGNABLE true)
+
+public:
+	static constexpr int maxChannels = 8;
+
+	LevelMeter(QWidget *parent = nullptr);
+
+	// Levels are linear, 1.0 is full scale.
+	void setLevels(const float *peaks, const float *rms, int count);
+	void reset();
+
+	QColor getClipColor() const;
+	void setClipColor(QColor color);
+
+	virtual QSize sizeHint() const override;
+
+protected:
+	virtual void paintEvent(QPaintEvent *event) override;
+
+private:
+	int channels = 0;
+	float levels[maxChannels] = {};
+	float peaks[maxChannels] = {};
+
+	QElapsedTimer decayTimer;
+	QColor clipColor;
+};
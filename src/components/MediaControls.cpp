@@ -2,9 +2,15 @@
 #include "ui_MediaControls.h"
 
 #include <obs-frontend-api.h>
+#include <util/platform.h>
 
+#include "engine/SoundboardSource.hpp"
+
+#include <QScreen>
 #include <QToolTip>
 
+#include <algorithm>
+
 #include "moc_MediaControls.cpp"
 
 #define MainStr(str) QString(obs_frontend_get_locale_string(str))
@@ -50,6 +56,8 @@ MediaControls::MediaControls(QWidget *parent) : QWidget(parent), ui(new Ui::Medi
 	ui->setupUi(this);
 	setFocusPolicy(Qt::StrongFocus);
 
+	mediaTimer.setTimerType(Qt::PreciseTimer);
+
 	connect(&mediaTimer, &QTimer::timeout, this, &MediaControls::SetSliderPosition);
 	connect(&seekTimer, &QTimer::timeout, this, &MediaControls::SeekTimerCallback);
 	connect(ui->slider, &AbsoluteSlider::sliderPressed, this, &MediaControls::AbsoluteSliderClicked);
@@ -86,27 +94,73 @@ MediaControls::~MediaControls() {}
 
 bool MediaControls::MediaPaused()
 {
+	return GetMediaState() == OBS_MEDIA_STATE_PAUSED;
+}
+
+int64_t MediaControls::GetSliderTime(int val)
+{
+	float percent = (float)val / (float)ui->slider->maximum();
+	float duration = (float)GetMediaDuration();
+	int64_t seekTo = (int64_t)(percent * duration);
+
+	return seekTo;
+}
+
+int64_t MediaControls::GetMediaTime()
+{
+	if (soundboard) {
+		PlaybackSnapshot snapshot = soundboard->getEngine().getSnapshot();
+
+		if (!snapshot.sampleRate)
+			return 0;
+
+		// The snapshot is only updated once per audio block, move the
+		// position on to now so the slider does not step.
+		double frames = (double)snapshot.position;
+
+		if (snapshot.state == EngineState::Playing)
+			frames += ((double)os_gettime_ns() - (double)snapshot.timestamp) * snapshot.sampleRate /
+				  1000000000.0;
+
+		frames = std::clamp(frames, 0.0, (double)snapshot.duration);
+		return (int64_t)(frames * 1000.0 / snapshot.sampleRate);
+	}
+
 	OBSSource source = OBSGetStrongRef(weakSource);
-	if (!source) {
-		return false;
+	return source ? obs_source_media_get_time(source) : 0;
+}
+
+int64_t MediaControls::GetMediaDuration()
+{
+	if (soundboard) {
+		PlaybackSnapshot snapshot = soundboard->getEngine().getSnapshot();
+		return snapshot.sampleRate ? snapshot.duration * 1000 / snapshot.sampleRate : 0;
 	}
 
-	obs_media_state state = obs_source_media_get_state(source);
-	return state == OBS_MEDIA_STATE_PAUSED;
+	OBSSource source = OBSGetStrongRef(weakSource);
+	return source ? obs_source_media_get_duration(source) : 0;
 }
 
-int64_t MediaControls::GetSliderTime(int val)
+obs_media_state MediaControls::GetMediaState()
 {
+	if (soundboard)
+		return soundboard->getMediaState();
+
 	OBSSource source = OBSGetStrongRef(weakSource);
-	if (!source) {
-		return 0;
-	}
+	return source ? obs_source_media_get_state(source) : OBS_MEDIA_STATE_NONE;
+}
 
-	float percent = (float)val / (float)ui->slider->maximum();
-	float duration = (float)obs_source_media_get_duration(source);
-	int64_t seekTo = (int64_t)(percent * duration);
+int MediaControls::GetTimerInterval()
+{
+	// Other sources only report their time through libobs, so keep polling
+	// them slowly.
+	if (!soundboard)
+		return 1000;
 
-	return seekTo;
+	QScreen *display = screen();
+	qreal rate = display ? display->refreshRate() : 60.0;
+
+	return std::max(1, (int)(1000.0 / std::max(rate, 1.0)));
 }
 
 void MediaControls::AbsoluteSliderClicked()
@@ -116,7 +170,7 @@ void MediaControls::AbsoluteSliderClicked()
 		return;
 	}
 
-	obs_media_state state = obs_source_media_get_state(source);
+	obs_media_state state = GetMediaState();
 
 	if (state == OBS_MEDIA_STATE_PAUSED) {
 		prevPaused = true;
@@ -184,7 +238,7 @@ void MediaControls::StartMediaTimer()
 		return;
 
 	if (!mediaTimer.isActive())
-		mediaTimer.start(1000);
+		mediaTimer.start(GetTimerInterval());
 }
 
 void MediaControls::StopMediaTimer()
@@ -214,6 +268,7 @@ void MediaControls::SetPausedState()
 	ui->playPauseButton->style()->polish(ui->playPauseButton);
 	ui->playPauseButton->setToolTip(MainStr("ContextBar.MediaControls.PlayMedia"));
 
+	ui->meter->reset();
 	StopMediaTimer();
 }
 
@@ -235,6 +290,7 @@ void MediaControls::SetRestartState()
 	}
 
 	ui->slider->setEnabled(false);
+	ui->meter->reset();
 
 	StopMediaTimer();
 }
@@ -269,8 +325,9 @@ void MediaControls::RefreshControls()
 	isSlideshow = strcmp(id, "slideshow") == 0;
 	ui->slider->setVisible(!isSlideshow);
 	ui->emptySpaceAgain->setVisible(isSlideshow);
+	ui->meter->setVisible(soundboard != nullptr);
 
-	obs_media_state state = obs_source_media_get_state(source);
+	obs_media_state state = GetMediaState();
 
 	switch (state) {
 	case OBS_MEDIA_STATE_STOPPED:
@@ -302,6 +359,12 @@ OBSSource MediaControls::GetSource()
 void MediaControls::SetSource(OBSSource source)
 {
 	sigs.clear();
+	StopMediaTimer();
+
+	// The strong reference keeps the soundboard source alive while its
+	// snapshot is read.
+	soundboard = SoundboardSource::fromSource(source);
+	snapshotSource = soundboard ? source : nullptr;
 
 	if (source) {
 		weakSource = OBSGetWeakRef(source);
@@ -323,13 +386,11 @@ void MediaControls::SetSource(OBSSource source)
 
 void MediaControls::SetSliderPosition()
 {
-	OBSSource source = OBSGetStrongRef(weakSource);
-	if (!source) {
+	if (!soundboard && !OBSGetStrongRef(weakSource))
 		return;
-	}
 
-	float time = (float)obs_source_media_get_time(source);
-	float duration = (float)obs_source_media_get_duration(source);
+	float time = (float)GetMediaTime();
+	float duration = (float)GetMediaDuration();
 
 	float sliderPosition;
 
@@ -340,6 +401,7 @@ void MediaControls::SetSliderPosition()
 
 	ui->slider->setValue((int)sliderPosition);
 	UpdateLabels((int)sliderPosition);
+	UpdateMeter();
 }
 
 QString MediaControls::FormatSeconds(int totalSeconds)
@@ -359,7 +421,7 @@ void MediaControls::on_playPauseButton_clicked()
 		return;
 	}
 
-	obs_media_state state = obs_source_media_get_state(source);
+	obs_media_state state = GetMediaState();
 
 	switch (state) {
 	case OBS_MEDIA_STATE_STOPPED:
@@ -455,7 +517,7 @@ void MediaControls::MoveSliderFoward(int seconds)
 	if (!source)
 		return;
 
-	int ms = obs_source_media_get_time(source);
+	int ms = (int)GetMediaTime();
 	ms += seconds * 1000;
 
 	obs_source_media_set_time(source, ms);
@@ -469,7 +531,7 @@ void MediaControls::MoveSliderBackwards(int seconds)
 	if (!source)
 		return;
 
-	int ms = obs_source_media_get_time(source);
+	int ms = (int)GetMediaTime();
 	ms -= seconds * 1000;
 
 	obs_source_media_set_time(source, ms);
@@ -507,12 +569,10 @@ void MediaControls::UpdateSlideCounter()
 
 void MediaControls::UpdateLabels(int val)
 {
-	OBSSource source = OBSGetStrongRef(weakSource);
-	if (!source) {
+	if (!soundboard && !OBSGetStrongRef(weakSource))
 		return;
-	}
 
-	float duration = (float)obs_source_media_get_duration(source);
+	float duration = (float)GetMediaDuration();
 	float percent = (float)val / (float)ui->slider->maximum();
 
 	float time = percent * duration;
@@ -524,3 +584,12 @@ void MediaControls::UpdateLabels(int val)
 	else
 		ui->durationLabel->setText(QString("-") + FormatSeconds((int)((duration - time) / 1000.0f)));
 }
+
+void MediaControls::UpdateMeter()
+{
+	if (!soundboard)
+		return;
+
+	MeterSnapshot meter = soundboard->getEngine().getMasterMeter();
+	ui->meter->setLevels(meter.peak, meter.rms, (int)meter.channels);
+}
@@ -5,6 +5,7 @@
 #include <QTimer>
 #include <QWidget>
 
+class SoundboardSource;
 class Ui_MediaControls;
 
 class MediaControls : public QWidget {
@@ -15,6 +16,12 @@ class MediaControls : public QWidget {
 private:
 	std::vector<OBSSignal> sigs;
 	OBSWeakSource weakSource = nullptr;
+
+	// Soundboard sources publish their state after every audio block, so
+	// the controls can follow them without calling into libobs.
+	OBSSource snapshotSource;
+	SoundboardSource *soundboard = nullptr;
+
 	QTimer mediaTimer;
 	QTimer seekTimer;
 	int seek;
@@ -29,6 +36,10 @@ private:
 	void RefreshControls();
 	void SetScene(OBSScene scene);
 	int64_t GetSliderTime(int val);
+	int64_t GetMediaTime();
+	int64_t GetMediaDuration();
+	obs_media_state GetMediaState();
+	int GetTimerInterval();
 
 	static void OBSMediaStopped(void *data, calldata_t *calldata);
 	static void OBSMediaPlay(void *data, calldata_t *calldata);
@@ -66,6 +77,7 @@ private slots:
 
 	void UpdateSlideCounter();
 	void UpdateLabels(int val);
+	void UpdateMeter();
 
 public slots:
 	void PlayMedia();
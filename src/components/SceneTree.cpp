@@ -57,6 +57,23 @@ int SceneTree::GetGridItemHeight()
 	return itemHeight;
 }
 
+void SceneTree::BeginBatch()
+{
+	if (batchDepth++ == 0)
+		setUpdatesEnabled(false);
+}
+
+void SceneTree::EndBatch()
+{
+	if (--batchDepth > 0)
+		return;
+
+	QResizeEvent event(size(), size());
+	SceneTree::resizeEvent(&event);
+
+	setUpdatesEnabled(true);
+}
+
 bool SceneTree::eventFilter(QObject *obj, QEvent *event)
 {
 	return QObject::eventFilter(obj, event);
@@ -228,8 +245,10 @@ void SceneTree::dragLeaveEvent(QDragLeaveEvent *event)
 
 void SceneTree::rowsInserted(const QModelIndex &parent, int start, int end)
 {
-	QResizeEvent event(size(), size());
-	SceneTree::resizeEvent(&event);
+	if (!batchDepth) {
+		QResizeEvent event(size(), size());
+		SceneTree::resizeEvent(&event);
+	}
 
 	QListWidget::rowsInserted(parent, start, end);
 }
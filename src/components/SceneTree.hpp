@@ -13,6 +13,7 @@ class SceneTree : public QListWidget {
 	bool gridMode = false;
 	int maxWidth = 150;
 	int itemHeight = 24;
+	int batchDepth = 0;
 
 public:
 	void SetGridMode(bool grid);
@@ -23,6 +24,11 @@ public:
 	int GetGridItemWidth();
 	int GetGridItemHeight();
 
+	// Items inserted between these calls are laid out once, when the
+	// outermost batch ends.
+	void BeginBatch();
+	void EndBatch();
+
 	explicit SceneTree(QWidget *parent = nullptr);
 
 private:
@@ -0,0 +1,58 @@
+#include "EngineStats.hpp"
+#include "ui_EngineStats.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+
+#include <QFontDatabase>
+#include <QPushButton>
+#include <QScrollBar>
+
+#include "moc_EngineStats.cpp"
+
+#define QTStr(str) QString(obs_module_text(str))
+#define QT_TO_UTF8(str) str.toUtf8().constData()
+
+EngineStats::EngineStats(std::function<QStringList()> report_, QWidget *parent)
+	: QDialog(parent),
+	  report(std::move(report_)),
+	  ui(new Ui_EngineStats)
+{
+	obs_frontend_push_ui_translation(obs_module_get_string);
+	ui->setupUi(this);
+	obs_frontend_pop_ui_translation();
+
+	ui->text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+	logButton = ui->buttonBox->addButton(QTStr("EngineStats.Log"), QDialogButtonBox::ActionRole);
+
+	connect(&timer, &QTimer::timeout, this, &EngineStats::refresh);
+	timer.start(500);
+
+	refresh();
+}
+
+EngineStats::~EngineStats() {}
+
+void EngineStats::refresh()
+{
+	// Keep the scroll position, the text is replaced twice a second.
+	int scroll = ui->text->verticalScrollBar()->value();
+	ui->text->setPlainText(report().join("\n"));
+	ui->text->verticalScrollBar()->setValue(scroll);
+}
+
+void EngineStats::on_buttonBox_clicked(QAbstractButton *button)
+{
+	if (button != logButton) {
+		close();
+		return;
+	}
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Soundboard engine statistics:");
+
+	for (const QString &line : report())
+		blog(LOG_INFO, "%s", QT_TO_UTF8(line));
+
+	blog(LOG_INFO, "---------------------------------");
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QDialog>
+#include <QStringList>
+#include <QTimer>
+#include <functional>
+#include <memory>
+
+class QAbstractButton;
+class Ui_EngineStats;
+
+// Live view of the engine statistics. The report is fetched again on every
+// refresh, so the dialog can stay open while sounds are played.
+class EngineStats : public QDialog {
+	Q_OBJECT
+
+private:
+	std::function<QStringList()> report;
+	QTimer timer;
+	QAbstractButton *logButton = nullptr;
+	std::unique_ptr<Ui_EngineStats> ui;
+
+	void refresh();
+
+private slots:
+	void on_buttonBox_clicked(QAbstractButton *button);
+
+public:
+	EngineStats(std::function<QStringList()> report, QWidget *parent = nullptr);
+	~EngineStats();
+};
@@ -57,6 +57,26 @@ bool MediaEdit::loopChecked()
 	return ui->loop->isChecked();
 }
 
+void MediaEdit::setOverlapChecked(bool checked)
+{
+	ui->overlap->setChecked(checked);
+}
+
+bool MediaEdit::overlapChecked()
+{
+	return ui->overlap->isChecked();
+}
+
+void MediaEdit::setQuantizeChecked(bool checked)
+{
+	ui->quantize->setChecked(checked);
+}
+
+bool MediaEdit::quantizeChecked()
+{
+	return ui->quantize->isChecked();
+}
+
 void MediaEdit::on_browseButton_clicked()
 {
 	QString folder = ui->path->text();
@@ -67,7 +87,9 @@ void MediaEdit::on_browseButton_clicked()
 		folder = QStandardPaths::writableLocation(QStandardPaths::HomeLocation);
 
 	QString fileName = QFileDialog::getOpenFileName(this, QTStr("OpenAudioFile"), folder,
-							("Audio (*.mp3 *.aac *.ogg *.wav *.flac)"));
+							("Audio (*.mp3 *.aac *.m4a *.ogg *.opus *.wav *.w64 *.flac "
+							 "*.aif *.aiff *.caf *.mka *.webm);;"
+							 "All Files (*)"));
 
 	if (!fileName.isEmpty())
 		ui->path->setText(fileName);
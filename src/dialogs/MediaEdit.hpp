@@ -29,4 +29,10 @@ public:
 
 	void setLoopChecked(bool checked);
 	bool loopChecked();
+
+	void setOverlapChecked(bool checked);
+	bool overlapChecked();
+
+	void setQuantizeChecked(bool checked);
+	bool quantizeChecked();
 };
@@ -0,0 +1,204 @@
+#include "PadEdit.hpp"
+#include "ui_PadEdit.h"
+
+#include <obs-frontend-api.h>
+#include <obs-module.h>
+
+#include "engine/PlaybackEngine.hpp"
+
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QMessageBox>
+#include <QSpinBox>
+
+#include "moc_PadEdit.cpp"
+
+#define QTStr(str) QString(obs_module_text(str))
+#define MainStr(str) QString(obs_frontend_get_locale_string(str))
+
+PadEdit::PadEdit(PadType type_, const QStringList &sounds_, QWidget *parent)
+	: QDialog(parent),
+	  type(type_),
+	  sounds(sounds_),
+	  ui(new Ui_PadEdit)
+{
+	obs_frontend_push_ui_translation(obs_module_get_string);
+	ui->setupUi(this);
+	obs_frontend_pop_ui_translation();
+
+	bool variations = type == PadType::Variations;
+
+	// Variations are played one at a time, so an offset has no meaning.
+	ui->layers->setColumnHidden(1, variations);
+	ui->modeLabel->setVisible(variations);
+	ui->variationMode->setVisible(variations);
+
+	if (variations) {
+		setWindowTitle(QTStr("VariationProps"));
+		ui->addLayer->setText(QTStr("AddVariation"));
+		ui->removeLayer->setText(QTStr("RemoveVariation"));
+	}
+
+	updateButtons();
+}
+
+PadEdit::~PadEdit() {}
+
+void PadEdit::setName(const QString &name)
+{
+	ui->name->setText(name);
+
+	if (origText.isNull())
+		origText = name;
+}
+
+QString PadEdit::getName()
+{
+	return ui->name->text();
+}
+
+void PadEdit::setOverlapChecked(bool checked)
+{
+	ui->overlap->setChecked(checked);
+}
+
+bool PadEdit::overlapChecked()
+{
+	return ui->overlap->isChecked();
+}
+
+void PadEdit::setQuantizeChecked(bool checked)
+{
+	ui->quantize->setChecked(checked);
+}
+
+bool PadEdit::quantizeChecked()
+{
+	return ui->quantize->isChecked();
+}
+
+void PadEdit::setVariationMode(VariationMode mode)
+{
+	ui->variationMode->setCurrentIndex((int)mode);
+}
+
+VariationMode PadEdit::getVariationMode()
+{
+	return (VariationMode)ui->variationMode->currentIndex();
+}
+
+void PadEdit::addLayerRow(const MediaLayer &layer)
+{
+	int row = ui->layers->rowCount();
+	ui->layers->insertRow(row);
+
+	QComboBox *sound = new QComboBox();
+	sound->addItems(sounds);
+
+	if (MediaObj *media = layer.getMedia())
+		sound->setCurrentText(media->getName());
+
+	QSpinBox *offset = new QSpinBox();
+	offset->setRange(0, 60000);
+	offset->setSuffix(" ms");
+	offset->setValue(layer.offset);
+
+	QDoubleSpinBox *gain = new QDoubleSpinBox();
+	gain->setRange(-60.0, 20.0);
+	gain->setDecimals(1);
+	gain->setSuffix(" dB");
+	gain->setValue(layer.gain > 0.0f ? obs_mul_to_db(layer.gain) : -60.0);
+
+	ui->layers->setCellWidget(row, 0, sound);
+	ui->layers->setCellWidget(row, 1, offset);
+	ui->layers->setCellWidget(row, 2, gain);
+
+	updateButtons();
+}
+
+void PadEdit::setLayers(const QList<MediaLayer> &layers)
+{
+	ui->layers->setRowCount(0);
+
+	for (const MediaLayer &layer : layers)
+		addLayerRow(layer);
+}
+
+QList<MediaLayer> PadEdit::getLayers()
+{
+	QList<MediaLayer> layers;
+
+	for (int i = 0; i < ui->layers->rowCount(); i++) {
+		QComboBox *sound = static_cast<QComboBox *>(ui->layers->cellWidget(i, 0));
+		QSpinBox *offset = static_cast<QSpinBox *>(ui->layers->cellWidget(i, 1));
+		QDoubleSpinBox *gain = static_cast<QDoubleSpinBox *>(ui->layers->cellWidget(i, 2));
+
+		MediaObj *media = MediaObj::findByName(sound->currentText());
+
+		if (!media)
+			continue;
+
+		MediaLayer layer;
+		layer.media = media->getId();
+		layer.offset = offset->value();
+		layer.gain = obs_db_to_mul((float)gain->value());
+		layers.append(layer);
+	}
+
+	return layers;
+}
+
+void PadEdit::updateButtons()
+{
+	int count = ui->layers->rowCount();
+
+	bool full = type == PadType::Layers && count >= (int)EngineCommand::maxLayers;
+
+	ui->addLayer->setEnabled(!sounds.isEmpty() && !full);
+	ui->removeLayer->setEnabled(count > 0);
+}
+
+void PadEdit::on_addLayer_clicked()
+{
+	addLayerRow(MediaLayer());
+}
+
+void PadEdit::on_removeLayer_clicked()
+{
+	int row = ui->layers->currentRow();
+
+	if (row < 0)
+		row = ui->layers->rowCount() - 1;
+
+	ui->layers->removeRow(row);
+	updateButtons();
+}
+
+void PadEdit::on_buttonBox_clicked(QAbstractButton *button)
+{
+	QDialogButtonBox::ButtonRole val = ui->buttonBox->buttonRole(button);
+
+	if (val == QDialogButtonBox::RejectRole) {
+		close();
+	} else if (val == QDialogButtonBox::AcceptRole) {
+		QString name = getName();
+
+		if (name.isEmpty()) {
+			QMessageBox::warning(this, MainStr("EmptyName.Title"), MainStr("EmptyName.Text"));
+			return;
+		}
+
+		if (origText != name && MediaObj::findByName(name)) {
+			QMessageBox::warning(this, MainStr("NameExists.Title"), MainStr("NameExists.Text"));
+			return;
+		}
+
+		if (getLayers().isEmpty()) {
+			QMessageBox::warning(this, QTStr("NoLayers.Title"), QTStr("NoLayers.Text"));
+			return;
+		}
+
+		accept();
+		close();
+	}
+}
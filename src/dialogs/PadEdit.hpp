@@ -0,0 +1,47 @@
+#pragma once
+
+#include "models/MediaData.hpp"
+
+#include <QDialog>
+#include <QStringList>
+#include <memory>
+
+class QAbstractButton;
+class Ui_PadEdit;
+
+class PadEdit : public QDialog {
+	Q_OBJECT
+
+private:
+	QString origText;
+	PadType type;
+	QStringList sounds;
+	std::unique_ptr<Ui_PadEdit> ui;
+
+	void addLayerRow(const MediaLayer &layer);
+	void updateButtons();
+
+private slots:
+	void on_addLayer_clicked();
+	void on_removeLayer_clicked();
+	void on_buttonBox_clicked(QAbstractButton *button);
+
+public:
+	PadEdit(PadType type, const QStringList &sounds, QWidget *parent = nullptr);
+	~PadEdit();
+
+	void setName(const QString &name);
+	QString getName();
+
+	void setOverlapChecked(bool checked);
+	bool overlapChecked();
+
+	void setQuantizeChecked(bool checked);
+	bool quantizeChecked();
+
+	void setVariationMode(VariationMode mode);
+	VariationMode getVariationMode();
+
+	void setLayers(const QList<MediaLayer> &layers);
+	QList<MediaLayer> getLayers();
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Interleaved sample formats that are mixed straight from the file's bytes.
+enum class PcmFormat { S16LE, S16BE, S24LE, S24BE, F32LE };
+
+inline size_t sampleSize(PcmFormat format)
+{
+	switch (format) {
+	case PcmFormat::S16LE:
+	case PcmFormat::S16BE:
+		return 2;
+	case PcmFormat::S24LE:
+	case PcmFormat::S24BE:
+		return 3;
+	case PcmFormat::F32LE:
+		return 4;
+	}
+
+	return 0;
+}
+
+// Decoded clip audio, planar float at the OBS output sample rate and
+// channel count. Buffers are never modified once they are published.
+//
+// Uncompressed files that already match the output are mapped instead.
+// Their samples stay interleaved in the file's format and are converted
+// while they are mixed, planes is then empty.
+struct AudioBuffer {
+	uint32_t sampleRate = 0;
+	size_t frames = 0;
+	std::vector<std::vector<float>> planes;
+
+	std::unique_ptr<const MappedFile> pcm;
+	PcmFormat pcmFormat = PcmFormat::S16LE;
+	size_t pcmChannels = 0;
+
+	bool isPcm() const { return pcm != nullptr; }
+	const uint8_t *pcmData() const { return pcm->getData(); }
+
+	size_t channels() const { return isPcm() ? pcmChannels : planes.size(); }
+	const float *channel(size_t c) const { return planes[c].data(); }
+
+	// Memory owned by the buffer. Mapped samples belong to the page cache.
+	size_t memoryUsage() const
+	{
+		return planes.size() * frames * sizeof(float) + (pcm && !pcm->isMapped() ? pcm->getSize() : 0);
+	}
+};
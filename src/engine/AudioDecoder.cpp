@@ -0,0 +1,280 @@
+#include "AudioDecoder.hpp"
+#include "RealtimeCheck.hpp"
+
+#include <obs-module.h>
+#include <util/platform.h>
+
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+namespace {
+struct FormatContextDeleter {
+	void operator()(AVFormatContext *ctx) { avformat_close_input(&ctx); }
+};
+
+struct CodecContextDeleter {
+	void operator()(AVCodecContext *ctx) { avcodec_free_context(&ctx); }
+};
+
+struct SwrContextDeleter {
+	void operator()(SwrContext *ctx) { swr_free(&ctx); }
+};
+
+struct PacketDeleter {
+	void operator()(AVPacket *pkt) { av_packet_free(&pkt); }
+};
+
+struct FrameDeleter {
+	void operator()(AVFrame *frame) { av_frame_free(&frame); }
+};
+
+bool convertFrame(SwrContext *swr, const AVFrame *frame, AudioBuffer &buffer)
+{
+	int inSamples = frame ? frame->nb_samples : 0;
+	int maxOut = swr_get_out_samples(swr, inSamples);
+
+	if (maxOut <= 0)
+		return true;
+
+	uint8_t *out[AV_NUM_DATA_POINTERS] = {};
+
+	for (size_t c = 0; c < buffer.channels(); c++) {
+		std::vector<float> &plane = buffer.planes[c];
+		plane.resize(buffer.frames + (size_t)maxOut);
+		out[c] = reinterpret_cast<uint8_t *>(plane.data() + buffer.frames);
+	}
+
+	const uint8_t **in = frame ? const_cast<const uint8_t **>(frame->extended_data) : nullptr;
+	int converted = swr_convert(swr, out, maxOut, in, inSamples);
+
+	if (converted < 0)
+		return false;
+
+	buffer.frames += (size_t)converted;
+
+	for (std::vector<float> &plane : buffer.planes)
+		plane.resize(buffer.frames);
+
+	return true;
+}
+} // namespace
+
+const char *sniffAudioContainer(const uint8_t *data, size_t size)
+{
+	auto match = [data, size](size_t offset, const char *magic) {
+		size_t len = strlen(magic);
+		return size >= offset + len && memcmp(data + offset, magic, len) == 0;
+	};
+
+	if ((match(0, "RIFF") || match(0, "RF64")) && match(8, "WAVE"))
+		return "wav";
+	if (match(0, "riff") && match(16, "wave"))
+		return "w64";
+	if (match(0, "FORM") && (match(8, "AIFF") || match(8, "AIFC")))
+		return "aiff";
+	if (match(0, "fLaC"))
+		return "flac";
+	if (match(0, "OggS"))
+		return "ogg";
+	if (match(0, "ID3"))
+		return "mp3";
+	if (match(4, "ftyp"))
+		return "mp4";
+	if (match(0, "caff"))
+		return "caf";
+	if (match(0, "\x1a\x45\xdf\xa3"))
+		return "matroska";
+	if (match(0, "#!AMR"))
+		return "amr";
+	if (match(0, "MAC "))
+		return "ape";
+	if (match(0, "wvpk"))
+		return "wavpack";
+	if (match(0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11"))
+		return "asf";
+
+	// Raw MPEG audio starts with a frame sync. The layer bits are zero for
+	// an ADTS header, which is AAC.
+	if (size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0)
+		return (data[1] & 0x06) == 0 ? "aac" : "mp3";
+
+	return nullptr;
+}
+
+const char *sniffAudioFile(const std::string &path)
+{
+	FILE *file = os_fopen(path.c_str(), "rb");
+
+	if (!file)
+		return nullptr;
+
+	uint8_t header[32];
+	size_t size = fread(header, 1, sizeof(header), file);
+	fclose(file);
+
+	return sniffAudioContainer(header, size);
+}
+
+AudioProbe probeAudioFile(const std::string &path)
+{
+	RT_BLOCKING("file probe");
+
+	AudioProbe probe;
+
+	if (const char *container = sniffAudioFile(path))
+		probe.container = container;
+
+	AVFormatContext *fmt = nullptr;
+
+	if (avformat_open_input(&fmt, path.c_str(), nullptr, nullptr) < 0) {
+		probe.error = "The file could not be opened";
+		return probe;
+	}
+
+	std::unique_ptr<AVFormatContext, FormatContextDeleter> fmtGuard(fmt);
+
+	if (avformat_find_stream_info(fmt, nullptr) < 0) {
+		probe.error = "The stream info could not be read";
+		return probe;
+	}
+
+	const AVCodec *codec = nullptr;
+	int stream = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+
+	if (stream < 0 || !codec) {
+		probe.error = "The file has no playable audio stream";
+		return probe;
+	}
+
+	const AVStream *st = fmt->streams[stream];
+	probe.codec = codec->name;
+	probe.sampleRate = (uint32_t)st->codecpar->sample_rate;
+	probe.channels = (uint32_t)st->codecpar->ch_layout.nb_channels;
+
+	if (fmt->duration != AV_NOPTS_VALUE)
+		probe.durationMs = fmt->duration / (AV_TIME_BASE / 1000);
+	else if (st->duration != AV_NOPTS_VALUE)
+		probe.durationMs = av_rescale_q(st->duration, st->time_base, {1, 1000});
+
+	if (probe.container.empty() && fmt->iformat)
+		probe.container = fmt->iformat->name;
+
+	std::unique_ptr<AVCodecContext, CodecContextDeleter> dec(avcodec_alloc_context3(codec));
+
+	if (!dec || avcodec_parameters_to_context(dec.get(), st->codecpar) < 0 ||
+	    avcodec_open2(dec.get(), codec, nullptr) < 0) {
+		probe.error = "The decoder could not be opened";
+		return probe;
+	}
+
+	probe.playable = probe.sampleRate > 0 && probe.channels > 0;
+
+	if (!probe.playable)
+		probe.error = "The audio format is invalid";
+
+	return probe;
+}
+
+std::shared_ptr<AudioBuffer> decodeAudioFile(const std::string &path, uint32_t sampleRate, size_t channels)
+{
+	RT_BLOCKING("file decode");
+
+	AVFormatContext *fmt = nullptr;
+
+	if (avformat_open_input(&fmt, path.c_str(), nullptr, nullptr) < 0) {
+		blog(LOG_WARNING, "Soundboard: Failed to open '%s'", path.c_str());
+		return nullptr;
+	}
+
+	std::unique_ptr<AVFormatContext, FormatContextDeleter> fmtGuard(fmt);
+
+	if (avformat_find_stream_info(fmt, nullptr) < 0) {
+		blog(LOG_WARNING, "Soundboard: Failed to read stream info of '%s'", path.c_str());
+		return nullptr;
+	}
+
+	const AVCodec *codec = nullptr;
+	int stream = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+
+	if (stream < 0 || !codec) {
+		blog(LOG_WARNING, "Soundboard: No audio stream found in '%s'", path.c_str());
+		return nullptr;
+	}
+
+	std::unique_ptr<AVCodecContext, CodecContextDeleter> dec(avcodec_alloc_context3(codec));
+
+	if (!dec || avcodec_parameters_to_context(dec.get(), fmt->streams[stream]->codecpar) < 0 ||
+	    avcodec_open2(dec.get(), codec, nullptr) < 0) {
+		blog(LOG_WARNING, "Soundboard: Failed to open decoder for '%s'", path.c_str());
+		return nullptr;
+	}
+
+	AVChannelLayout inLayout;
+	AVChannelLayout outLayout;
+
+	if (dec->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+		av_channel_layout_default(&inLayout, dec->ch_layout.nb_channels);
+	else
+		av_channel_layout_copy(&inLayout, &dec->ch_layout);
+
+	av_channel_layout_default(&outLayout, (int)channels);
+
+	SwrContext *swrCtx = nullptr;
+	int ret = swr_alloc_set_opts2(&swrCtx, &outLayout, AV_SAMPLE_FMT_FLTP, (int)sampleRate, &inLayout,
+				      dec->sample_fmt, dec->sample_rate, 0, nullptr);
+
+	av_channel_layout_uninit(&inLayout);
+	av_channel_layout_uninit(&outLayout);
+
+	std::unique_ptr<SwrContext, SwrContextDeleter> swr(swrCtx);
+
+	if (ret < 0 || swr_init(swr.get()) < 0) {
+		blog(LOG_WARNING, "Soundboard: Failed to create resampler for '%s'", path.c_str());
+		return nullptr;
+	}
+
+	auto buffer = std::make_shared<AudioBuffer>();
+	buffer->sampleRate = sampleRate;
+	buffer->planes.resize(channels);
+
+	std::unique_ptr<AVPacket, PacketDeleter> pkt(av_packet_alloc());
+	std::unique_ptr<AVFrame, FrameDeleter> frame(av_frame_alloc());
+	bool success = true;
+
+	auto receiveFrames = [&]() {
+		while (success && avcodec_receive_frame(dec.get(), frame.get()) == 0) {
+			success = convertFrame(swr.get(), frame.get(), *buffer);
+			av_frame_unref(frame.get());
+		}
+	};
+
+	while (success && av_read_frame(fmt, pkt.get()) >= 0) {
+		if (pkt->stream_index == stream && avcodec_send_packet(dec.get(), pkt.get()) == 0)
+			receiveFrames();
+
+		av_packet_unref(pkt.get());
+	}
+
+	avcodec_send_packet(dec.get(), nullptr);
+	receiveFrames();
+
+	if (success)
+		success = convertFrame(swr.get(), nullptr, *buffer);
+
+	if (!success || !buffer->frames) {
+		blog(LOG_WARNING, "Soundboard: Failed to decode '%s'", path.c_str());
+		return nullptr;
+	}
+
+	for (std::vector<float> &plane : buffer->planes)
+		plane.shrink_to_fit();
+
+	return buffer;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "AudioBuffer.hpp"
+
+#include <memory>
+#include <string>
+
+// What probing found out about an audio file without decoding it.
+struct AudioProbe {
+	bool playable = false;
+	// Container named by the file's magic bytes, empty when they are not
+	// those of a known audio format.
+	std::string container;
+	std::string codec;
+	uint32_t sampleRate = 0;
+	uint32_t channels = 0;
+	int64_t durationMs = 0;
+	std::string error;
+};
+
+// Names the audio container that the first bytes of a file belong to, or
+// returns nullptr if they do not look like audio.
+const char *sniffAudioContainer(const uint8_t *data, size_t size);
+// Reads the first bytes of the file and sniffs them.
+const char *sniffAudioFile(const std::string &path);
+
+// Opens the file and its decoder to check that it can be played.
+AudioProbe probeAudioFile(const std::string &path);
+
+// Decodes a whole audio file into memory, converted to planar float with
+// the given sample rate and channel count. Returns nullptr on failure.
+std::shared_ptr<AudioBuffer> decodeAudioFile(const std::string &path, uint32_t sampleRate, size_t channels);
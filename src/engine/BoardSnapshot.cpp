@@ -0,0 +1,93 @@
+#include "BoardSnapshot.hpp"
+#include "EpochPointer.hpp"
+#include "SoundboardSource.hpp"
+
+#include <atomic>
+
+namespace {
+EpochPointer<BoardSnapshot> board;
+std::atomic<uint32_t> lastTrigger = invalidHandle;
+
+// Only the clips pinned by the board are played, the hotkey thread never
+// waits for the cache. A clip that was replaced or failed to load is left
+// to the UI, which loads it and publishes the board again.
+bool isPlayable(const std::shared_ptr<ClipEntry> &clip)
+{
+	return clip && !clip->isDropped() && clip->getState() != ClipEntry::State::Failed;
+}
+} // namespace
+
+void publishBoard(std::unique_ptr<BoardSnapshot> snapshot)
+{
+	board.publish(std::move(snapshot));
+}
+
+bool triggerBoardClip(uint32_t handle, uint64_t timestamp)
+{
+	EpochPointer<BoardSnapshot>::Guard guard;
+	board.read(guard);
+
+	uint32_t index = handleIndex(handle);
+
+	if (!guard || index >= guard->clips.size())
+		return false;
+
+	const ClipDescriptor &desc = guard->clips[index];
+
+	if (desc.handle != handle || desc.bus >= guard->buses.size())
+		return false;
+
+	if (desc.type == BoardPad::Sound && !isPlayable(desc.clip))
+		return false;
+
+	if (desc.type == BoardPad::Variations && desc.group >= guard->groups.size())
+		return false;
+
+	// Every layer or variation has to be playable before the pad is, so a
+	// press the UI has to handle neither plays part of the layers nor moves
+	// the rotation on twice.
+	for (const SoundLayer &pad : desc.pads) {
+		if (!isPlayable(pad.clip))
+			return false;
+	}
+
+	SoundboardSource *sbs = SoundboardSource::fromSource(guard->buses[desc.bus]);
+
+	if (!sbs)
+		return false;
+
+	PlayOptions options;
+	options.gain = desc.gain;
+	options.loop = desc.loop;
+	options.mode = desc.mode;
+	options.timestamp = timestamp;
+	options.quantize = desc.quantize;
+	options.tag = handle;
+	options.triggerTime = timestamp;
+
+	switch (desc.type) {
+	case BoardPad::Sound:
+		sbs->play(desc.clip, options);
+		break;
+	case BoardPad::Layers:
+		sbs->playLayers(desc.pads, options);
+		break;
+	case BoardPad::Variations: {
+		int picked = guard->groups[desc.group]->next((int)desc.pads.size());
+
+		if (picked >= 0) {
+			options.gain *= desc.pads[picked].gain;
+			sbs->play(desc.pads[picked].clip, options);
+		}
+		break;
+	}
+	}
+
+	lastTrigger.store(handle, std::memory_order_relaxed);
+	return true;
+}
+
+uint32_t takeBoardTrigger()
+{
+	return lastTrigger.exchange(invalidHandle, std::memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ClipCache.hpp"
+#include "HandleTable.hpp"
+#include "PlaybackEngine.hpp"
+#include "SoundboardSource.hpp"
+#include "VariationGroup.hpp"
+
+#include <obs.hpp>
+
+#include <memory>
+#include <vector>
+
+// How a sound on the board plays.
+enum class BoardPad { Sound, Layers, Variations };
+
+constexpr uint32_t noGroup = UINT32_MAX;
+
+// Everything a trigger needs to know about one sound.
+struct ClipDescriptor {
+	// Handle of the sound, invalidHandle for an unused slot.
+	uint32_t handle = invalidHandle;
+	BoardPad type = BoardPad::Sound;
+	// The clip as it was resident when the board was published. Triggers
+	// only play this one, a dropped or failed clip goes through the UI.
+	// Null for pads.
+	std::shared_ptr<ClipEntry> clip;
+	// The layers or variations of a pad, pinned like the clip of a sound.
+	std::vector<SoundLayer> pads;
+	// Index of a variation group's selection state in the board's groups,
+	// noGroup for anything else.
+	uint32_t group = noGroup;
+	float gain = 1.0f;
+	TriggerMode mode = TriggerMode::Replace;
+	bool loop = false;
+	bool quantize = false;
+	// Index into the board's buses.
+	uint32_t bus = 0;
+};
+
+// Immutable copy of the board, published by the UI after every edit so
+// hotkeys can be handled without touching Qt objects.
+struct BoardSnapshot {
+	// Indexed by the slot of the sound's handle.
+	std::vector<ClipDescriptor> clips;
+	// The main source first, then the buses.
+	std::vector<OBSSource> buses;
+	// Shared with the pads, so a hotkey moves the same rotation on as a
+	// click in the UI.
+	std::vector<std::shared_ptr<VariationGroup>> groups;
+};
+
+// Replaces the published board. Only called from the UI thread. Passing
+// nullptr drops the board and the source references it holds.
+void publishBoard(std::unique_ptr<BoardSnapshot> board);
+
+// Plays the sound or pad with the given handle from the published board. Can
+// be called from any thread, never blocks on the clip cache. Returns false if
+// the sound is not on the board, the handle is stale, one of its clips is no
+// longer current or the sound has to be triggered by the UI.
+bool triggerBoardClip(uint32_t handle, uint64_t timestamp);
+
+// Returns the handle of the last sound triggerBoardClip played, once, or
+// invalidHandle. The UI polls it to follow hotkeys without being posted to.
+uint32_t takeBoardTrigger();
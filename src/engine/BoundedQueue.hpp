@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "RealtimeCheck.hpp"
+
+// Fixed capacity multi-producer/multi-consumer queue (Vyukov). Pushing and
+// popping never allocate, so it is safe to use from the audio thread.
+template<typename T> class BoundedQueue {
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	size_t mask;
+
+	alignas(64) std::atomic<size_t> enqueuePos{0};
+	alignas(64) std::atomic<size_t> dequeuePos{0};
+
+public:
+	explicit BoundedQueue(size_t capacity)
+	{
+		size_t size = 2;
+
+		while (size < capacity)
+			size <<= 1;
+
+		cells.reset(new Cell[size]);
+		mask = size - 1;
+
+		for (size_t i = 0; i < size; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	BoundedQueue(const BoundedQueue &) = delete;
+	BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+	size_t capacity() const { return mask + 1; }
+
+	bool push(T &&value)
+	{
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &cells[pos & mask];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+			if (diff == 0) {
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				// Another producer took the slot, try the next one.
+				RT_BLOCKING("queue contention");
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = std::move(value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &value)
+	{
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &cells[pos & mask];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+			if (diff == 0) {
+				if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false;
+			} else {
+				RT_BLOCKING("queue contention");
+				pos = dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(cell->data);
+		cell->sequence.store(pos + mask + 1, std::memory_order_release);
+		return true;
+	}
+};
@@ -0,0 +1,325 @@
+#include "ClipCache.hpp"
+#include "AudioDecoder.hpp"
+#include "ContentHash.hpp"
+#include "PcmReader.hpp"
+#include "RealtimeCheck.hpp"
+
+#include <obs-module.h>
+#include <util/profiler.hpp>
+#include <util/threading.h>
+
+#include <chrono>
+#include <unordered_set>
+
+namespace {
+constexpr std::chrono::milliseconds retireInterval(100);
+
+// Hash of the samples a clip plays, taken once they are in memory. Buffers
+// in the file's format are seeded with the format, so the same bytes read
+// as another format never match.
+uint64_t hashBuffer(const AudioBuffer &buffer)
+{
+	if (buffer.isPcm()) {
+		uint64_t seed = (uint64_t)buffer.pcmFormat << 32 | buffer.pcmChannels;
+		return hashBytes(buffer.pcmData(), buffer.pcm->getSize(), seed);
+	}
+
+	uint64_t hash = buffer.planes.size();
+
+	for (const std::vector<float> &plane : buffer.planes)
+		hash = hashBytes(plane.data(), plane.size() * sizeof(float), hash);
+
+	return hash;
+}
+} // namespace
+
+ClipCache *ClipCache::cache = nullptr;
+
+ClipEntry::ClipEntry(const std::string &path_) : path(path_) {}
+
+ClipCache::ClipCache(uint32_t sampleRate_, size_t channels_) : sampleRate(sampleRate_), channels(channels_)
+{
+	thread = std::thread(&ClipCache::decodeThread, this);
+}
+
+ClipCache::~ClipCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	cv.notify_all();
+	thread.join();
+}
+
+void ClipCache::initialize(uint32_t sampleRate, size_t channels)
+{
+	if (!cache)
+		cache = new ClipCache(sampleRate, channels);
+}
+
+void ClipCache::shutdown()
+{
+	delete cache;
+	cache = nullptr;
+}
+
+ClipCache *ClipCache::get()
+{
+	return cache;
+}
+
+std::shared_ptr<ClipEntry> ClipCache::acquire(const std::string &path)
+{
+	RT_BLOCKING("clip cache lock");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = entries.find(path);
+
+	if (it != entries.end() && it->second->getState() != ClipEntry::State::Failed) {
+		hits.fetch_add(1, std::memory_order_relaxed);
+		return it->second;
+	}
+
+	misses.fetch_add(1, std::memory_order_relaxed);
+
+	auto entry = std::make_shared<ClipEntry>(path);
+
+	if (it != entries.end()) {
+		retire(std::move(it->second));
+		it->second = entry;
+	} else {
+		entries.emplace(path, entry);
+	}
+
+	jobs.push_back(entry);
+	cv.notify_one();
+
+	return entry;
+}
+
+std::shared_ptr<ClipEntry> ClipCache::find(const std::string &path)
+{
+	RT_BLOCKING("clip cache lock");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = entries.find(path);
+	return it != entries.end() ? it->second : nullptr;
+}
+
+void ClipCache::remove(const std::string &path)
+{
+	RT_BLOCKING("clip cache lock");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto it = entries.find(path);
+
+	if (it == entries.end())
+		return;
+
+	retire(std::move(it->second));
+	entries.erase(it);
+	pruneBuffers();
+}
+
+void ClipCache::reload(const std::string &path)
+{
+	RT_BLOCKING("clip cache lock");
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (entries.find(path) == entries.end())
+		return;
+
+	auto entry = std::make_shared<ClipEntry>(path);
+	entry->reload = true;
+	jobs.push_back(entry);
+	cv.notify_one();
+}
+
+void ClipCache::clear()
+{
+	RT_BLOCKING("clip cache lock");
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto &[path, entry] : entries)
+		retire(std::move(entry));
+
+	entries.clear();
+	buffers.clear();
+	jobs.clear();
+}
+
+void ClipCache::retire(std::shared_ptr<ClipEntry> entry)
+{
+	entry->dropped.store(true, std::memory_order_release);
+	retired.push_back(std::move(entry));
+}
+
+void ClipCache::freeRetired()
+{
+	std::vector<std::shared_ptr<ClipEntry>> unused;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// An entry only referenced here is no longer used by a voice, a
+		// queue or a command, and no one can get a new reference to it.
+		for (size_t i = 0; i < retired.size();) {
+			if (retired[i].use_count() == 1) {
+				unused.push_back(std::move(retired[i]));
+				retired[i] = std::move(retired.back());
+				retired.pop_back();
+			} else {
+				i++;
+			}
+		}
+	}
+
+	// Freed outside the lock, a long clip can take a while.
+	unused.clear();
+}
+
+void ClipCache::pruneBuffers()
+{
+	// Voices that are still playing a removed clip keep its buffer alive,
+	// so the expired entries are swept once they outnumber the clips.
+	if (buffers.size() <= entries.size() * 2 + 16)
+		return;
+
+	for (auto it = buffers.begin(); it != buffers.end();) {
+		if (it->second.expired())
+			it = buffers.erase(it);
+		else
+			++it;
+	}
+}
+
+CacheStats ClipCache::getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	CacheStats stats;
+	stats.entries = entries.size();
+	stats.pending = jobs.size();
+	stats.hits = hits.load(std::memory_order_relaxed);
+	stats.misses = misses.load(std::memory_order_relaxed);
+
+	std::unordered_set<const AudioBuffer *> counted;
+
+	for (auto &[path, entry] : entries) {
+		const AudioBuffer *buffer = entry->getBuffer();
+
+		if (!buffer)
+			continue;
+
+		size_t size = buffer->memoryUsage();
+
+		if (!counted.insert(buffer).second) {
+			stats.shared++;
+			stats.sharedBytes += size;
+			continue;
+		}
+
+		if (buffer->isPcm()) {
+			stats.pcm++;
+			stats.pcmBytes += buffer->pcm->getSize();
+		}
+
+		stats.bytes += size;
+	}
+
+	return stats;
+}
+
+void ClipCache::decodeThread()
+{
+	os_set_thread_name("soundboard-decode");
+
+	for (;;) {
+		std::shared_ptr<ClipEntry> entry;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			// Wakes up now and then to free the clips that were retired
+			// while they played.
+			cv.wait_for(lock, retireInterval, [this]() { return stopping || !jobs.empty(); });
+
+			if (stopping)
+				return;
+
+			if (!jobs.empty()) {
+				entry = std::move(jobs.front());
+				jobs.pop_front();
+			}
+		}
+
+		if (entry)
+			load(std::move(entry));
+
+		freeRetired();
+	}
+}
+
+void ClipCache::load(std::shared_ptr<ClipEntry> entry)
+{
+	// Every job is profiled on its own, so the decode time of a board
+	// shows up in the profiler summary next to the load that queued it.
+	ProfileScope("ClipCache::decode");
+
+	// Uncompressed files that match the output are mapped, the rest is
+	// decoded. A reload maps the file again and swaps the clip like any
+	// other, the old mapping goes away with the last voice playing it.
+	std::shared_ptr<const AudioBuffer> buffer = readPcmFile(entry->path, sampleRate, channels);
+
+	if (!buffer)
+		buffer = decodeAudioFile(entry->path, sampleRate, channels);
+
+	// The samples are hashed once they are loaded, so a file changed
+	// on disk gets a new hash when it is reloaded. A copy of a clip
+	// that is already resident shares its buffer, and the new one is
+	// freed.
+	uint64_t hash = buffer ? hashBuffer(*buffer) : 0;
+
+	if (buffer) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = buffers.find(hash);
+
+		if (it != buffers.end()) {
+			if (auto resident = it->second.lock())
+				buffer = std::move(resident);
+			else
+				it->second = buffer;
+		} else {
+			buffers.emplace(hash, buffer);
+		}
+
+		pruneBuffers();
+	}
+
+	if (buffer) {
+		entry->contentHash = hash;
+		entry->buffer = std::move(buffer);
+		entry->state.store(ClipEntry::State::Ready, std::memory_order_release);
+	} else {
+		entry->state.store(ClipEntry::State::Failed, std::memory_order_release);
+	}
+
+	// Voices that are playing the old clip finish with it, the next
+	// trigger gets the new one. A clip removed in the meantime stays
+	// removed.
+	if (entry->reload) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = entries.find(entry->path);
+
+		if (it != entries.end()) {
+			retire(std::move(it->second));
+			it->second = std::move(entry);
+		}
+	}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "AudioBuffer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ClipEntry {
+public:
+	enum class State { Pending, Ready, Failed };
+
+private:
+	std::string path;
+	std::atomic<State> state = State::Pending;
+	std::shared_ptr<const AudioBuffer> buffer;
+	uint64_t contentHash = 0;
+	// Set on the replacement for an entry whose file changed on disk.
+	bool reload = false;
+	std::atomic<bool> dropped = false;
+
+	friend class ClipCache;
+
+public:
+	explicit ClipEntry(const std::string &path);
+
+	const std::string &getPath() const { return path; }
+
+	State getState() const { return state.load(std::memory_order_acquire); }
+
+	// Only valid once the state is Ready. The buffer is written once by the
+	// decode thread before the state is released, so the audio thread can
+	// read it without taking a lock.
+	const AudioBuffer *getBuffer() const { return getState() == State::Ready ? buffer.get() : nullptr; }
+
+	// Set once the cache no longer hands out the entry, because it was
+	// removed or replaced by a newer version of the file.
+	bool isDropped() const { return dropped.load(std::memory_order_acquire); }
+
+	// Hash of the clip's samples, valid once the state is Ready. It always
+	// describes the buffer that plays, even if the file changed since.
+	uint64_t getContentHash() const { return getState() == State::Ready ? contentHash : 0; }
+};
+
+struct CacheStats {
+	size_t entries = 0;
+	size_t pending = 0;
+	size_t bytes = 0;
+	// Clips kept in the file's own sample format and the size of their
+	// samples. Mapped samples are in the page cache, not in bytes.
+	size_t pcm = 0;
+	size_t pcmBytes = 0;
+	// Clips that share the samples of an identical file loaded under
+	// another path, and the memory that saves.
+	size_t shared = 0;
+	size_t sharedBytes = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+// Keeps decoded clips resident in memory so triggering a sound never has to
+// wait for the file to be opened and decoded. Decoding happens on a
+// background thread in the order clips are requested. Files with identical
+// contents share one buffer, whatever their path.
+class ClipCache {
+	static ClipCache *cache;
+
+	uint32_t sampleRate;
+	size_t channels;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::unordered_map<std::string, std::shared_ptr<ClipEntry>> entries;
+	std::unordered_map<uint64_t, std::weak_ptr<const AudioBuffer>> buffers;
+	std::deque<std::shared_ptr<ClipEntry>> jobs;
+	// Entries the cache no longer hands out, kept until nothing else holds
+	// them. The last reference to a clip is then always dropped by the
+	// decode thread, never by the audio thread when a voice ends.
+	std::vector<std::shared_ptr<ClipEntry>> retired;
+	bool stopping = false;
+
+	std::atomic<uint64_t> hits = 0;
+	std::atomic<uint64_t> misses = 0;
+
+	std::thread thread;
+
+	void decodeThread();
+	void load(std::shared_ptr<ClipEntry> entry);
+	// Drops the buffers no clip holds anymore. Called with the mutex held.
+	void pruneBuffers();
+	// Stops handing out the entry. Called with the mutex held.
+	void retire(std::shared_ptr<ClipEntry> entry);
+	// Frees the retired entries nothing uses anymore.
+	void freeRetired();
+
+public:
+	ClipCache(uint32_t sampleRate, size_t channels);
+	~ClipCache();
+
+	static void initialize(uint32_t sampleRate, size_t channels);
+	static void shutdown();
+	static ClipCache *get();
+
+	// Returns the resident entry for the file, queueing it for decoding if
+	// it has not been loaded yet.
+	std::shared_ptr<ClipEntry> acquire(const std::string &path);
+	// Returns the resident entry for the file without loading it.
+	std::shared_ptr<ClipEntry> find(const std::string &path);
+	void remove(const std::string &path);
+	// Decodes the file again if it is resident. The old clip keeps being
+	// handed out until the new one is ready, then they are swapped.
+	void reload(const std::string &path);
+	void clear();
+
+	CacheStats getStats();
+
+	uint32_t getSampleRate() const { return sampleRate; }
+	size_t getChannels() const { return channels; }
+};
@@ -0,0 +1,103 @@
+#include "ContentHash.hpp"
+
+#include <cstring>
+
+namespace {
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// Samples are little endian on every platform OBS runs on, so the words are
+// read in host order.
+inline uint64_t read64(const uint8_t *p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+inline uint32_t read32(const uint8_t *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+inline uint64_t mixRound(uint64_t acc, uint64_t input)
+{
+	acc += input * prime2;
+	acc = rotl(acc, 31);
+	return acc * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+{
+	acc ^= mixRound(0, value);
+	return acc * prime1 + prime4;
+}
+} // namespace
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	const uint8_t *end = p + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		uint64_t v1 = seed + prime1 + prime2;
+		uint64_t v2 = seed + prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - prime1;
+
+		while (end - p >= 32) {
+			v1 = mixRound(v1, read64(p));
+			v2 = mixRound(v2, read64(p + 8));
+			v3 = mixRound(v3, read64(p + 16));
+			v4 = mixRound(v4, read64(p + 24));
+			p += 32;
+		}
+
+		hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		hash = mergeRound(hash, v1);
+		hash = mergeRound(hash, v2);
+		hash = mergeRound(hash, v3);
+		hash = mergeRound(hash, v4);
+	} else {
+		hash = seed + prime5;
+	}
+
+	hash += (uint64_t)size;
+
+	while (end - p >= 8) {
+		hash ^= mixRound(0, read64(p));
+		hash = rotl(hash, 27) * prime1 + prime4;
+		p += 8;
+	}
+
+	if (end - p >= 4) {
+		hash ^= (uint64_t)read32(p) * prime1;
+		hash = rotl(hash, 23) * prime2 + prime3;
+		p += 4;
+	}
+
+	while (p < end) {
+		hash ^= *p * prime5;
+		hash = rotl(hash, 11) * prime1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit XXH64 hash of a block of memory. Fast enough to run over whole
+// audio files, but not meant to resist deliberate collisions.
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Pointer to an immutable object that one thread replaces and any thread
+// reads without locking. Replaced objects are freed once no reader that
+// could still see them is left, which readers announce by pinning the
+// current epoch for as long as they use the object.
+template<typename T> class EpochPointer {
+	static constexpr size_t readerSlots = 16;
+
+	struct Retired {
+		std::unique_ptr<const T> object;
+		uint64_t epoch;
+	};
+
+	std::atomic<const T *> current = nullptr;
+	std::atomic<uint64_t> epoch = 1;
+	// Epoch pinned by each reader, zero for a free slot.
+	std::atomic<uint64_t> readers[readerSlots] = {};
+
+	std::mutex writerMutex;
+	std::unique_ptr<const T> owned;
+	std::vector<Retired> retired;
+
+	uint64_t oldestReader() const
+	{
+		uint64_t oldest = UINT64_MAX;
+
+		for (const std::atomic<uint64_t> &reader : readers) {
+			uint64_t pinned = reader.load();
+
+			if (pinned && pinned < oldest)
+				oldest = pinned;
+		}
+
+		return oldest;
+	}
+
+public:
+	class Guard {
+		EpochPointer *owner = nullptr;
+		size_t slot = 0;
+		const T *object = nullptr;
+
+		friend class EpochPointer;
+
+	public:
+		Guard() = default;
+		Guard(const Guard &) = delete;
+		Guard &operator=(const Guard &) = delete;
+
+		~Guard()
+		{
+			if (owner)
+				owner->readers[slot].store(0);
+		}
+
+		const T *get() const { return object; }
+		const T *operator->() const { return object; }
+		explicit operator bool() const { return object != nullptr; }
+	};
+
+	EpochPointer() = default;
+	EpochPointer(const EpochPointer &) = delete;
+	EpochPointer &operator=(const EpochPointer &) = delete;
+
+	~EpochPointer() { current.store(nullptr); }
+
+	// Pins the current epoch and returns the object, which stays valid
+	// until the guard is destroyed. Never blocks, but spins while every
+	// reader slot is taken.
+	void read(Guard &guard)
+	{
+		for (;;) {
+			uint64_t pinned = epoch.load();
+
+			for (size_t i = 0; i < readerSlots; i++) {
+				uint64_t free = 0;
+
+				if (readers[i].compare_exchange_strong(free, pinned)) {
+					guard.owner = this;
+					guard.slot = i;
+					guard.object = current.load();
+					return;
+				}
+			}
+		}
+	}
+
+	// Replaces the object. The old one is freed by this or a later call
+	// once no reader can still be using it.
+	void publish(std::unique_ptr<const T> object)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+
+		current.store(object.get());
+		uint64_t retiredEpoch = epoch.fetch_add(1) + 1;
+
+		if (owned)
+			retired.push_back({std::move(owned), retiredEpoch});
+
+		owned = std::move(object);
+		reclaim(oldestReader());
+	}
+
+private:
+	void reclaim(uint64_t oldest)
+	{
+		// A reader that pinned an epoch at or after the one an object was
+		// retired in loaded the pointer after it was replaced.
+		for (auto it = retired.begin(); it != retired.end();) {
+			if (it->epoch <= oldest)
+				it = retired.erase(it);
+			else
+				++it;
+		}
+	}
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense table of values addressed by 32-bit handles, for referring to
+// objects from other threads and deferred callbacks without raw pointers.
+// The low bits of a handle are the slot, the high bits the generation of
+// the slot, which changes whenever the slot is freed. A handle that
+// outlived its value is rejected by a single compare, until the slot has
+// been reused 4095 times. The table is only used by the thread that owns
+// it.
+constexpr uint32_t invalidHandle = 0;
+constexpr int handleIndexBits = 20;
+constexpr uint32_t handleIndexMask = (1u << handleIndexBits) - 1;
+
+inline uint32_t handleIndex(uint32_t handle)
+{
+	return handle & handleIndexMask;
+}
+
+template<typename T> class HandleTable {
+	static constexpr uint32_t maxGeneration = UINT32_MAX >> handleIndexBits;
+
+	struct Slot {
+		// Never zero, so no handle equals invalidHandle.
+		uint32_t generation = 1;
+		T value = T();
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeList;
+
+	static uint32_t makeHandle(uint32_t index, uint32_t generation)
+	{
+		return (generation << handleIndexBits) | index;
+	}
+
+public:
+	// Returns invalidHandle once every slot is in use.
+	uint32_t insert(const T &value)
+	{
+		uint32_t index;
+
+		if (!freeList.empty()) {
+			index = freeList.back();
+			freeList.pop_back();
+		} else if (slots.size() <= handleIndexMask) {
+			index = (uint32_t)slots.size();
+			slots.emplace_back();
+		} else {
+			return invalidHandle;
+		}
+
+		Slot &slot = slots[index];
+		slot.value = value;
+
+		return makeHandle(index, slot.generation);
+	}
+
+	void remove(uint32_t handle)
+	{
+		if (!contains(handle))
+			return;
+
+		uint32_t index = handleIndex(handle);
+		Slot &slot = slots[index];
+
+		slot.value = T();
+		slot.generation = slot.generation == maxGeneration ? 1 : slot.generation + 1;
+		freeList.push_back(index);
+	}
+
+	bool contains(uint32_t handle) const
+	{
+		uint32_t index = handleIndex(handle);
+		return index < slots.size() && makeHandle(index, slots[index].generation) == handle;
+	}
+
+	// The value of the handle, or a default value if it is stale.
+	T get(uint32_t handle) const { return contains(handle) ? slots[handleIndex(handle)].value : T(); }
+
+	size_t size() const { return slots.size() - freeList.size(); }
+};
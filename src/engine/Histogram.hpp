@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear histogram in the style of HdrHistogram. Every power of two is
+// split into 16 linear sub-buckets, so any value up to 2^63 is kept with
+// about 6% precision in a fixed amount of memory. One thread records, any
+// thread can read. Readers may see a value that is being recorded in one
+// counter but not yet in another, which only matters for a single sample.
+class Histogram {
+	static constexpr int subBucketBits = 4;
+	static constexpr size_t subBuckets = 1 << subBucketBits;
+	static constexpr size_t bucketCount = 64 - subBucketBits + 1;
+	static constexpr size_t counterCount = bucketCount * subBuckets;
+
+	std::atomic<uint64_t> counts[counterCount] = {};
+	std::atomic<uint64_t> total = 0;
+	std::atomic<uint64_t> sum = 0;
+	std::atomic<uint64_t> max = 0;
+
+	static size_t indexOf(uint64_t value)
+	{
+		if (value < subBuckets)
+			return (size_t)value;
+
+		int shift = 0;
+
+		while (shift + subBucketBits + 1 < 64 && value >> (shift + subBucketBits + 1))
+			shift++;
+
+		size_t sub = (size_t)(value >> shift) - subBuckets;
+		return subBuckets * (size_t)(shift + 1) + sub;
+	}
+
+	// Highest value that falls into the counter.
+	static uint64_t highestValue(size_t index)
+	{
+		if (index < subBuckets)
+			return index;
+
+		int shift = (int)(index / subBuckets) - 1;
+		uint64_t sub = index % subBuckets;
+
+		return ((subBuckets + sub + 1) << shift) - 1;
+	}
+
+	static void add(std::atomic<uint64_t> &counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+public:
+	void record(uint64_t value)
+	{
+		add(counts[indexOf(value)], 1);
+		add(total, 1);
+		add(sum, value);
+
+		if (value > max.load(std::memory_order_relaxed))
+			max.store(value, std::memory_order_relaxed);
+	}
+
+	uint64_t getCount() const { return total.load(std::memory_order_relaxed); }
+	uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+
+	uint64_t getMean() const
+	{
+		uint64_t count = getCount();
+		return count ? sum.load(std::memory_order_relaxed) / count : 0;
+	}
+
+	// Value that the given fraction of the recorded values are at or below.
+	uint64_t getPercentile(double fraction) const
+	{
+		uint64_t count = getCount();
+
+		if (!count)
+			return 0;
+
+		uint64_t target = (uint64_t)(fraction * (double)count + 0.5);
+		uint64_t seen = 0;
+
+		if (target < 1)
+			target = 1;
+
+		for (size_t i = 0; i < counterCount; i++) {
+			seen += counts[i].load(std::memory_order_relaxed);
+
+			if (seen >= target) {
+				uint64_t value = highestValue(i);
+				uint64_t highest = getMax();
+				return value < highest ? value : highest;
+			}
+		}
+
+		return getMax();
+	}
+};
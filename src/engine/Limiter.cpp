@@ -0,0 +1,237 @@
+#include "Limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double pi = 3.14159265358979323846;
+constexpr size_t phases = 3;
+
+double windowedSinc(double x, double halfWidth)
+{
+	if (std::fabs(x) >= halfWidth)
+		return 0.0;
+
+	double window = 0.5 * (1.0 + std::cos(pi * x / halfWidth));
+	double sinc = x == 0.0 ? 1.0 : std::sin(pi * x) / (pi * x);
+
+	return sinc * window;
+}
+
+size_t nextPowerOfTwo(size_t value)
+{
+	size_t size = 1;
+
+	while (size < value)
+		size <<= 1;
+
+	return size;
+}
+
+float horizontalMax(__m128 v)
+{
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+__m128 absolute(__m128 v)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+} // namespace
+
+Limiter::Limiter(uint32_t sampleRate, size_t channels_, float ceilingDb, float lookaheadMs, float releaseMs)
+	: channels(channels_)
+{
+	lookahead = std::max(historyFrames, (size_t)std::lround(lookaheadMs * sampleRate / 1000.0f));
+	ceiling = std::pow(10.0f, ceilingDb / 20.0f);
+	release = 1.0f - std::exp(-1.0f / (releaseMs * sampleRate / 1000.0f));
+
+	// A peak is known filterDelay frames after its sample arrives, so the
+	// audio is held back that much longer than the lookahead.
+	delayFrames = lookahead + filterDelay;
+
+	float phaseTaps[phases][historyFrames];
+
+	// The filters see four samples on each side of the points.
+	for (size_t p = 0; p < phases; p++) {
+		double target = -4.0 + (double)(p + 1) / 4.0;
+		double sum = 0.0;
+
+		for (size_t k = 0; k < historyFrames; k++) {
+			double t = (double)k - (double)(historyFrames - 1);
+			phaseTaps[p][k] = (float)windowedSinc(target - t, 4.0);
+			sum += phaseTaps[p][k];
+		}
+
+		for (size_t k = 0; k < historyFrames; k++)
+			phaseTaps[p][k] = (float)(phaseTaps[p][k] / sum);
+	}
+
+	for (size_t k = 0; k < historyFrames; k++) {
+		float sample = k == historyFrames - 1 - filterDelay ? 1.0f : 0.0f;
+		taps[k] = _mm_setr_ps(phaseTaps[0][k], phaseTaps[1][k], phaseTaps[2][k], sample);
+	}
+
+	// A pass writes chunkFrames new samples while it reads the ones it
+	// outputs, the ring has to hold both.
+	size_t delaySize = nextPowerOfTwo(delayFrames + chunkFrames);
+	delayMask = delaySize - 1;
+	delay.assign(channels, std::vector<float>(delaySize * 2, 0.0f));
+
+	// The gain of an output sample has to cover the segments on both sides
+	// of it, so the window is one frame longer than the lookahead.
+	size_t minSize = nextPowerOfTwo(lookahead + 2);
+	minMask = minSize - 1;
+	minFrames.resize(minSize);
+	minGains.resize(minSize);
+
+	smoothed.assign(lookahead, 1.0f);
+	smoothedSum = (double)lookahead;
+
+	peaks.assign(channels, 0.0f);
+	sumSquares.assign(channels, 0.0);
+}
+
+// Highest magnitude of the segment that ends filterDelay frames before the
+// newest sample, on any channel.
+float Limiter::segmentPeak(size_t pos) const
+{
+	const size_t size = delayMask + 1;
+	__m128 peak = _mm_setzero_ps();
+
+	for (size_t c = 0; c < channels; c++) {
+		const float *history = delay[c].data() + pos + size - (historyFrames - 1);
+		__m128 sum = _mm_mul_ps(_mm_set1_ps(history[0]), taps[0]);
+
+		for (size_t k = 1; k < historyFrames; k++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(history[k]), taps[k]));
+
+		peak = _mm_max_ps(peak, absolute(sum));
+	}
+
+	return horizontalMax(peak);
+}
+
+float Limiter::minimumGain(float gain)
+{
+	const size_t window = lookahead + 1;
+
+	while (minCount && minGains[(minHead + minCount - 1) & minMask] >= gain)
+		minCount--;
+
+	size_t tail = (minHead + minCount) & minMask;
+	minFrames[tail] = frame;
+	minGains[tail] = gain;
+	minCount++;
+
+	while (minFrames[minHead] + window <= frame) {
+		minHead = (minHead + 1) & minMask;
+		minCount--;
+	}
+
+	return minGains[minHead];
+}
+
+float Limiter::nextGain(float peak)
+{
+	float required = peak > ceiling ? ceiling / peak : 1.0f;
+	float target = minimumGain(required);
+
+	// Every value of the envelope is at most the required gain of the whole
+	// window before it, so the average over the window is low enough for
+	// every segment in it.
+	if (target < envelope)
+		envelope = target;
+	else
+		envelope += (target - envelope) * release;
+
+	smoothedSum += (double)envelope - (double)smoothed[smoothedPos];
+	smoothed[smoothedPos] = envelope;
+
+	// Sum the window again once per pass, so rounding errors in the running
+	// sum can not build up.
+	if (++smoothedPos == lookahead) {
+		smoothedPos = 0;
+		smoothedSum = 0.0;
+
+		for (float value : smoothed)
+			smoothedSum += value;
+	}
+
+	frame++;
+	return std::min((float)(smoothedSum / (double)lookahead), 1.0f);
+}
+
+float Limiter::getRms(size_t channel) const
+{
+	return meteredFrames ? (float)std::sqrt(sumSquares[channel] / (double)meteredFrames) : 0.0f;
+}
+
+void Limiter::process(float *const *planes, size_t frames)
+{
+	const size_t size = delayMask + 1;
+	float gains[chunkFrames];
+
+	std::fill(peaks.begin(), peaks.end(), 0.0f);
+	std::fill(sumSquares.begin(), sumSquares.end(), 0.0);
+	meteredFrames = frames;
+
+	for (size_t done = 0; done < frames;) {
+		const size_t count = std::min(chunkFrames, frames - done);
+		const size_t readPos = (delayPos - delayFrames) & delayMask;
+
+		// The gain has to be worked out frame by frame, the envelope
+		// depends on the frame before.
+		for (size_t i = 0; i < count; i++) {
+			const size_t pos = (delayPos + i) & delayMask;
+
+			for (size_t c = 0; c < channels; c++) {
+				float sample = planes[c][done + i];
+				delay[c][pos] = sample;
+				delay[c][pos + size] = sample;
+			}
+
+			gains[i] = nextGain(segmentPeak(pos));
+		}
+
+		// Applying the gains and metering the output runs four frames at a
+		// time, straight from the mirrored ring.
+		for (size_t c = 0; c < channels; c++) {
+			const float *in = delay[c].data() + readPos;
+			float *out = planes[c] + done;
+			__m128 high = _mm_setzero_ps();
+			__m128 sum = _mm_setzero_ps();
+			size_t i = 0;
+
+			for (; i + 4 <= count; i += 4) {
+				__m128 value = _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(gains + i));
+				_mm_storeu_ps(out + i, value);
+
+				high = _mm_max_ps(high, absolute(value));
+				sum = _mm_add_ps(sum, _mm_mul_ps(value, value));
+			}
+
+			alignas(16) float sums[4];
+			_mm_store_ps(sums, sum);
+
+			float peak = horizontalMax(high);
+			double squares = (double)sums[0] + sums[1] + sums[2] + sums[3];
+
+			for (; i < count; i++) {
+				float value = in[i] * gains[i];
+				out[i] = value;
+
+				peak = std::max(peak, std::fabs(value));
+				squares += (double)value * value;
+			}
+
+			peaks[c] = std::max(peaks[c], peak);
+			sumSquares[c] += squares;
+		}
+
+		delayPos = (delayPos + count) & delayMask;
+		done += count;
+	}
+}
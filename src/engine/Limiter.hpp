@@ -0,0 +1,75 @@
+#pragma once
+
+#include <util/sse-intrin.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lookahead true-peak limiter for the master of a soundboard bus. Peaks are
+// estimated between samples with 4x oversampling, and the gain is brought
+// down over the lookahead window, so the output never goes over the
+// ceiling. The audio is delayed by the lookahead time and the delay of the
+// interpolation filter.
+class Limiter {
+	static constexpr size_t historyFrames = 8;
+	// The interpolated points lie between the 4th and 5th newest samples,
+	// the newest of the two is this many frames old.
+	static constexpr size_t filterDelay = 3;
+	// Frames handled per pass, the gains of a pass are kept on the stack.
+	static constexpr size_t chunkFrames = 256;
+
+	size_t channels;
+	size_t lookahead;
+	// Frames from the newest sample to the one that is output.
+	size_t delayFrames;
+	float ceiling;
+	float release;
+
+	// Column k holds the taps of the three interpolation filters for the
+	// kth sample of the history, and in the last lane the newest of the two
+	// samples they lie between. One pass over the history gives every point
+	// of the segment.
+	__m128 taps[historyFrames];
+
+	// Power of two rings, written twice so the history and the output of a
+	// pass can be read without wrapping.
+	std::vector<std::vector<float>> delay;
+	size_t delayMask = 0;
+	size_t delayPos = 0;
+
+	// Sliding minimum of the required gain, a power of two ring of (frame,
+	// gain) pairs with increasing gains.
+	std::vector<uint64_t> minFrames;
+	std::vector<float> minGains;
+	size_t minMask = 0;
+	size_t minHead = 0;
+	size_t minCount = 0;
+
+	std::vector<float> smoothed;
+	size_t smoothedPos = 0;
+	double smoothedSum = 0.0;
+
+	float envelope = 1.0f;
+	uint64_t frame = 0;
+
+	// Level of the output of the last call, per channel.
+	std::vector<float> peaks;
+	std::vector<double> sumSquares;
+	size_t meteredFrames = 0;
+
+	float segmentPeak(size_t pos) const;
+	float minimumGain(float gain);
+	float nextGain(float peak);
+
+public:
+	Limiter(uint32_t sampleRate, size_t channels, float ceilingDb = -1.0f, float lookaheadMs = 1.5f,
+		float releaseMs = 60.0f);
+
+	size_t getLatency() const { return delayFrames; }
+
+	void process(float *const *planes, size_t frames);
+
+	float getPeak(size_t channel) const { return peaks[channel]; }
+	float getRms(size_t channel) const;
+};
@@ -0,0 +1,188 @@
+#include "MappedFile.hpp"
+
+#include <util/platform.h>
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+namespace {
+// The SIGBUS handler cannot take a lock, so the mappings it may patch are
+// kept in a fixed table of atomics. Files that find the table full are read
+// into memory instead.
+constexpr size_t maxMappings = 4096;
+
+struct MappedRange {
+	std::atomic<uintptr_t> begin = 0;
+	std::atomic<uintptr_t> end = 0;
+};
+
+MappedRange ranges[maxMappings];
+std::mutex rangesMutex;
+size_t rangeCount = 0;
+struct sigaction previousAction;
+
+size_t getPageSize()
+{
+	static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	return pageSize;
+}
+
+void onBusError(int sig, siginfo_t *info, void *context)
+{
+	uintptr_t address = (uintptr_t)info->si_addr;
+
+	for (MappedRange &range : ranges) {
+		uintptr_t begin = range.begin.load(std::memory_order_acquire);
+		uintptr_t end = range.end.load(std::memory_order_acquire);
+
+		if (!begin || address < begin || address >= end)
+			continue;
+
+		// The file got shorter than its mapping, so every page from this
+		// one on is past its end. Zeros are mapped over them and the read
+		// is retried.
+		uintptr_t page = address & ~(uintptr_t)(getPageSize() - 1);
+		void *zeros = mmap((void *)page, end - page, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+
+		if (zeros != MAP_FAILED)
+			return;
+
+		break;
+	}
+
+	// Not a mapped clip, whoever handled the signal before gets it. Going
+	// back to the default action lets the retried access end the process.
+	if (previousAction.sa_flags & SA_SIGINFO) {
+		previousAction.sa_sigaction(sig, info, context);
+	} else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN) {
+		previousAction.sa_handler(sig);
+	} else {
+		struct sigaction action = {};
+		action.sa_handler = SIG_DFL;
+		sigaction(SIGBUS, &action, nullptr);
+	}
+}
+
+// The handler is only installed while clips are mapped, so it is gone
+// before the module is unloaded.
+bool addRange(uintptr_t begin, uintptr_t end)
+{
+	std::lock_guard<std::mutex> lock(rangesMutex);
+
+	for (MappedRange &range : ranges) {
+		if (range.begin.load(std::memory_order_relaxed))
+			continue;
+
+		if (rangeCount++ == 0) {
+			struct sigaction action = {};
+			action.sa_sigaction = onBusError;
+			action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+			sigemptyset(&action.sa_mask);
+			sigaction(SIGBUS, &action, &previousAction);
+		}
+
+		range.end.store(end, std::memory_order_release);
+		range.begin.store(begin, std::memory_order_release);
+		return true;
+	}
+
+	return false;
+}
+
+void removeRange(uintptr_t begin)
+{
+	std::lock_guard<std::mutex> lock(rangesMutex);
+
+	for (MappedRange &range : ranges) {
+		if (range.begin.load(std::memory_order_relaxed) != begin)
+			continue;
+
+		range.begin.store(0, std::memory_order_release);
+		range.end.store(0, std::memory_order_release);
+
+		if (--rangeCount == 0)
+			sigaction(SIGBUS, &previousAction, nullptr);
+
+		return;
+	}
+}
+} // namespace
+#endif
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+	if (base) {
+		removeRange((uintptr_t)base);
+		munmap(base, mapped);
+	}
+#endif
+}
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string &path, uint64_t offset, size_t length)
+{
+	if (!length)
+		return nullptr;
+
+	std::unique_ptr<MappedFile> file(new MappedFile());
+
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return nullptr;
+
+	// Mappings start on a page, the samples rarely do.
+	uint64_t start = offset & ~(uint64_t)(getPageSize() - 1);
+	size_t skip = (size_t)(offset - start);
+	size_t pages = (skip + length + getPageSize() - 1) & ~(getPageSize() - 1);
+	int flags = MAP_PRIVATE;
+
+#ifdef MAP_POPULATE
+	// The pages are read in now on the decode thread, not on the audio
+	// thread the first time the clip plays.
+	flags |= MAP_POPULATE;
+#endif
+
+	void *base = mmap(nullptr, pages, PROT_READ, flags, fd, (off_t)start);
+	close(fd);
+
+	if (base != MAP_FAILED) {
+		if (addRange((uintptr_t)base, (uintptr_t)base + pages)) {
+			file->base = base;
+			file->mapped = pages;
+			file->data = static_cast<const uint8_t *>(base) + skip;
+			file->size = length;
+			return file;
+		}
+
+		munmap(base, pages);
+	}
+#endif
+
+	FILE *stream = os_fopen(path.c_str(), "rb");
+
+	if (!stream)
+		return nullptr;
+
+	file->bytes.resize(length);
+	os_fseeki64(stream, (int64_t)offset, SEEK_SET);
+	file->bytes.resize(fread(file->bytes.data(), 1, length, stream));
+	fclose(stream);
+
+	if (file->bytes.empty())
+		return nullptr;
+
+	file->data = file->bytes.data();
+	file->size = file->bytes.size();
+	return file;
+}
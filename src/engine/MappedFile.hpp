@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read only view of a range of a file, holding the samples of an
+// uncompressed clip.
+//
+// On POSIX systems the range is mapped privately and the file is closed
+// right away, so it can be renamed, replaced or deleted while the clip plays.
+// A file truncated in place would make reading its lost pages raise SIGBUS.
+// Those pages are mapped to zeros instead and play as silence until the clip
+// cache reloads the file and swaps the clip.
+//
+// Windows keeps a mapped file from being replaced, so there the range is read
+// into memory instead.
+class MappedFile {
+	const uint8_t *data = nullptr;
+	size_t size = 0;
+	void *base = nullptr;
+	size_t mapped = 0;
+	std::vector<uint8_t> bytes;
+
+	MappedFile() = default;
+
+public:
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// Returns nullptr if the range cannot be mapped or read. A read copy
+	// stops at the end of the file.
+	static std::unique_ptr<MappedFile> open(const std::string &path, uint64_t offset, size_t size);
+
+	const uint8_t *getData() const { return data; }
+	size_t getSize() const { return size; }
+	// False if the bytes were read into memory of their own.
+	bool isMapped() const { return base != nullptr; }
+};
@@ -0,0 +1,347 @@
+#include "MixKernels.hpp"
+
+#include <util/sse-intrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+float horizontalMax(__m128 v)
+{
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+float horizontalSum(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+// Mixes every channel of four frames in one pass of the loop, so the channel
+// loop is unrolled for the layout and the meter stays in registers for the
+// whole call instead of being reduced once per channel.
+template<size_t Channels>
+void mixChannels(float *const *dst, size_t dstOffset, const AudioBuffer &src, size_t srcOffset, size_t count,
+		 float gain, MeterSums &meter)
+{
+	float *out[Channels];
+	const float *in[Channels];
+
+	for (size_t c = 0; c < Channels; c++) {
+		out[c] = dst[c] + dstOffset;
+		in[c] = src.channel(c) + srcOffset;
+	}
+
+	const __m128 g = _mm_set1_ps(gain);
+	__m128 high = _mm_setzero_ps();
+	__m128 low = _mm_setzero_ps();
+	__m128 sum = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		for (size_t c = 0; c < Channels; c++) {
+			__m128 a = _mm_mul_ps(_mm_loadu_ps(in[c] + i), g);
+
+			high = _mm_max_ps(high, a);
+			low = _mm_min_ps(low, a);
+			sum = _mm_add_ps(sum, _mm_mul_ps(a, a));
+
+			_mm_storeu_ps(out[c] + i, _mm_add_ps(_mm_loadu_ps(out[c] + i), a));
+		}
+	}
+
+	float peakValue = horizontalMax(_mm_max_ps(high, _mm_sub_ps(_mm_setzero_ps(), low)));
+	float sumValue = horizontalSum(sum);
+
+	for (; i < count; i++) {
+		for (size_t c = 0; c < Channels; c++) {
+			float value = in[c][i] * gain;
+			peakValue = std::max(peakValue, std::fabs(value));
+			sumValue += value * value;
+			out[c][i] += value;
+		}
+	}
+
+	meter.peak = std::max(meter.peak, peakValue);
+	meter.sumSquares += sumValue;
+	meter.samples += count * Channels;
+}
+
+void mixGeneric(float *const *dst, size_t dstOffset, const AudioBuffer &src, size_t srcOffset, size_t count,
+		float gain, MeterSums &meter)
+{
+	for (size_t c = 0; c < src.channels(); c++)
+		mixScaled(dst[c] + dstOffset, src.channel(c) + srcOffset, count, gain, meter);
+}
+
+// mixChannels for interleaved samples. Stereo splits two loads into its
+// channels with shuffles, wider layouts gather each channel at its stride.
+template<size_t Channels>
+void mixStrided(float *const *dst, size_t dstOffset, const float *src, size_t count, float gain, MeterSums &meter)
+{
+	float *out[Channels];
+
+	for (size_t c = 0; c < Channels; c++)
+		out[c] = dst[c] + dstOffset;
+
+	const __m128 g = _mm_set1_ps(gain);
+	__m128 high = _mm_setzero_ps();
+	__m128 low = _mm_setzero_ps();
+	__m128 sum = _mm_setzero_ps();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		const float *frames = src + i * Channels;
+		__m128 values[Channels];
+
+		if constexpr (Channels == 2) {
+			__m128 a = _mm_loadu_ps(frames);
+			__m128 b = _mm_loadu_ps(frames + 4);
+			values[0] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			values[1] = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		} else {
+			for (size_t c = 0; c < Channels; c++)
+				values[c] = _mm_setr_ps(frames[c], frames[Channels + c], frames[2 * Channels + c],
+							frames[3 * Channels + c]);
+		}
+
+		for (size_t c = 0; c < Channels; c++) {
+			__m128 a = _mm_mul_ps(values[c], g);
+
+			high = _mm_max_ps(high, a);
+			low = _mm_min_ps(low, a);
+			sum = _mm_add_ps(sum, _mm_mul_ps(a, a));
+
+			_mm_storeu_ps(out[c] + i, _mm_add_ps(_mm_loadu_ps(out[c] + i), a));
+		}
+	}
+
+	float peakValue = horizontalMax(_mm_max_ps(high, _mm_sub_ps(_mm_setzero_ps(), low)));
+	float sumValue = horizontalSum(sum);
+
+	for (; i < count; i++) {
+		for (size_t c = 0; c < Channels; c++) {
+			float value = src[i * Channels + c] * gain;
+			peakValue = std::max(peakValue, std::fabs(value));
+			sumValue += value * value;
+			out[c][i] += value;
+		}
+	}
+
+	meter.peak = std::max(meter.peak, peakValue);
+	meter.sumSquares += sumValue;
+	meter.samples += count * Channels;
+}
+
+void mixStridedGeneric(float *const *dst, size_t dstOffset, const float *src, size_t channels, size_t count,
+		       float gain, MeterSums &meter)
+{
+	float peakValue = 0.0f;
+	double sumValue = 0.0;
+
+	for (size_t c = 0; c < channels; c++) {
+		float *out = dst[c] + dstOffset;
+
+		for (size_t i = 0; i < count; i++) {
+			float value = src[i * channels + c] * gain;
+			peakValue = std::max(peakValue, std::fabs(value));
+			sumValue += value * value;
+			out[i] += value;
+		}
+	}
+
+	meter.peak = std::max(meter.peak, peakValue);
+	meter.sumSquares += sumValue;
+	meter.samples += count * channels;
+}
+
+void convertS16(float *out, const uint8_t *in, size_t samples, bool swap)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+	size_t i = 0;
+
+	// Duplicating every sample into both halves of a 32-bit lane and
+	// shifting it back down sign extends it.
+	for (; i + 8 <= samples; i += 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+
+		if (swap)
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	for (; i < samples; i++) {
+		const uint8_t *p = in + i * 2;
+		int16_t value = swap ? (int16_t)(p[0] << 8 | p[1]) : (int16_t)(p[0] | p[1] << 8);
+		out[i] = (float)value * (1.0f / 32768.0f);
+	}
+}
+
+void convertS24(float *out, const uint8_t *in, size_t samples, bool swap)
+{
+	const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+	const __m128i lane0 = _mm_set_epi32(0, 0, 0, -256);
+	const __m128i lane1 = _mm_set_epi32(0, 0, -256, 0);
+	const __m128i lane2 = _mm_set_epi32(0, -256, 0, 0);
+	const __m128i lane3 = _mm_set_epi32(-256, 0, 0, 0);
+	const __m128i middle = _mm_set1_epi32(0x00FF0000);
+	const __m128i high = _mm_set1_epi32((int)0xFF000000);
+	const __m128i low = _mm_set1_epi32(0x0000FF00);
+	size_t i = 0;
+
+	// Four samples are spread from 12 bytes into the top three bytes of
+	// each 32-bit lane, which scales them to the full 32-bit range. The load
+	// reads 16 bytes, so the loop stops two samples short of the end.
+	for (; i + 6 <= samples; i += 4) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 3));
+		__m128i bits = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 1), lane0),
+							 _mm_and_si128(_mm_slli_si128(v, 2), lane1)),
+					    _mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 3), lane2),
+							 _mm_and_si128(_mm_slli_si128(v, 4), lane3)));
+
+		// Big endian samples have their first and last byte swapped.
+		if (swap)
+			bits = _mm_or_si128(_mm_and_si128(bits, middle),
+					    _mm_or_si128(_mm_and_si128(_mm_slli_epi32(bits, 16), high),
+							 _mm_and_si128(_mm_srli_epi32(bits, 16), low)));
+
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(bits), scale));
+	}
+
+	for (; i < samples; i++) {
+		const uint8_t *p = in + i * 3;
+		uint32_t bits = swap ? (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8
+				     : (uint32_t)p[2] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[0] << 8;
+
+		out[i] = (float)((int32_t)bits >> 8) * (1.0f / 8388608.0f);
+	}
+}
+
+void convertSamples(float *out, const uint8_t *in, size_t samples, PcmFormat format)
+{
+	switch (format) {
+	case PcmFormat::S16LE:
+		convertS16(out, in, samples, false);
+		break;
+	case PcmFormat::S16BE:
+		convertS16(out, in, samples, true);
+		break;
+	case PcmFormat::S24LE:
+		convertS24(out, in, samples, false);
+		break;
+	case PcmFormat::S24BE:
+		convertS24(out, in, samples, true);
+		break;
+	case PcmFormat::F32LE:
+		memcpy(out, in, samples * sizeof(float));
+		break;
+	}
+}
+
+} // namespace
+
+void mixScaled(float *dst, const float *src, size_t count, float gain, MeterSums &meter)
+{
+	const __m128 g = _mm_set1_ps(gain);
+	__m128 high = _mm_setzero_ps();
+	__m128 low = _mm_setzero_ps();
+	__m128 sum = _mm_setzero_ps();
+	size_t i = 0;
+
+	// Two registers per iteration keeps both the multiply and the add busy.
+	// The scaled samples are metered while they are still in registers.
+	for (; i + 8 <= count; i += 8) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), g);
+
+		high = _mm_max_ps(high, _mm_max_ps(a, b));
+		low = _mm_min_ps(low, _mm_min_ps(a, b));
+		sum = _mm_add_ps(sum, _mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)));
+
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), a));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), b));
+	}
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), g);
+
+		high = _mm_max_ps(high, a);
+		low = _mm_min_ps(low, a);
+		sum = _mm_add_ps(sum, _mm_mul_ps(a, a));
+
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), a));
+	}
+
+	float peakValue = horizontalMax(_mm_max_ps(high, _mm_sub_ps(_mm_setzero_ps(), low)));
+	float sumValue = horizontalSum(sum);
+
+	for (; i < count; i++) {
+		float value = src[i] * gain;
+		float magnitude = value < 0.0f ? -value : value;
+
+		if (magnitude > peakValue)
+			peakValue = magnitude;
+
+		sumValue += value * value;
+		dst[i] += value;
+	}
+
+	if (peakValue > meter.peak)
+		meter.peak = peakValue;
+
+	meter.sumSquares += sumValue;
+	meter.samples += count;
+}
+
+void mixInterleaved(float *const *dst, size_t dstOffset, const float *src, size_t channels, size_t count,
+		    float gain, MeterSums &meter)
+{
+	switch (channels) {
+	case 1:
+		mixScaled(dst[0] + dstOffset, src, count, gain, meter);
+		break;
+	case 2:
+		mixStrided<2>(dst, dstOffset, src, count, gain, meter);
+		break;
+	case 6:
+		mixStrided<6>(dst, dstOffset, src, count, gain, meter);
+		break;
+	case 8:
+		mixStrided<8>(dst, dstOffset, src, count, gain, meter);
+		break;
+	default:
+		mixStridedGeneric(dst, dstOffset, src, channels, count, gain, meter);
+		break;
+	}
+}
+
+void convertPcm(float *dst, const AudioBuffer &src, size_t offset, size_t count)
+{
+	size_t frameBytes = sampleSize(src.pcmFormat) * src.pcmChannels;
+	convertSamples(dst, src.pcmData() + offset * frameBytes, count * src.pcmChannels, src.pcmFormat);
+}
+
+MixKernel getMixKernel(size_t channels)
+{
+	switch (channels) {
+	case 1:
+		return mixChannels<1>;
+	case 2:
+		return mixChannels<2>;
+	case 6:
+		return mixChannels<6>;
+	case 8:
+		return mixChannels<8>;
+	}
+
+	return mixGeneric;
+}
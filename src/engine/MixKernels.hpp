@@ -0,0 +1,36 @@
+#pragma once
+
+#include "AudioBuffer.hpp"
+
+#include <cstddef>
+
+// Level of the samples a kernel added, accumulated while they are summed.
+struct MeterSums {
+	float peak = 0.0f;
+	double sumSquares = 0.0;
+	size_t samples = 0;
+};
+
+// Adds count frames of every channel of src, starting at srcOffset, to the
+// planes of dst starting at dstOffset, scaled by gain. dst must have as many
+// planes as src has channels. The level of the scaled samples is added to
+// meter.
+using MixKernel = void (*)(float *const *dst, size_t dstOffset, const AudioBuffer &src, size_t srcOffset,
+			   size_t count, float gain, MeterSums &meter);
+
+// Returns a kernel specialized for the channel count (mono, stereo, 5.1 and
+// 7.1), or a generic one for any other layout.
+MixKernel getMixKernel(size_t channels);
+
+// dst[i] += src[i] * gain, metering src[i] * gain
+void mixScaled(float *dst, const float *src, size_t count, float gain, MeterSums &meter);
+
+// Adds count frames of interleaved samples with the given channel count to
+// the planes of dst starting at dstOffset, scaled by gain. Specialized like
+// getMixKernel.
+void mixInterleaved(float *const *dst, size_t dstOffset, const float *src, size_t channels, size_t count,
+		    float gain, MeterSums &meter);
+
+// Converts count frames of an uncompressed buffer, starting at frame offset,
+// to interleaved float.
+void convertPcm(float *dst, const AudioBuffer &src, size_t offset, size_t count);
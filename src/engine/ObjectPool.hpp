@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed capacity pool of objects addressed by index. All storage is
+// allocated up front, acquiring and releasing only moves indices on a free
+// list, so the pool can be used on the audio thread. Only one thread may
+// acquire and release, the usage counters can be read from any thread.
+template<typename T> class ObjectPool {
+	std::vector<T> items;
+	std::vector<uint32_t> freeList;
+
+	std::atomic<size_t> highWater = 0;
+	std::atomic<uint64_t> exhausted = 0;
+
+public:
+	static constexpr uint32_t invalid = UINT32_MAX;
+
+	explicit ObjectPool(size_t capacity) : items(capacity)
+	{
+		freeList.reserve(capacity);
+
+		for (size_t i = capacity; i > 0; i--)
+			freeList.push_back((uint32_t)(i - 1));
+	}
+
+	// Returns the index of a free object, or invalid when the pool is
+	// exhausted.
+	uint32_t acquire()
+	{
+		if (freeList.empty()) {
+			exhausted.fetch_add(1, std::memory_order_relaxed);
+			return invalid;
+		}
+
+		uint32_t index = freeList.back();
+		freeList.pop_back();
+
+		size_t used = items.size() - freeList.size();
+
+		if (used > highWater.load(std::memory_order_relaxed))
+			highWater.store(used, std::memory_order_relaxed);
+
+		return index;
+	}
+
+	void release(uint32_t index)
+	{
+		items[index] = T();
+		freeList.push_back(index);
+	}
+
+	T &operator[](size_t index) { return items[index]; }
+	const T &operator[](size_t index) const { return items[index]; }
+
+	size_t capacity() const { return items.size(); }
+	size_t used() const { return items.size() - freeList.size(); }
+
+	size_t getHighWater() const { return highWater.load(std::memory_order_relaxed); }
+	uint64_t getExhausted() const { return exhausted.load(std::memory_order_relaxed); }
+};
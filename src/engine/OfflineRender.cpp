@@ -0,0 +1,355 @@
+#include "OfflineRender.hpp"
+
+#include <obs-module.h>
+#include <obs.hpp>
+#include <media-io/audio-io.h>
+#include <util/platform.h>
+#include <util/util_uint64.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace {
+// Timestamp of the first rendered frame. A timestamp of 0 means "now" to the
+// engine, so the timeline starts one second in.
+constexpr uint64_t timelineStart = 1000000000ULL;
+
+// Longest render when the length is not given, so a looping sound can not
+// render forever.
+constexpr uint64_t maxAutoDurationMs = 60 * 60 * 1000;
+
+constexpr uint64_t fnvOffset = 14695981039346656037ULL;
+constexpr uint64_t fnvPrime = 1099511628211ULL;
+
+void writeU16(FILE *file, uint16_t value)
+{
+	uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+	fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+void writeU32(FILE *file, uint32_t value)
+{
+	uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+	fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+// Writes the header of a WAVE_FORMAT_IEEE_FLOAT file. It is written again
+// with the real sizes once the render is done.
+void writeWavHeader(FILE *file, uint32_t sampleRate, size_t channels, uint64_t frames)
+{
+	uint32_t blockAlign = (uint32_t)(channels * sizeof(float));
+	uint32_t dataSize = (uint32_t)std::min<uint64_t>(frames * blockAlign, UINT32_MAX - 36);
+
+	fwrite("RIFF", 1, 4, file);
+	writeU32(file, 36 + dataSize);
+	fwrite("WAVE", 1, 4, file);
+	fwrite("fmt ", 1, 4, file);
+	writeU32(file, 16);
+	writeU16(file, 3);
+	writeU16(file, (uint16_t)channels);
+	writeU32(file, sampleRate);
+	writeU32(file, sampleRate * blockAlign);
+	writeU16(file, (uint16_t)blockAlign);
+	writeU16(file, 32);
+	fwrite("data", 1, 4, file);
+	writeU32(file, dataSize);
+}
+
+bool reportProgress(const OfflineRenderSettings &settings, uint64_t frames, uint64_t totalFrames)
+{
+	return !settings.progress || settings.progress(frames, totalFrames);
+}
+
+bool waitForClips(const std::vector<std::shared_ptr<ClipEntry>> &clips, const OfflineRenderSettings &settings,
+		  OfflineRenderResult &result)
+{
+	for (const std::shared_ptr<ClipEntry> &clip : clips) {
+		while (clip->getState() == ClipEntry::State::Pending) {
+			if (!reportProgress(settings, 0, 0)) {
+				result.canceled = true;
+				result.error = "Canceled";
+				return false;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		if (clip->getState() != ClipEntry::State::Ready) {
+			result.error = "Failed to decode '" + clip->getPath() + "'";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Frames until the last sound that does not loop has ended.
+uint64_t expectedFrames(const std::vector<OfflineTrigger> &triggers,
+			const std::vector<std::shared_ptr<ClipEntry>> &clips, uint32_t sampleRate)
+{
+	uint64_t frames = 0;
+
+	for (size_t i = 0; i < triggers.size(); i++) {
+		const AudioBuffer *buffer = clips[i]->getBuffer();
+
+		if (triggers[i].options.loop || !buffer)
+			continue;
+
+		frames = std::max(frames, util_mul_div64(triggers[i].timeMs, sampleRate, 1000) + buffer->frames);
+	}
+
+	return frames;
+}
+
+std::string scriptDirectory(const std::string &path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+bool isAbsolutePath(const std::string &path)
+{
+	if (path.empty())
+		return false;
+
+	// Drive letters and UNC paths on Windows.
+	if (path[0] == '/' || path[0] == '\\')
+		return true;
+
+	return path.size() > 2 && path[1] == ':' && (path[2] == '/' || path[2] == '\\');
+}
+} // namespace
+
+bool loadRenderScript(const std::string &path, RenderScript &script, std::string &error)
+{
+	OBSDataAutoRelease data = obs_data_create_from_json_file(path.c_str());
+
+	if (!data) {
+		error = "Failed to read '" + path + "'";
+		return false;
+	}
+
+	obs_data_set_default_int(data, "sample_rate", 48000);
+	obs_data_set_default_int(data, "channels", 2);
+	obs_data_set_default_int(data, "block_frames", 1024);
+	obs_data_set_default_double(data, "grid_beats", 1.0);
+
+	OfflineRenderSettings &settings = script.settings;
+	settings.sampleRate = (uint32_t)obs_data_get_int(data, "sample_rate");
+	settings.channels = (size_t)obs_data_get_int(data, "channels");
+	settings.blockFrames = (size_t)obs_data_get_int(data, "block_frames");
+	settings.durationMs = (uint64_t)std::max<long long>(obs_data_get_int(data, "duration_ms"), 0);
+	settings.tempo = obs_data_get_double(data, "tempo");
+	settings.gridBeats = obs_data_get_double(data, "grid_beats");
+
+	script.expectedHash = obs_data_get_string(data, "expected_hash");
+	std::transform(script.expectedHash.begin(), script.expectedHash.end(), script.expectedHash.begin(),
+		       [](char c) { return (char)std::tolower((unsigned char)c); });
+
+	std::string dir = scriptDirectory(path);
+	OBSDataArrayAutoRelease array = obs_data_get_array(data, "triggers");
+	size_t count = obs_data_array_count(array);
+
+	script.triggers.clear();
+
+	for (size_t i = 0; i < count; i++) {
+		OBSDataAutoRelease item = obs_data_array_item(array, i);
+		obs_data_set_default_double(item, "gain", 1.0);
+
+		OfflineTrigger trigger;
+		trigger.path = obs_data_get_string(item, "path");
+		trigger.sound = obs_data_get_string(item, "sound");
+		trigger.timeMs = (uint64_t)std::max<long long>(obs_data_get_int(item, "time_ms"), 0);
+		trigger.options.gain = (float)obs_data_get_double(item, "gain");
+		trigger.options.loop = obs_data_get_bool(item, "loop");
+		trigger.options.quantize = obs_data_get_bool(item, "quantize");
+		bool overlap = strcmp(obs_data_get_string(item, "mode"), "overlap") == 0;
+		trigger.options.mode = overlap ? TriggerMode::Overlap : TriggerMode::Replace;
+
+		if (trigger.path.empty() && trigger.sound.empty()) {
+			error = "Trigger " + std::to_string(i) + " has neither a path nor a sound";
+			return false;
+		}
+
+		if (!trigger.path.empty() && !isAbsolutePath(trigger.path))
+			trigger.path = dir + trigger.path;
+
+		script.triggers.push_back(std::move(trigger));
+	}
+
+	return true;
+}
+
+std::string formatRenderHash(uint64_t hash)
+{
+	char text[17];
+	snprintf(text, sizeof(text), "%016" PRIx64, hash);
+	return text;
+}
+
+OfflineRenderResult renderOffline(const std::vector<OfflineTrigger> &triggers, const OfflineRenderSettings &settings,
+				  const std::string &wavPath)
+{
+	OfflineRenderResult result;
+
+	if (!settings.sampleRate || !settings.channels || settings.channels > MAX_AUDIO_CHANNELS ||
+	    !settings.blockFrames) {
+		result.error = "Invalid render format";
+		return result;
+	}
+
+	// A shared cache only helps if its clips are decoded to the format of
+	// the render.
+	ClipCache *cache = settings.cache;
+	std::unique_ptr<ClipCache> ownCache;
+
+	if (!cache || cache->getSampleRate() != settings.sampleRate || cache->getChannels() != settings.channels) {
+		ownCache = std::make_unique<ClipCache>(settings.sampleRate, settings.channels);
+		cache = ownCache.get();
+	}
+
+	// Every clip is decoded before the first block, so the output never
+	// depends on how fast the decoder was.
+	std::vector<std::shared_ptr<ClipEntry>> clips;
+
+	for (const OfflineTrigger &trigger : triggers)
+		clips.push_back(cache->acquire(trigger.path));
+
+	if (!waitForClips(clips, settings, result))
+		return result;
+
+	std::vector<size_t> order(triggers.size());
+
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(),
+			 [&triggers](size_t a, size_t b) { return triggers[a].timeMs < triggers[b].timeMs; });
+
+	FILE *file = os_fopen(wavPath.c_str(), "wb");
+
+	if (!file) {
+		result.error = "Failed to open '" + wavPath + "' for writing";
+		return result;
+	}
+
+	EngineConfig config = settings.config;
+	config.maxFrames = std::max(config.maxFrames, settings.blockFrames);
+	config.clock = nullptr;
+
+	PlaybackEngine engine(settings.sampleRate, settings.channels, config);
+
+	if (settings.tempo > 0.0) {
+		EngineCommand cmd;
+		cmd.type = EngineCommand::Type::SetTempo;
+		cmd.tempo = settings.tempo;
+		cmd.gridBeats = settings.gridBeats;
+		engine.submit(std::move(cmd));
+	}
+
+	uint64_t durationMs = settings.durationMs ? settings.durationMs : maxAutoDurationMs;
+	uint64_t totalFrames = util_mul_div64(durationMs, settings.sampleRate, 1000);
+
+	// Without a length the render ends with the last sound, unless a sound
+	// loops.
+	uint64_t progressFrames = totalFrames;
+
+	if (!settings.durationMs) {
+		uint64_t frames = expectedFrames(triggers, clips, settings.sampleRate);
+
+		if (frames)
+			progressFrames = std::min(frames, totalFrames);
+	}
+
+	std::vector<float> planes(settings.channels * settings.blockFrames);
+	std::vector<float> interleaved(settings.channels * settings.blockFrames);
+	float *out[MAX_AUDIO_CHANNELS] = {};
+
+	for (size_t c = 0; c < settings.channels; c++)
+		out[c] = planes.data() + c * settings.blockFrames;
+
+	writeWavHeader(file, settings.sampleRate, settings.channels, 0);
+
+	uint64_t hash = fnvOffset;
+	size_t next = 0;
+
+	while (result.frames < totalFrames) {
+		size_t frames = (size_t)std::min<uint64_t>(settings.blockFrames, totalFrames - result.frames);
+		uint64_t timestamp = timelineStart + util_mul_div64(result.frames, 1000000000ULL, settings.sampleRate);
+		uint64_t blockEnd =
+			timelineStart + util_mul_div64(result.frames + frames, 1000000000ULL, settings.sampleRate);
+
+		// Submit the triggers that start in this block, the engine places
+		// them on the exact frame.
+		while (next < order.size()) {
+			const OfflineTrigger &trigger = triggers[order[next]];
+			uint64_t triggerTime = timelineStart + trigger.timeMs * 1000000ULL;
+
+			if (triggerTime >= blockEnd)
+				break;
+
+			EngineCommand cmd;
+			cmd.type = EngineCommand::Type::Play;
+			cmd.clip = clips[order[next]];
+			cmd.options = trigger.options;
+			cmd.options.timestamp = triggerTime;
+			cmd.options.triggerTime = 0;
+
+			if (!engine.submit(std::move(cmd))) {
+				result.error = "Too many triggers in one block";
+				break;
+			}
+
+			next++;
+		}
+
+		if (!result.error.empty())
+			break;
+
+		engine.render(out, frames, timestamp);
+
+		for (size_t i = 0; i < frames; i++) {
+			for (size_t c = 0; c < settings.channels; c++)
+				interleaved[i * settings.channels + c] = out[c][i];
+		}
+
+		size_t bytes = frames * settings.channels * sizeof(float);
+		const uint8_t *data = reinterpret_cast<const uint8_t *>(interleaved.data());
+
+		for (size_t i = 0; i < bytes; i++)
+			hash = (hash ^ data[i]) * fnvPrime;
+
+		if (fwrite(data, 1, bytes, file) != bytes) {
+			result.error = "Failed to write '" + wavPath + "'";
+			break;
+		}
+
+		result.frames += frames;
+
+		if (!settings.durationMs && next == order.size() && !engine.getSnapshot().activeVoices)
+			break;
+
+		if (!reportProgress(settings, result.frames, std::max(progressFrames, result.frames))) {
+			result.canceled = true;
+			result.error = "Canceled";
+			break;
+		}
+	}
+
+	fseek(file, 0, SEEK_SET);
+	writeWavHeader(file, settings.sampleRate, settings.channels, result.frames);
+	fclose(file);
+
+	if (result.canceled)
+		os_unlink(wavPath.c_str());
+
+	result.hash = hash;
+	result.success = result.error.empty();
+	return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "PlaybackEngine.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+struct OfflineTrigger {
+	std::string path;
+	// Name of a sound on the board, for scripts that play sounds by name.
+	// The caller resolves it to the path before rendering.
+	std::string sound;
+	// Time from the start of the render.
+	uint64_t timeMs = 0;
+	PlayOptions options;
+};
+
+struct OfflineRenderSettings {
+	uint32_t sampleRate = 48000;
+	size_t channels = 2;
+	size_t blockFrames = 1024;
+	// Length of the render, or 0 to stop once the last sound has ended.
+	uint64_t durationMs = 0;
+	double tempo = 0.0;
+	double gridBeats = 1.0;
+	EngineConfig config;
+	// Shared cache to decode the clips in, used if it has the format of the
+	// render. Otherwise the render decodes them in a cache of its own.
+	ClipCache *cache = nullptr;
+	// Called while the clips are decoded and after every block, with the
+	// frames rendered so far and the expected length. Returning false
+	// cancels the render. Called on the rendering thread.
+	std::function<bool(uint64_t frames, uint64_t totalFrames)> progress;
+};
+
+struct OfflineRenderResult {
+	bool success = false;
+	bool canceled = false;
+	std::string error;
+	uint64_t frames = 0;
+	// FNV-1a hash of the rendered samples, interleaved, as they are written
+	// to the file. Any change to the mixed output changes the hash.
+	uint64_t hash = 0;
+};
+
+// A trigger script, a JSON file with the render settings, the triggers and
+// optionally the hash the render is expected to have.
+struct RenderScript {
+	OfflineRenderSettings settings;
+	std::vector<OfflineTrigger> triggers;
+	std::string expectedHash;
+};
+
+// Reads a trigger script. Relative paths are resolved against the directory
+// of the script.
+bool loadRenderScript(const std::string &path, RenderScript &script, std::string &error);
+
+// The hash as it is written in scripts, 16 lowercase hex digits.
+std::string formatRenderHash(uint64_t hash);
+
+// Plays a list of triggers through its own engine as fast as possible and
+// writes the result as a 32-bit float WAV file. The engine runs on a
+// timeline of its own at a fixed block size, so the same triggers always
+// render the same samples. A canceled render removes the file.
+OfflineRenderResult renderOffline(const std::vector<OfflineTrigger> &triggers, const OfflineRenderSettings &settings,
+				  const std::string &wavPath);
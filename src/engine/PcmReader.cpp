@@ -0,0 +1,265 @@
+#include "PcmReader.hpp"
+#include "MappedFile.hpp"
+
+#include <util/platform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+// The chunks before the samples are looked for in this much of the start of
+// the file. Files with more metadata up front are decoded instead.
+constexpr size_t headerBytes = 64 * 1024;
+
+uint16_t readU16LE(const uint8_t *p)
+{
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+uint32_t readU32LE(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+uint64_t readU64LE(const uint8_t *p)
+{
+	return (uint64_t)readU32LE(p) | (uint64_t)readU32LE(p + 4) << 32;
+}
+
+uint16_t readU16BE(const uint8_t *p)
+{
+	return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+uint32_t readU32BE(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+// AIFF stores its sample rate as an 80-bit extended float.
+double readExtended(const uint8_t *p)
+{
+	int exponent = ((p[0] & 0x7F) << 8 | p[1]) - 16383 - 63;
+	uint64_t mantissa = (uint64_t)readU32BE(p + 2) << 32 | readU32BE(p + 6);
+	double value = std::ldexp((double)mantissa, exponent);
+
+	return (p[0] & 0x80) ? -value : value;
+}
+
+// Layout of the sample data that was found in a file.
+struct PcmLayout {
+	PcmFormat format = PcmFormat::S16LE;
+	uint32_t sampleRate = 0;
+	size_t channels = 0;
+	size_t offset = 0;
+	size_t bytes = 0;
+	bool valid = false;
+};
+
+bool pcmFormat(uint16_t tag, uint16_t bits, bool bigEndian, PcmFormat &format)
+{
+	if (tag == 1 && bits == 16)
+		format = bigEndian ? PcmFormat::S16BE : PcmFormat::S16LE;
+	else if (tag == 1 && bits == 24)
+		format = bigEndian ? PcmFormat::S24BE : PcmFormat::S24LE;
+	else if (tag == 3 && bits == 32 && !bigEndian)
+		format = PcmFormat::F32LE;
+	else
+		return false;
+
+	return true;
+}
+
+// Reads a WAVE fmt chunk, shared by RIFF and W64 files.
+bool readWaveFormat(const uint8_t *p, size_t size, PcmLayout &layout)
+{
+	if (size < 16)
+		return false;
+
+	uint16_t tag = readU16LE(p);
+	uint16_t bits = readU16LE(p + 14);
+
+	// WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub format GUID.
+	if (tag == 0xFFFE && size >= 40)
+		tag = readU16LE(p + 24);
+
+	layout.channels = readU16LE(p + 2);
+	layout.sampleRate = readU32LE(p + 4);
+
+	return pcmFormat(tag, bits, false, layout.format);
+}
+
+// The parsers walk the chunks in the first size bytes of the file, the
+// samples themselves can reach up to the end of the file.
+PcmLayout parseRiff(const uint8_t *data, size_t size, uint64_t fileSize)
+{
+	PcmLayout layout;
+	bool format = false;
+	size_t pos = 12;
+
+	while (pos + 8 <= size) {
+		const uint8_t *chunk = data + pos;
+		size_t chunkSize = readU32LE(chunk + 4);
+		size_t body = pos + 8;
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			format = readWaveFormat(data + body, std::min(chunkSize, size - body), layout);
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			layout.offset = body;
+			layout.bytes = (size_t)std::min<uint64_t>(chunkSize, fileSize - body);
+			layout.valid = format;
+			break;
+		}
+
+		pos = body + chunkSize + (chunkSize & 1);
+	}
+
+	return layout;
+}
+
+PcmLayout parseW64(const uint8_t *data, size_t size, uint64_t fileSize)
+{
+	PcmLayout layout;
+	bool format = false;
+	size_t pos = 40;
+
+	// Chunk sizes include the 24 byte GUID and size header, chunks are
+	// aligned to 8 bytes.
+	while (pos + 24 <= size) {
+		const uint8_t *chunk = data + pos;
+		uint64_t chunkSize = readU64LE(chunk + 16);
+		size_t body = pos + 24;
+
+		if (chunkSize < 24 || chunkSize > fileSize - pos)
+			chunkSize = fileSize - pos;
+
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			size_t available = (size_t)std::min<uint64_t>(chunkSize - 24, size - body);
+			format = readWaveFormat(data + body, available, layout);
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			layout.offset = body;
+			layout.bytes = (size_t)chunkSize - 24;
+			layout.valid = format;
+			break;
+		}
+
+		pos += ((size_t)chunkSize + 7) & ~(size_t)7;
+	}
+
+	return layout;
+}
+
+PcmLayout parseAiff(const uint8_t *data, size_t size, uint64_t fileSize)
+{
+	PcmLayout layout;
+	bool format = false;
+	bool aifc = memcmp(data + 8, "AIFC", 4) == 0;
+	size_t pos = 12;
+
+	while (pos + 8 <= size) {
+		const uint8_t *chunk = data + pos;
+		size_t chunkSize = readU32BE(chunk + 4);
+		size_t body = pos + 8;
+		size_t available = std::min(chunkSize, size - body);
+
+		if (memcmp(chunk, "COMM", 4) == 0 && available >= 18) {
+			const uint8_t *comm = data + body;
+			bool bigEndian = true;
+
+			// Of the AIFF-C compression types only uncompressed PCM in
+			// either byte order can be mixed directly.
+			if (aifc) {
+				if (available < 22)
+					break;
+				if (memcmp(comm + 18, "sowt", 4) == 0)
+					bigEndian = false;
+				else if (memcmp(comm + 18, "NONE", 4) != 0 && memcmp(comm + 18, "twos", 4) != 0)
+					break;
+			}
+
+			layout.channels = readU16BE(comm);
+			layout.sampleRate = (uint32_t)std::lround(readExtended(comm + 8));
+			format = pcmFormat(1, readU16BE(comm + 6), bigEndian, layout.format);
+		} else if (memcmp(chunk, "SSND", 4) == 0 && available >= 8) {
+			size_t skip = 8 + readU32BE(data + body);
+			uint64_t bytes = std::min<uint64_t>(chunkSize, fileSize - body);
+
+			if (skip > bytes)
+				break;
+
+			layout.offset = body + skip;
+			layout.bytes = (size_t)(bytes - skip);
+			layout.valid = format;
+			break;
+		}
+
+		pos = body + chunkSize + (chunkSize & 1);
+	}
+
+	return layout;
+}
+
+} // namespace
+
+std::shared_ptr<AudioBuffer> readPcmFile(const std::string &path, uint32_t sampleRate, size_t channels)
+{
+	FILE *file = os_fopen(path.c_str(), "rb");
+
+	if (!file)
+		return nullptr;
+
+	os_fseeki64(file, 0, SEEK_END);
+	int64_t fileSize = os_ftelli64(file);
+	os_fseeki64(file, 0, SEEK_SET);
+
+	std::vector<uint8_t> header((size_t)std::clamp<int64_t>(fileSize, 0, (int64_t)headerBytes));
+
+	if (header.size() < 44 || fread(header.data(), 1, header.size(), file) != header.size()) {
+		fclose(file);
+		return nullptr;
+	}
+
+	const uint8_t *data = header.data();
+	size_t size = header.size();
+	PcmLayout layout;
+
+	if ((memcmp(data, "RIFF", 4) == 0) && memcmp(data + 8, "WAVE", 4) == 0)
+		layout = parseRiff(data, size, (uint64_t)fileSize);
+	else if (memcmp(data, "riff", 4) == 0 && memcmp(data + 24, "wave", 4) == 0)
+		layout = parseW64(data, size, (uint64_t)fileSize);
+	else if (memcmp(data, "FORM", 4) == 0 && (memcmp(data + 8, "AIFF", 4) == 0 || memcmp(data + 8, "AIFC", 4) == 0))
+		layout = parseAiff(data, size, (uint64_t)fileSize);
+
+	size_t frameBytes = sampleSize(layout.format) * layout.channels;
+
+	// Anything that would need resampling or remixing goes through the
+	// decoder instead.
+	if (!layout.valid || layout.sampleRate != sampleRate || layout.channels != channels || !frameBytes ||
+	    layout.bytes < frameBytes) {
+		fclose(file);
+		return nullptr;
+	}
+
+	fclose(file);
+
+	// A file that got shorter since its size was taken plays what is left
+	// of it.
+	std::unique_ptr<MappedFile> samples =
+		MappedFile::open(path, layout.offset, layout.bytes - layout.bytes % frameBytes);
+	size_t frames = samples ? samples->getSize() / frameBytes : 0;
+
+	if (!frames)
+		return nullptr;
+
+	auto buffer = std::make_shared<AudioBuffer>();
+	buffer->sampleRate = sampleRate;
+	buffer->frames = frames;
+	buffer->pcm = std::move(samples);
+	buffer->pcmFormat = layout.format;
+	buffer->pcmChannels = layout.channels;
+
+	return buffer;
+}
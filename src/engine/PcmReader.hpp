@@ -0,0 +1,12 @@
+#pragma once
+
+#include "AudioBuffer.hpp"
+
+#include <memory>
+#include <string>
+
+// Reads the samples of an uncompressed WAV, W64 or AIFF file that already
+// has the given sample rate and channel count. The samples are kept in the
+// file's format and converted while they are mixed. Returns nullptr for
+// anything else, which then has to be decoded.
+std::shared_ptr<AudioBuffer> readPcmFile(const std::string &path, uint32_t sampleRate, size_t channels);
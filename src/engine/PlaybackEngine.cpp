@@ -0,0 +1,642 @@
+#include "PlaybackEngine.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+PlaybackEngine::PlaybackEngine(uint32_t sampleRate_, size_t channels_, const EngineConfig &config_)
+	: sampleRate(sampleRate_),
+	  channels(channels_),
+	  config(config_),
+	  mixKernel(getMixKernel(channels_)),
+	  limiter(sampleRate_, channels_),
+	  commands(256),
+	  scheduled(config_.maxScheduled),
+	  voices(config_.maxVoices),
+	  // The voice list and a block of converted samples, with room to align
+	  // both.
+	  arena(config_.maxVoices * sizeof(uint32_t) + config_.maxFrames * channels_ * sizeof(float) + 64)
+{
+	scheduledOrder.reserve(config.maxScheduled);
+	activeVoices.reserve(config.maxVoices);
+	queue.reserve(config.maxQueueItems);
+}
+
+bool PlaybackEngine::submit(EngineCommand &&cmd)
+{
+	return commands.push(std::move(cmd));
+}
+
+uint64_t PlaybackEngine::frameForTimestamp(uint64_t timestamp) const
+{
+	if (!timestamp || timestamp <= blockTimestamp)
+		return clock;
+
+	double offset = (double)(timestamp - blockTimestamp) * (double)sampleRate / 1000000000.0;
+	return clock + (uint64_t)std::llround(offset);
+}
+
+uint64_t PlaybackEngine::quantizeFrame(uint64_t frame)
+{
+	if (gridFrames <= 0.0)
+		return frame;
+
+	bool gridRunning = hasActiveVoices();
+
+	for (size_t i = 0; i < scheduledOrder.size() && !gridRunning; i++)
+		gridRunning = scheduled[scheduledOrder[i]].cmd.options.quantize;
+
+	// The first quantized sound on a silent board plays right away and
+	// defines where the grid starts.
+	if (!gridRunning) {
+		gridOrigin = frame;
+		return frame;
+	}
+
+	if (frame <= gridOrigin)
+		return gridOrigin;
+
+	double beats = (double)(frame - gridOrigin) / gridFrames;
+	double point = std::ceil(beats - 1e-9);
+
+	return gridOrigin + (uint64_t)std::llround(point * gridFrames);
+}
+
+void PlaybackEngine::schedule(EngineCommand &&cmd)
+{
+	uint64_t frame = clock;
+
+	if (cmd.type == EngineCommand::Type::Play || cmd.type == EngineCommand::Type::PlayLayers) {
+		frame = frameForTimestamp(cmd.options.timestamp);
+
+		if (cmd.options.quantize)
+			frame = quantizeFrame(frame);
+	}
+
+	// A full pool drops the command, the pool counts it as exhausted.
+	uint32_t index = scheduled.acquire();
+
+	if (index == ObjectPool<ScheduledCommand>::invalid)
+		return;
+
+	ScheduledCommand &entry = scheduled[index];
+	entry.frame = frame;
+	entry.sequence = sequence++;
+	entry.cmd = std::move(cmd);
+
+	// Commands for the same frame keep the order they were submitted in.
+	// The order list has room for the whole pool, so inserting never
+	// allocates.
+	auto pos = std::upper_bound(scheduledOrder.begin(), scheduledOrder.end(), frame,
+				    [this](uint64_t value, uint32_t other) { return value < scheduled[other].frame; });
+	scheduledOrder.insert(pos, index);
+}
+
+void PlaybackEngine::cancelScheduledPlays()
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < scheduledOrder.size(); i++) {
+		uint32_t index = scheduledOrder[i];
+		EngineCommand::Type type = scheduled[index].cmd.type;
+
+		if (type == EngineCommand::Type::Play || type == EngineCommand::Type::PlayLayers) {
+			scheduled.release(index);
+			continue;
+		}
+
+		scheduledOrder[count++] = index;
+	}
+
+	scheduledOrder.resize(count);
+}
+
+uint32_t PlaybackEngine::allocateVoice()
+{
+	uint32_t slot = voices.acquire();
+
+	// Steal the oldest voice when every voice is in use.
+	if (slot == noVoice) {
+		stopVoice(activeVoices.front());
+		slot = voices.acquire();
+	}
+
+	activeVoices.push_back(slot);
+	return slot;
+}
+
+void PlaybackEngine::startVoice(uint32_t slot, const QueueItem &item, bool loop, bool fromQueue)
+{
+	Voice &voice = voices[slot];
+	voice.clip = item.clip;
+	voice.buffer = nullptr;
+	voice.position = 0;
+	voice.startFrame = now;
+	voice.gain = item.gain;
+	voice.tag = item.tag;
+	voice.meter = MeterSums();
+	voice.triggerTime = 0;
+	voice.dequeueTime = 0;
+	voice.loop = loop;
+	voice.fromQueue = fromQueue;
+	voice.active = true;
+
+	primary = slot;
+	paused = false;
+	stopped = false;
+
+	lastPlay = item;
+	lastLoop = loop;
+	lastFromQueue = fromQueue;
+
+	events.fetch_or(EventStarted, std::memory_order_relaxed);
+}
+
+void PlaybackEngine::markTrigger(uint32_t slot, const EngineCommand &cmd)
+{
+	if (!config.clock || !cmd.options.triggerTime || cmd.options.quantize)
+		return;
+
+	voices[slot].triggerTime = cmd.options.triggerTime;
+	voices[slot].dequeueTime = cmd.dequeueTime;
+}
+
+void PlaybackEngine::recordStart(Voice &voice, size_t frame)
+{
+	uint64_t soundTime = blockTimestamp + (uint64_t)((double)frame * 1000000000.0 / (double)sampleRate);
+
+	// The block timestamps are only close to the clock, so the first frame
+	// can appear to be due just before the command was taken.
+	startLatency.record(soundTime > voice.dequeueTime ? soundTime - voice.dequeueTime : 0);
+	triggerLatency.record(soundTime > voice.triggerTime ? soundTime - voice.triggerTime : 0);
+
+	voice.triggerTime = 0;
+	voice.dequeueTime = 0;
+}
+
+void PlaybackEngine::startLayers(EngineCommand &cmd)
+{
+	if (!cmd.layerCount)
+		return;
+
+	if (cmd.options.mode == TriggerMode::Replace)
+		stopAll();
+
+	uint32_t first = noVoice;
+	bool marked = false;
+
+	// Every layer starts from the same frame, the offsets are applied by
+	// keeping the voice silent until its start frame is reached.
+	for (size_t i = 0; i < cmd.layerCount; i++) {
+		const LayerClip &layer = cmd.layers[i];
+		uint32_t slot = allocateVoice();
+
+		startVoice(slot, {layer.clip, layer.gain * cmd.options.gain, cmd.options.tag}, false, false);
+		voices[slot].startFrame = now + layer.offset;
+
+		// Measure the latency of the pad on a layer that starts right away.
+		if (!layer.offset && !marked) {
+			markTrigger(slot, cmd);
+			marked = true;
+		}
+
+		if (first == noVoice)
+			first = slot;
+	}
+
+	primary = first;
+}
+
+void PlaybackEngine::startQueue()
+{
+	if (queuePos >= queue.size())
+		return;
+
+	queuePlaying = false;
+	stopAll();
+
+	const QueueItem &item = queue[queuePos];
+	startVoice(allocateVoice(), item, false, true);
+	queuePlaying = true;
+}
+
+void PlaybackEngine::releaseVoice(uint32_t slot)
+{
+	auto it = std::find(activeVoices.begin(), activeVoices.end(), slot);
+
+	if (it != activeVoices.end())
+		activeVoices.erase(it);
+
+	voices.release(slot);
+}
+
+void PlaybackEngine::stopVoice(uint32_t slot)
+{
+	Voice &voice = voices[slot];
+
+	if (voice.fromQueue && queuePlaying) {
+		queuePlaying = false;
+
+		// An interrupted queue item counts as played, so the queue continues
+		// with the following item.
+		if (queuePos < queue.size())
+			queuePos++;
+	}
+
+	releaseVoice(slot);
+}
+
+void PlaybackEngine::stopAll()
+{
+	while (!activeVoices.empty())
+		stopVoice(activeVoices.back());
+}
+
+void PlaybackEngine::finishVoice(uint32_t slot)
+{
+	Voice &voice = voices[slot];
+
+	if (voice.fromQueue && queuePlaying) {
+		queuePos++;
+
+		// Start the next item in the same slot and at the same frame so
+		// there is no gap between queued sounds.
+		if (queuePos < queue.size()) {
+			const QueueItem &item = queue[queuePos];
+			startVoice(slot, item, false, true);
+			return;
+		}
+
+		queuePlaying = false;
+	}
+
+	releaseVoice(slot);
+
+	if (!hasActiveVoices())
+		events.fetch_or(EventEnded, std::memory_order_relaxed);
+}
+
+bool PlaybackEngine::resolveBuffer(Voice &voice)
+{
+	if (voice.buffer)
+		return true;
+
+	voice.buffer = voice.clip->getBuffer();
+	return voice.buffer != nullptr;
+}
+
+size_t PlaybackEngine::mixVoice(Voice &voice, float *const *out, size_t offset, size_t frames, float *convert)
+{
+	const AudioBuffer *buffer = voice.buffer;
+	bool sameLayout = buffer->channels() == channels;
+	size_t mixChannels = std::min(channels, buffer->channels());
+	size_t done = 0;
+
+	while (done < frames) {
+		if (voice.position >= buffer->frames) {
+			if (!voice.loop || !buffer->frames)
+				break;
+
+			voice.position = 0;
+		}
+
+		size_t count = std::min(frames - done, buffer->frames - voice.position);
+
+		if (buffer->isPcm()) {
+			if (!mixPcm(voice, out, offset + done, count, convert))
+				break;
+		} else if (sameLayout) {
+			mixKernel(out, offset + done, *buffer, voice.position, count, voice.gain, voice.meter);
+		} else {
+			for (size_t c = 0; c < mixChannels; c++)
+				mixScaled(out[c] + offset + done, buffer->channel(c) + voice.position, count,
+					  voice.gain, voice.meter);
+		}
+
+		voice.position += count;
+		done += count;
+	}
+
+	return done;
+}
+
+bool PlaybackEngine::mixPcm(Voice &voice, float *const *out, size_t offset, size_t count, float *convert)
+{
+	const AudioBuffer *buffer = voice.buffer;
+	const float *samples = convert;
+
+	// Float samples are mixed straight from the mapping, the other formats
+	// are converted to interleaved float first. Uncompressed buffers always
+	// have the output's channel count. Float samples that do not start on a
+	// float boundary in the file are copied like the rest.
+	if (buffer->pcmFormat == PcmFormat::F32LE && (uintptr_t)buffer->pcmData() % alignof(float) == 0) {
+		samples = reinterpret_cast<const float *>(buffer->pcmData()) + voice.position * buffer->pcmChannels;
+	} else {
+		if (!convert)
+			return false;
+
+		convertPcm(convert, *buffer, voice.position, count);
+	}
+
+	mixInterleaved(out, offset, samples, buffer->pcmChannels, count, voice.gain, voice.meter);
+	return true;
+}
+
+void PlaybackEngine::mixVoices(float *const *out, size_t offset, size_t frames)
+{
+	// Finished voices leave the active list while it is mixed, so mix a copy
+	// of it. The arena is sized for a full list and one block of converted
+	// samples, this only fails if the sizing is wrong and the failure is
+	// counted.
+	size_t count = activeVoices.size();
+	uint32_t *slots = arena.allocate<uint32_t>(count);
+	float *convert = arena.allocate<float>(frames * channels);
+
+	if (!slots)
+		return;
+
+	std::copy(activeVoices.begin(), activeVoices.end(), slots);
+
+	for (size_t i = 0; i < count; i++) {
+		Voice &voice = voices[slots[i]];
+		size_t done = 0;
+
+		if (voice.active && voice.startFrame > now)
+			done = (size_t)std::min<uint64_t>(frames, voice.startFrame - now);
+
+		while (voice.active && done < frames) {
+			if (!resolveBuffer(voice)) {
+				if (voice.clip->getState() != ClipEntry::State::Failed)
+					break;
+
+				finishVoice(slots[i]);
+				continue;
+			}
+
+			if (voice.triggerTime)
+				recordStart(voice, offset + done);
+
+			size_t mixed = mixVoice(voice, out, offset + done, frames - done, convert);
+			done += mixed;
+
+			if (!voice.loop && voice.position >= voice.buffer->frames)
+				finishVoice(slots[i]);
+			else if (!mixed)
+				break;
+		}
+	}
+}
+
+void PlaybackEngine::processCommand(EngineCommand &cmd)
+{
+	switch (cmd.type) {
+	case EngineCommand::Type::Play: {
+		if (cmd.options.mode == TriggerMode::Replace)
+			stopAll();
+
+		uint32_t slot = allocateVoice();
+		startVoice(slot, {std::move(cmd.clip), cmd.options.gain, cmd.options.tag}, cmd.options.loop, false);
+		markTrigger(slot, cmd);
+		break;
+	}
+	case EngineCommand::Type::PlayLayers:
+		startLayers(cmd);
+		break;
+	case EngineCommand::Type::Enqueue:
+		if (queue.size() >= config.maxQueueItems)
+			break;
+
+		queue.push_back({std::move(cmd.clip), cmd.options.gain, cmd.options.tag});
+
+		if (cmd.autoStart && !queuePlaying)
+			startQueue();
+		break;
+	case EngineCommand::Type::Stop:
+		cancelScheduledPlays();
+		stopAll();
+		paused = false;
+		stopped = true;
+		break;
+	case EngineCommand::Type::Pause:
+		paused = true;
+		break;
+	case EngineCommand::Type::Resume:
+		paused = false;
+		break;
+	case EngineCommand::Type::Restart:
+		if (isPrimaryActive()) {
+			voices[primary].position = 0;
+			paused = false;
+		} else if (lastFromQueue && queuePos > 0 && queuePos <= queue.size()) {
+			queuePos--;
+			startQueue();
+		} else if (lastPlay.clip) {
+			stopAll();
+			startVoice(allocateVoice(), lastPlay, lastLoop, false);
+		}
+		break;
+	case EngineCommand::Type::Seek:
+		if (isPrimaryActive() && voices[primary].buffer) {
+			Voice &voice = voices[primary];
+			voice.position = (size_t)std::clamp<int64_t>(cmd.frame, 0, (int64_t)voice.buffer->frames);
+		}
+		break;
+	case EngineCommand::Type::Next:
+		if (queuePlaying)
+			stopAll();
+
+		if (queuePos < queue.size())
+			startQueue();
+		break;
+	case EngineCommand::Type::Previous: {
+		// Stopping the current item advances the queue, so step back over
+		// it as well when it was still playing.
+		size_t steps = queuePlaying ? 2 : 1;
+
+		if (queuePlaying)
+			stopAll();
+
+		queuePos = queuePos > steps ? queuePos - steps : 0;
+		startQueue();
+		break;
+	}
+	case EngineCommand::Type::ClearQueue:
+		if (queuePlaying)
+			stopAll();
+
+		queue.clear();
+		queuePos = 0;
+		queuePlaying = false;
+		break;
+	case EngineCommand::Type::SetTempo:
+		if (cmd.tempo > 0.0 && cmd.gridBeats > 0.0)
+			gridFrames = (double)sampleRate * 60.0 / cmd.tempo * cmd.gridBeats;
+		else
+			gridFrames = 0.0;
+		break;
+	}
+}
+
+void PlaybackEngine::render(float *const *out, size_t frames, uint64_t timestamp)
+{
+	blockTimestamp = timestamp;
+
+	uint64_t renderStart = config.clock ? config.clock() : 0;
+	EngineCommand cmd;
+
+	while (commands.pop(cmd)) {
+		uint64_t triggerTime = cmd.options.triggerTime;
+
+		if (triggerTime && renderStart) {
+			cmd.dequeueTime = renderStart;
+			dequeueLatency.record(renderStart > triggerTime ? renderStart - triggerTime : 0);
+		}
+
+		schedule(std::move(cmd));
+	}
+
+	for (size_t c = 0; c < channels; c++)
+		memset(out[c], 0, frames * sizeof(float));
+
+	// Render the block in segments, applying scheduled commands at the
+	// exact frame they are due.
+	size_t offset = 0;
+
+	while (offset < frames) {
+		now = clock + offset;
+
+		while (!scheduledOrder.empty() && scheduled[scheduledOrder.front()].frame <= now) {
+			uint32_t index = scheduledOrder.front();
+			scheduledOrder.erase(scheduledOrder.begin());
+
+			cmd = std::move(scheduled[index].cmd);
+			scheduled.release(index);
+			processCommand(cmd);
+		}
+
+		size_t end = frames;
+
+		if (!scheduledOrder.empty() && scheduled[scheduledOrder.front()].frame < clock + frames)
+			end = (size_t)(scheduled[scheduledOrder.front()].frame - clock);
+
+		arena.reset();
+
+		if (!paused)
+			mixVoices(out, offset, end - offset);
+
+		offset = end;
+	}
+
+	// Overlapping sounds can add up to more than full scale, keep the sum
+	// from clipping before it reaches the OBS mixer.
+	limiter.process(out, frames);
+
+	cmd = EngineCommand();
+	clock += frames;
+
+	publish(frames);
+
+	if (renderStart)
+		renderTime.record(config.clock() - renderStart);
+}
+
+void PlaybackEngine::publish(size_t frames)
+{
+	bool active = hasActiveVoices();
+	EngineState newState;
+
+	if (active && paused)
+		newState = EngineState::Paused;
+	else if (active)
+		newState = EngineState::Playing;
+	else if (stopped)
+		newState = EngineState::Stopped;
+	else if (lastPlay.clip)
+		newState = EngineState::Ended;
+	else
+		newState = EngineState::None;
+
+	PlaybackSnapshot next;
+	next.state = newState;
+	next.sampleRate = sampleRate;
+	next.activeVoices = (uint32_t)activeVoices.size();
+	next.queuePosition = (uint32_t)queuePos;
+	next.queueSize = (uint32_t)queue.size();
+
+	// The position is the one after the block, so it belongs to the
+	// timestamp of the end of the block.
+	next.timestamp = blockTimestamp + (uint64_t)((double)frames * 1000000000.0 / (double)sampleRate);
+
+	if (isPrimaryActive() && voices[primary].buffer) {
+		next.clip = voices[primary].clip.get();
+		next.position = (int64_t)voices[primary].position;
+		next.duration = (int64_t)voices[primary].buffer->frames;
+	}
+
+	snapshot.store(next);
+
+	VoiceTable table;
+	table.sampleRate = sampleRate;
+	table.timestamp = next.timestamp;
+	table.paused = paused;
+
+	// Newest voices first, so they are the ones kept when there are more
+	// voices than the table holds.
+	for (size_t i = activeVoices.size(); i > 0 && table.count < VoiceTable::maxVoices; i--) {
+		const Voice &voice = voices[activeVoices[i - 1]];
+
+		if (!voice.tag)
+			continue;
+
+		VoiceSnapshot &entry = table.voices[table.count++];
+		entry.tag = voice.tag;
+		entry.position = (int64_t)voice.position;
+		entry.duration = voice.buffer ? (int64_t)voice.buffer->frames : 0;
+		entry.peak = voice.meter.peak;
+		entry.rms = voice.meter.samples ? (float)std::sqrt(voice.meter.sumSquares / (double)voice.meter.samples)
+						: 0.0f;
+	}
+
+	voiceTable.store(table);
+
+	// Voice levels are per block, start them again for the next one.
+	for (uint32_t slot : activeVoices)
+		voices[slot].meter = MeterSums();
+
+	MeterSnapshot meter;
+	meter.channels = (uint32_t)std::min(channels, MeterSnapshot::maxChannels);
+
+	for (size_t c = 0; c < meter.channels; c++) {
+		meter.peak[c] = limiter.getPeak(c);
+		meter.rms[c] = limiter.getRms(c);
+	}
+
+	masterMeter.store(meter);
+}
+
+PoolUsage PlaybackEngine::getVoiceUsage() const
+{
+	PoolUsage usage;
+	usage.capacity = voices.capacity();
+	usage.highWater = voices.getHighWater();
+	usage.exhausted = voices.getExhausted();
+	return usage;
+}
+
+PoolUsage PlaybackEngine::getScheduleUsage() const
+{
+	PoolUsage usage;
+	usage.capacity = scheduled.capacity();
+	usage.highWater = scheduled.getHighWater();
+	usage.exhausted = scheduled.getExhausted();
+	return usage;
+}
+
+PoolUsage PlaybackEngine::getArenaUsage() const
+{
+	PoolUsage usage;
+	usage.capacity = arena.capacity();
+	usage.highWater = arena.getHighWater();
+	usage.exhausted = arena.getExhausted();
+	return usage;
+}
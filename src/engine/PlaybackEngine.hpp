@@ -0,0 +1,302 @@
+#pragma once
+
+#include "BoundedQueue.hpp"
+#include "ClipCache.hpp"
+#include "Histogram.hpp"
+#include "Limiter.hpp"
+#include "MixKernels.hpp"
+#include "ObjectPool.hpp"
+#include "ScratchArena.hpp"
+#include "Seqlock.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+enum class EngineState { None, Playing, Paused, Stopped, Ended };
+
+enum class TriggerMode {
+	// Stops everything that is playing when the sound starts.
+	Replace,
+	// Plays on top of the sounds that are already playing.
+	Overlap,
+};
+
+struct PlayOptions {
+	float gain = 1.0f;
+	bool loop = false;
+	TriggerMode mode = TriggerMode::Replace;
+	// Audio timestamp (os_gettime_ns) the sound should start at, or 0 to
+	// start it as soon as possible.
+	uint64_t timestamp = 0;
+	// Delays the start to the next point of the tempo grid.
+	bool quantize = false;
+	// Identifies the pad that started the sound in the voice table.
+	uint32_t tag = 0;
+	// Time the sound was triggered (os_gettime_ns), to measure how long it
+	// takes to become audio. Quantized sounds are not measured.
+	uint64_t triggerTime = 0;
+};
+
+// One clip of a layer pad. The offset is in frames from the start of the pad.
+struct LayerClip {
+	std::shared_ptr<ClipEntry> clip;
+	float gain = 1.0f;
+	uint64_t offset = 0;
+};
+
+struct EngineCommand {
+	enum class Type {
+		Play,
+		PlayLayers,
+		Enqueue,
+		Stop,
+		Pause,
+		Resume,
+		Restart,
+		Seek,
+		Next,
+		Previous,
+		ClearQueue,
+		SetTempo
+	};
+
+	static constexpr size_t maxLayers = 8;
+
+	Type type = Type::Stop;
+	std::shared_ptr<ClipEntry> clip;
+	LayerClip layers[maxLayers];
+	size_t layerCount = 0;
+	PlayOptions options;
+	bool autoStart = false;
+	int64_t frame = 0;
+	double tempo = 0.0;
+	double gridBeats = 0.0;
+	// Set by the engine when the command is taken off the queue.
+	uint64_t dequeueTime = 0;
+};
+
+// Capacities of the engine's pools. Everything is allocated when the engine
+// is created, nothing is allocated while it renders.
+struct EngineConfig {
+	size_t maxVoices = 32;
+	size_t maxScheduled = 256;
+	size_t maxQueueItems = 1024;
+	// Largest number of frames rendered in one call.
+	size_t maxFrames = 1024;
+	// Monotonic time in nanoseconds, on the same clock as the audio
+	// timestamps. Latency and render time are only measured when it is set.
+	uint64_t (*clock)() = nullptr;
+};
+
+// Playback state published after every rendered block. The UI reads it
+// without calling into libobs or waiting for the audio thread.
+struct PlaybackSnapshot {
+	// Only used to tell clips apart, never dereferenced outside the engine.
+	const ClipEntry *clip = nullptr;
+	// Position and length of the primary voice, in frames.
+	int64_t position = 0;
+	int64_t duration = 0;
+	// Audio timestamp the position belongs to, so readers can advance it
+	// between blocks.
+	uint64_t timestamp = 0;
+	uint32_t sampleRate = 0;
+	uint32_t activeVoices = 0;
+	uint32_t queuePosition = 0;
+	uint32_t queueSize = 0;
+	EngineState state = EngineState::None;
+};
+
+// A voice that is sounding, as published in the voice table.
+struct VoiceSnapshot {
+	uint32_t tag = 0;
+	int64_t position = 0;
+	int64_t duration = 0;
+	// Level of the voice over the last block, all channels together.
+	float peak = 0.0f;
+	float rms = 0.0f;
+};
+
+// Every sounding voice after the last rendered block, so the UI can show
+// which pads are playing and how far along they are.
+struct VoiceTable {
+	static constexpr size_t maxVoices = 64;
+
+	VoiceSnapshot voices[maxVoices];
+	uint32_t count = 0;
+	uint32_t sampleRate = 0;
+	uint64_t timestamp = 0;
+	bool paused = false;
+};
+
+// Level of the master output over the last block, after the limiter.
+struct MeterSnapshot {
+	static constexpr size_t maxChannels = 8;
+
+	float peak[maxChannels] = {};
+	float rms[maxChannels] = {};
+	uint32_t channels = 0;
+};
+
+struct PoolUsage {
+	size_t capacity = 0;
+	size_t highWater = 0;
+	uint64_t exhausted = 0;
+};
+
+// Mixes resident clip buffers on the audio thread. The UI never touches the
+// playback state directly, it only submits commands. Every command is
+// scheduled on the engine's sample clock, so a sound starts on the exact
+// frame it was scheduled for, even in the middle of a rendered block.
+class PlaybackEngine {
+public:
+	enum Event : uint32_t {
+		EventStarted = 1 << 0,
+		EventEnded = 1 << 1,
+	};
+
+private:
+	struct Voice {
+		std::shared_ptr<ClipEntry> clip;
+		const AudioBuffer *buffer = nullptr;
+		size_t position = 0;
+		uint64_t startFrame = 0;
+		float gain = 1.0f;
+		uint32_t tag = 0;
+		MeterSums meter;
+		// Cleared once the first frame of the voice has been rendered.
+		uint64_t triggerTime = 0;
+		uint64_t dequeueTime = 0;
+		bool loop = false;
+		bool fromQueue = false;
+		bool active = false;
+	};
+
+	struct QueueItem {
+		std::shared_ptr<ClipEntry> clip;
+		float gain = 1.0f;
+		uint32_t tag = 0;
+	};
+
+	struct ScheduledCommand {
+		uint64_t frame = 0;
+		uint64_t sequence = 0;
+		EngineCommand cmd;
+	};
+
+	static constexpr uint32_t noVoice = ObjectPool<Voice>::invalid;
+
+	uint32_t sampleRate;
+	size_t channels;
+	EngineConfig config;
+
+	MixKernel mixKernel;
+	Limiter limiter;
+
+	BoundedQueue<EngineCommand> commands;
+
+	// Indices into the scheduled pool, sorted by frame and sequence.
+	ObjectPool<ScheduledCommand> scheduled;
+	std::vector<uint32_t> scheduledOrder;
+	uint64_t sequence = 0;
+
+	uint64_t clock = 0;
+	uint64_t now = 0;
+	uint64_t blockTimestamp = 0;
+
+	double gridFrames = 0.0;
+	uint64_t gridOrigin = 0;
+
+	// Indices into the voice pool, oldest voice first.
+	ObjectPool<Voice> voices;
+	std::vector<uint32_t> activeVoices;
+	uint32_t primary = noVoice;
+
+	ScratchArena arena;
+
+	std::vector<QueueItem> queue;
+	size_t queuePos = 0;
+	bool queuePlaying = false;
+
+	QueueItem lastPlay;
+	bool lastLoop = false;
+	bool lastFromQueue = false;
+
+	bool paused = false;
+	bool stopped = false;
+
+	std::atomic<uint32_t> events = 0;
+	Seqlock<PlaybackSnapshot> snapshot;
+	Seqlock<VoiceTable> voiceTable;
+	Seqlock<MeterSnapshot> masterMeter;
+
+	// In nanoseconds.
+	Histogram dequeueLatency;
+	Histogram startLatency;
+	Histogram triggerLatency;
+	Histogram renderTime;
+
+	uint64_t frameForTimestamp(uint64_t timestamp) const;
+	uint64_t quantizeFrame(uint64_t frame);
+	bool hasActiveVoices() const { return !activeVoices.empty(); }
+	bool isPrimaryActive() const { return primary != noVoice && voices[primary].active; }
+	void schedule(EngineCommand &&cmd);
+	void cancelScheduledPlays();
+	void processCommand(EngineCommand &cmd);
+	void startLayers(EngineCommand &cmd);
+
+	uint32_t allocateVoice();
+	void startVoice(uint32_t slot, const QueueItem &item, bool loop, bool fromQueue);
+	void markTrigger(uint32_t slot, const EngineCommand &cmd);
+	void recordStart(Voice &voice, size_t frame);
+	void startQueue();
+	void releaseVoice(uint32_t slot);
+	void stopVoice(uint32_t slot);
+	void stopAll();
+	void finishVoice(uint32_t slot);
+	bool resolveBuffer(Voice &voice);
+	size_t mixVoice(Voice &voice, float *const *out, size_t offset, size_t frames, float *convert);
+	bool mixPcm(Voice &voice, float *const *out, size_t offset, size_t count, float *convert);
+	void mixVoices(float *const *out, size_t offset, size_t frames);
+	void publish(size_t frames);
+
+public:
+	PlaybackEngine(uint32_t sampleRate, size_t channels, const EngineConfig &config = EngineConfig());
+
+	// Never blocks. The clips of the command come from a ClipCache, which
+	// keeps them until the engine lets go, so the audio thread never frees
+	// one.
+	bool submit(EngineCommand &&cmd);
+
+	// Called from the audio thread only. The timestamp is the audio
+	// timestamp of the first frame of the block.
+	void render(float *const *out, size_t frames, uint64_t timestamp);
+
+	uint32_t takeEvents() { return events.exchange(0, std::memory_order_acq_rel); }
+
+	uint32_t getSampleRate() const { return sampleRate; }
+	size_t getChannels() const { return channels; }
+	const EngineConfig &getConfig() const { return config; }
+
+	// Can be called from any thread.
+	PlaybackSnapshot getSnapshot() const { return snapshot.load(); }
+	VoiceTable getVoiceTable() const { return voiceTable.load(); }
+	MeterSnapshot getMasterMeter() const { return masterMeter.load(); }
+
+	// Trigger to dequeue, dequeue to first rendered frame, trigger to first
+	// rendered frame, and the time each render call takes.
+	const Histogram &getDequeueLatency() const { return dequeueLatency; }
+	const Histogram &getStartLatency() const { return startLatency; }
+	const Histogram &getTriggerLatency() const { return triggerLatency; }
+	const Histogram &getRenderTime() const { return renderTime; }
+
+	EngineState getState() const { return getSnapshot().state; }
+	int64_t getPosition() const { return getSnapshot().position; }
+	int64_t getDuration() const { return getSnapshot().duration; }
+	size_t getQueuePosition() const { return getSnapshot().queuePosition; }
+	size_t getQueueSize() const { return getSnapshot().queueSize; }
+
+	PoolUsage getVoiceUsage() const;
+	PoolUsage getScheduleUsage() const;
+	PoolUsage getArenaUsage() const;
+};
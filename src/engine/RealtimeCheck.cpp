@@ -0,0 +1,270 @@
+#include "RealtimeCheck.hpp"
+
+#ifdef ENABLE_RT_CHECKS
+
+#include <obs-module.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <execinfo.h>
+#endif
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr int maxStackFrames = 16;
+constexpr int loggedStackFrames = 8;
+constexpr size_t maxViolations = 64;
+
+struct Violation {
+	const char *what;
+	void *stack[maxStackFrames];
+	int frames;
+};
+
+// Every render thread records into its own list and logs it itself, so
+// recording never has to synchronize with another thread.
+struct ViolationLog {
+	Violation violations[maxViolations];
+	size_t count = 0;
+	size_t dropped = 0;
+};
+
+thread_local bool realtime = false;
+thread_local ViolationLog violationLog;
+
+int captureStack(void **stack, int frames)
+{
+#ifdef _WIN32
+	return (int)CaptureStackBackTrace(2, (DWORD)frames, stack, nullptr);
+#else
+	return backtrace(stack, frames);
+#endif
+}
+
+#ifdef __linux__
+// The C library functions replaced below, looked up once.
+template<typename F> struct RealFunction {
+	const char *name;
+	std::atomic<F> function = nullptr;
+
+	F get()
+	{
+		F real = function.load(std::memory_order_relaxed);
+
+		if (!real) {
+			real = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+			function.store(real, std::memory_order_relaxed);
+		}
+
+		return real;
+	}
+};
+
+RealFunction<int (*)(pthread_mutex_t *)> realMutexLock{"pthread_mutex_lock"};
+RealFunction<ssize_t (*)(int, const void *, size_t)> realWrite{"write"};
+RealFunction<ssize_t (*)(int, void *, size_t)> realRead{"read"};
+RealFunction<int (*)(const struct timespec *, struct timespec *)> realNanosleep{"nanosleep"};
+RealFunction<int (*)(clockid_t, int, const struct timespec *, struct timespec *)> realClockNanosleep{
+	"clock_nanosleep"};
+#endif
+
+// The first stack capture can load the unwinder, which allocates. Do it
+// once when the module is loaded so it never happens inside a scope, and
+// look up the replaced functions while at it.
+struct WarmUp {
+	WarmUp()
+	{
+		void *stack[1];
+		captureStack(stack, 1);
+
+#ifdef __linux__
+		realMutexLock.get();
+		realWrite.get();
+		realRead.get();
+		realNanosleep.get();
+		realClockNanosleep.get();
+#endif
+	}
+} warmUp;
+} // namespace
+
+RealtimeScope::RealtimeScope()
+{
+	realtime = true;
+}
+
+RealtimeScope::~RealtimeScope()
+{
+	realtime = false;
+}
+
+bool inRealtimeScope()
+{
+	return realtime;
+}
+
+void reportRealtimeViolation(const char *what)
+{
+	ViolationLog &log = violationLog;
+
+	if (log.count == maxViolations) {
+		log.dropped++;
+		return;
+	}
+
+	// Leave the scope while capturing, so anything the capture does is not
+	// reported again.
+	realtime = false;
+
+	Violation &violation = log.violations[log.count++];
+	violation.what = what;
+	violation.frames = captureStack(violation.stack, maxStackFrames);
+
+	realtime = true;
+}
+
+void logRealtimeViolations()
+{
+	ViolationLog &log = violationLog;
+
+	for (size_t i = 0; i < log.count; i++) {
+		const Violation &violation = log.violations[i];
+		int frames = violation.frames < loggedStackFrames ? violation.frames : loggedStackFrames;
+
+		blog(LOG_WARNING, "Soundboard: Real-time violation in render callback: %s", violation.what);
+
+#ifdef _WIN32
+		for (int f = 0; f < frames; f++)
+			blog(LOG_WARNING, "    #%d %p", f, violation.stack[f]);
+#else
+		char **symbols = backtrace_symbols(violation.stack, frames);
+
+		for (int f = 0; f < frames; f++)
+			blog(LOG_WARNING, "    #%d %s", f, symbols ? symbols[f] : "?");
+
+		free(symbols);
+#endif
+	}
+
+	if (log.dropped)
+		blog(LOG_WARNING, "Soundboard: %zu more real-time violations were not recorded", log.dropped);
+
+	log.count = 0;
+	log.dropped = 0;
+}
+
+// Replacing the global allocation functions catches every allocation made
+// by the plugin, including the ones inside the standard library.
+void *operator new(size_t size)
+{
+	if (realtime)
+		reportRealtimeViolation("heap allocation");
+
+	void *ptr = malloc(size ? size : 1);
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	if (realtime)
+		reportRealtimeViolation("heap allocation");
+
+	return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (ptr && realtime)
+		reportRealtimeViolation("heap deallocation");
+
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+#ifdef __linux__
+// Locks, sleeps and file I/O are caught where they enter the C library, so
+// a std::mutex or a log call added to the render path is reported without
+// being marked. Calls the C library makes internally are not seen, which
+// is why the file and log functions also mark themselves.
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept
+{
+	if (realtime)
+		reportRealtimeViolation("mutex lock");
+
+	return realMutexLock.get()(mutex);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count)
+{
+	if (realtime)
+		reportRealtimeViolation("write");
+
+	return realWrite.get()(fd, buf, count);
+}
+
+extern "C" ssize_t read(int fd, void *buf, size_t count)
+{
+	if (realtime)
+		reportRealtimeViolation("read");
+
+	return realRead.get()(fd, buf, count);
+}
+
+extern "C" int nanosleep(const struct timespec *duration, struct timespec *remaining)
+{
+	if (realtime)
+		reportRealtimeViolation("sleep");
+
+	return realNanosleep.get()(duration, remaining);
+}
+
+extern "C" int clock_nanosleep(clockid_t clock, int flags, const struct timespec *duration,
+			       struct timespec *remaining)
+{
+	if (realtime)
+		reportRealtimeViolation("sleep");
+
+	return realClockNanosleep.get()(clock, flags, duration, remaining);
+}
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+// Debug checks for the audio render path, enabled with the ENABLE_RT_CHECKS
+// build option. While a RealtimeScope is alive on a thread, heap
+// allocations and calls into blocking code are recorded along with a short
+// stack. They are logged later by logRealtimeViolations, outside the scope.
+// On Linux, mutex locks, sleeps, reads and writes are caught in the C
+// library on top of the sites marked with RT_BLOCKING. Without the option
+// everything here compiles to nothing.
+
+#ifdef ENABLE_RT_CHECKS
+
+class RealtimeScope {
+public:
+	RealtimeScope();
+	~RealtimeScope();
+
+	RealtimeScope(const RealtimeScope &) = delete;
+	RealtimeScope &operator=(const RealtimeScope &) = delete;
+};
+
+bool inRealtimeScope();
+void reportRealtimeViolation(const char *what);
+void logRealtimeViolations();
+
+// Marks code that can block, such as taking a lock or doing file I/O.
+#define RT_BLOCKING(what)                              \
+	do {                                           \
+		if (inRealtimeScope())                 \
+			reportRealtimeViolation(what); \
+	} while (false)
+
+#else
+
+class RealtimeScope {
+public:
+	RealtimeScope() {}
+};
+
+inline void logRealtimeViolations() {}
+
+#define RT_BLOCKING(what) ((void)0)
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bump allocator for scratch memory that only lives while one block is
+// rendered. Allocations are never freed one by one, the whole arena is reset
+// before it is used again instead.
+class ScratchArena {
+	static constexpr size_t alignment = 32;
+
+	std::unique_ptr<uint8_t[]> storage;
+	size_t size;
+	size_t offset = 0;
+
+	std::atomic<size_t> highWater = 0;
+	std::atomic<uint64_t> exhausted = 0;
+
+public:
+	explicit ScratchArena(size_t bytes) : storage(new uint8_t[bytes + alignment]), size(bytes) {}
+
+	void reset()
+	{
+		if (offset > highWater.load(std::memory_order_relaxed))
+			highWater.store(offset, std::memory_order_relaxed);
+
+		offset = 0;
+	}
+
+	// Returns uninitialized memory for count objects, or nullptr when the
+	// arena is full.
+	template<typename T> T *allocate(size_t count)
+	{
+		uintptr_t base = reinterpret_cast<uintptr_t>(storage.get());
+		uintptr_t start = (base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t end = (size_t)(start - base) + count * sizeof(T);
+
+		if (end > size + alignment) {
+			exhausted.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		offset = end;
+		return reinterpret_cast<T *>(start);
+	}
+
+	size_t capacity() const { return size; }
+	size_t getHighWater() const { return highWater.load(std::memory_order_relaxed); }
+	uint64_t getExhausted() const { return exhausted.load(std::memory_order_relaxed); }
+};
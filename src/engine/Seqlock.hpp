@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "RealtimeCheck.hpp"
+
+// Single writer, many reader snapshot of a small trivially copyable value.
+// The writer never waits, readers retry while a write is in progress. The
+// value is kept in atomic words, so a torn read is never a data race, it is
+// only thrown away.
+template<typename T> class Seqlock {
+	static_assert(std::is_trivially_copyable<T>::value, "Seqlock values must be trivially copyable");
+
+	static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	std::atomic<uint32_t> sequence = 0;
+	std::atomic<uint64_t> words[wordCount] = {};
+
+public:
+	void store(const T &value)
+	{
+		uint64_t buffer[wordCount] = {};
+		memcpy(buffer, &value, sizeof(T));
+
+		uint32_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < wordCount; i++)
+			words[i].store(buffer[i], std::memory_order_relaxed);
+
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	T load() const
+	{
+		uint64_t buffer[wordCount];
+		uint32_t before;
+		uint32_t after;
+
+		for (;;) {
+			before = sequence.load(std::memory_order_acquire);
+
+			for (size_t i = 0; i < wordCount; i++)
+				buffer[i] = words[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			after = sequence.load(std::memory_order_relaxed);
+
+			if (before == after && !(before & 1))
+				break;
+
+			// The reader spins until the write is done.
+			RT_BLOCKING("seqlock retry");
+		}
+
+		T value;
+		memcpy(&value, buffer, sizeof(T));
+		return value;
+	}
+};
@@ -0,0 +1,435 @@
+#include "SoundboardSource.hpp"
+#include "RealtimeCheck.hpp"
+
+#include <obs-module.h>
+#include <media-io/audio-io.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr int minVoices = 8;
+constexpr int maxVoices = 256;
+
+const char *getName(void *)
+{
+	return obs_module_text("Soundboard");
+}
+
+void getDefaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "max_voices", 32);
+}
+
+std::string formatHistogram(const char *name, const Histogram &histogram)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "%-18s %8llu  mean %7.2f  p50 %7.2f  p99 %7.2f  max %7.2f ms", name,
+		 (unsigned long long)histogram.getCount(), histogram.getMean() / 1e6,
+		 histogram.getPercentile(0.5) / 1e6, histogram.getPercentile(0.99) / 1e6, histogram.getMax() / 1e6);
+	return line;
+}
+
+void *create(obs_data_t *settings, obs_source_t *source)
+{
+	const struct audio_output_info *aoi = audio_output_get_info(obs_get_audio());
+	uint32_t sampleRate = aoi->samples_per_sec;
+	size_t channels = get_audio_channels(aoi->speakers);
+
+	// The pools are sized once here, so the render thread never allocates.
+	// Every voice can have a few commands waiting for it.
+	EngineConfig config;
+	config.maxVoices = (size_t)std::clamp((int)obs_data_get_int(settings, "max_voices"), minVoices, maxVoices);
+	config.maxScheduled = config.maxVoices * 8;
+	config.maxFrames = AUDIO_OUTPUT_FRAMES;
+	config.clock = os_gettime_ns;
+
+	ClipCache::initialize(sampleRate, channels);
+
+	return new SoundboardSource(source, sampleRate, channels, config);
+}
+
+void destroy(void *data)
+{
+	delete static_cast<SoundboardSource *>(data);
+}
+} // namespace
+
+SoundboardSource::SoundboardSource(obs_source_t *source_, uint32_t sampleRate, size_t channels,
+				   const EngineConfig &config)
+	: source(source_),
+	  engine(sampleRate, channels, config)
+{
+	thread = std::thread(&SoundboardSource::renderThread, this);
+}
+
+SoundboardSource::~SoundboardSource()
+{
+	active = false;
+	thread.join();
+
+	PoolUsage voices = engine.getVoiceUsage();
+	PoolUsage scheduled = engine.getScheduleUsage();
+
+	blog(LOG_INFO, "Soundboard: '%s' used at most %zu of %zu voices and %zu of %zu scheduled commands",
+	     obs_source_get_name(source), voices.highWater, voices.capacity, scheduled.highWater,
+	     scheduled.capacity);
+}
+
+void SoundboardSource::registerSource()
+{
+	struct obs_source_info info = {};
+	info.id = SOUNDBOARD_SOURCE_ID;
+	info.type = OBS_SOURCE_TYPE_INPUT;
+	info.output_flags = OBS_SOURCE_AUDIO | OBS_SOURCE_CONTROLLABLE_MEDIA | OBS_SOURCE_CAP_DISABLED;
+	info.icon_type = OBS_ICON_TYPE_AUDIO_OUTPUT;
+	info.get_name = getName;
+	info.get_defaults = getDefaults;
+	info.create = create;
+	info.destroy = destroy;
+
+	info.media_play_pause = [](void *data, bool pause) {
+		static_cast<SoundboardSource *>(data)->playPause(pause);
+	};
+	info.media_restart = [](void *data) {
+		static_cast<SoundboardSource *>(data)->restart();
+	};
+	info.media_stop = [](void *data) {
+		static_cast<SoundboardSource *>(data)->stop();
+	};
+	info.media_next = [](void *data) {
+		static_cast<SoundboardSource *>(data)->next();
+	};
+	info.media_previous = [](void *data) {
+		static_cast<SoundboardSource *>(data)->previous();
+	};
+	info.media_get_duration = [](void *data) {
+		return static_cast<SoundboardSource *>(data)->getDuration();
+	};
+	info.media_get_time = [](void *data) {
+		return static_cast<SoundboardSource *>(data)->getTime();
+	};
+	info.media_set_time = [](void *data, int64_t ms) {
+		static_cast<SoundboardSource *>(data)->setTime(ms);
+	};
+	info.media_get_state = [](void *data) {
+		return static_cast<SoundboardSource *>(data)->getMediaState();
+	};
+
+	obs_register_source(&info);
+}
+
+SoundboardSource *SoundboardSource::fromSource(obs_source_t *source)
+{
+	if (!source || strcmp(obs_source_get_unversioned_id(source), SOUNDBOARD_SOURCE_ID) != 0)
+		return nullptr;
+
+	return static_cast<SoundboardSource *>(obs_obj_get_data(source));
+}
+
+void SoundboardSource::renderThread()
+{
+	os_set_thread_name("soundboard-render");
+
+	const uint32_t sampleRate = engine.getSampleRate();
+	const size_t channels = engine.getChannels();
+	const enum speaker_layout speakers = audio_output_get_info(obs_get_audio())->speakers;
+
+	std::vector<float> samples(channels * AUDIO_OUTPUT_FRAMES);
+	float *planes[MAX_AUDIO_CHANNELS] = {};
+
+	for (size_t c = 0; c < channels; c++)
+		planes[c] = samples.data() + c * AUDIO_OUTPUT_FRAMES;
+
+	uint64_t startTime = os_gettime_ns();
+	uint64_t frames = 0;
+
+	while (active) {
+		uint64_t timestamp = startTime + util_mul_div64(frames, 1000000000ULL, sampleRate);
+
+		{
+			RealtimeScope scope;
+			engine.render(planes, AUDIO_OUTPUT_FRAMES, timestamp);
+		}
+
+		logRealtimeViolations();
+		logExhaustion();
+
+		struct obs_source_audio audio = {};
+
+		for (size_t c = 0; c < channels; c++)
+			audio.data[c] = reinterpret_cast<const uint8_t *>(planes[c]);
+
+		audio.frames = AUDIO_OUTPUT_FRAMES;
+		audio.speakers = speakers;
+		audio.format = AUDIO_FORMAT_FLOAT_PLANAR;
+		audio.samples_per_sec = sampleRate;
+		audio.timestamp = timestamp;
+
+		obs_source_output_audio(source, &audio);
+		dispatchEvents(engine.takeEvents());
+
+		frames += AUDIO_OUTPUT_FRAMES;
+		uint64_t nextTime = startTime + util_mul_div64(frames, 1000000000ULL, sampleRate);
+
+		// Start a new timeline if the thread stalled for a long time instead
+		// of trying to catch up with a burst of blocks.
+		if (!os_sleepto_ns(nextTime) && os_gettime_ns() - nextTime > 1000000000ULL) {
+			startTime = os_gettime_ns();
+			frames = 0;
+		}
+	}
+}
+
+void SoundboardSource::dispatchEvents(uint32_t events)
+{
+	if (events & PlaybackEngine::EventStarted)
+		obs_source_media_started(source);
+	if (events & PlaybackEngine::EventEnded)
+		obs_source_media_ended(source);
+}
+
+void SoundboardSource::logExhaustion()
+{
+	PoolUsage voices = engine.getVoiceUsage();
+	PoolUsage scheduled = engine.getScheduleUsage();
+	PoolUsage arena = engine.getArenaUsage();
+
+	if (voices.exhausted != reportedVoices) {
+		blog(LOG_WARNING, "Soundboard: All %zu voices of '%s' are in use, stole %llu voices", voices.capacity,
+		     obs_source_get_name(source), (unsigned long long)(voices.exhausted - reportedVoices));
+		reportedVoices = voices.exhausted;
+	}
+
+	if (scheduled.exhausted != reportedScheduled) {
+		blog(LOG_WARNING, "Soundboard: Schedule of '%s' is full, dropped %llu commands",
+		     obs_source_get_name(source), (unsigned long long)(scheduled.exhausted - reportedScheduled));
+		reportedScheduled = scheduled.exhausted;
+	}
+
+	if (arena.exhausted != reportedArena) {
+		blog(LOG_WARNING, "Soundboard: Scratch memory of '%s' ran out %llu times", obs_source_get_name(source),
+		     (unsigned long long)(arena.exhausted - reportedArena));
+		reportedArena = arena.exhausted;
+	}
+}
+
+std::vector<std::string> SoundboardSource::getStatsReport()
+{
+	std::vector<std::string> lines;
+	char line[256];
+
+	lines.push_back(formatHistogram("Trigger to sound", engine.getTriggerLatency()));
+	lines.push_back(formatHistogram("Trigger to dequeue", engine.getDequeueLatency()));
+	lines.push_back(formatHistogram("Dequeue to sound", engine.getStartLatency()));
+	lines.push_back(formatHistogram("Render time", engine.getRenderTime()));
+
+	PlaybackSnapshot snapshot = engine.getSnapshot();
+	PoolUsage voices = engine.getVoiceUsage();
+	PoolUsage scheduled = engine.getScheduleUsage();
+
+	snprintf(line, sizeof(line), "Voices: %u active, %zu most, %zu available", snapshot.activeVoices,
+		 voices.highWater, voices.capacity);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Scheduled commands: %zu most, %zu available", scheduled.highWater,
+		 scheduled.capacity);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Queue: %u of %u", snapshot.queuePosition, snapshot.queueSize);
+	lines.push_back(line);
+
+	return lines;
+}
+
+std::vector<std::string> SoundboardSource::getCacheReport()
+{
+	std::vector<std::string> lines;
+	ClipCache *cache = ClipCache::get();
+
+	if (!cache)
+		return lines;
+
+	CacheStats stats = cache->getStats();
+	uint64_t lookups = stats.hits + stats.misses;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Clip cache: %zu clips, %.1f MB, %zu waiting to decode", stats.entries,
+		 stats.bytes / (1024.0 * 1024.0), stats.pending);
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Uncompressed clips: %zu, %.1f MB", stats.pcm, stats.pcmBytes / (1024.0 * 1024.0));
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Shared clips: %zu, %.1f MB saved", stats.shared,
+		 stats.sharedBytes / (1024.0 * 1024.0));
+	lines.push_back(line);
+	snprintf(line, sizeof(line), "Clip cache hit rate: %.1f%% of %llu lookups",
+		 lookups ? stats.hits * 100.0 / lookups : 0.0, (unsigned long long)lookups);
+	lines.push_back(line);
+
+	return lines;
+}
+
+void SoundboardSource::play(const std::string &path, const PlayOptions &options)
+{
+	ClipCache *cache = ClipCache::get();
+
+	if (!cache) {
+		blog(LOG_WARNING, "Soundboard: Clip cache is not initialized, dropping play of '%s'", path.c_str());
+		return;
+	}
+
+	play(cache->acquire(path), options);
+}
+
+void SoundboardSource::play(std::shared_ptr<ClipEntry> clip, const PlayOptions &options)
+{
+	if (!clip)
+		return;
+
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Play;
+	cmd.clip = std::move(clip);
+	cmd.options = options;
+
+	// A command that does not fit is left untouched.
+	if (!engine.submit(std::move(cmd)))
+		blog(LOG_WARNING, "Soundboard: Command queue is full, dropping play of '%s'",
+		     cmd.clip->getPath().c_str());
+}
+
+void SoundboardSource::playLayers(const std::vector<SoundLayer> &layers, const PlayOptions &options)
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::PlayLayers;
+	cmd.options = options;
+
+	if (layers.size() > EngineCommand::maxLayers)
+		blog(LOG_WARNING, "Soundboard: Only the first %zu layers of a pad are played",
+		     EngineCommand::maxLayers);
+
+	for (const SoundLayer &layer : layers) {
+		if (cmd.layerCount == EngineCommand::maxLayers)
+			break;
+
+		if (!layer.clip)
+			continue;
+
+		LayerClip &clip = cmd.layers[cmd.layerCount++];
+		clip.clip = layer.clip;
+		clip.gain = layer.gain;
+		clip.offset = (uint64_t)std::max<int64_t>(layer.offsetMs, 0) * engine.getSampleRate() / 1000;
+	}
+
+	if (!engine.submit(std::move(cmd)))
+		blog(LOG_WARNING, "Soundboard: Command queue is full, dropping layer pad");
+}
+
+void SoundboardSource::enqueue(const std::string &path, float gain, uint32_t tag, bool autoStart)
+{
+	ClipCache *cache = ClipCache::get();
+
+	if (!cache) {
+		blog(LOG_WARNING, "Soundboard: Clip cache is not initialized, dropping '%s'", path.c_str());
+		return;
+	}
+
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Enqueue;
+	cmd.clip = cache->acquire(path);
+	cmd.options.gain = gain;
+	cmd.options.tag = tag;
+	cmd.autoStart = autoStart;
+
+	if (!engine.submit(std::move(cmd)))
+		blog(LOG_WARNING, "Soundboard: Command queue is full, dropping '%s'", path.c_str());
+}
+
+void SoundboardSource::clearQueue()
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::ClearQueue;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::setTempo(double bpm, double gridBeats)
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::SetTempo;
+	cmd.tempo = bpm;
+	cmd.gridBeats = gridBeats;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::playPause(bool pause)
+{
+	EngineCommand cmd;
+	cmd.type = pause ? EngineCommand::Type::Pause : EngineCommand::Type::Resume;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::restart()
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Restart;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::stop()
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Stop;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::next()
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Next;
+	engine.submit(std::move(cmd));
+}
+
+void SoundboardSource::previous()
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Previous;
+	engine.submit(std::move(cmd));
+}
+
+int64_t SoundboardSource::getTime()
+{
+	return engine.getPosition() * 1000 / engine.getSampleRate();
+}
+
+void SoundboardSource::setTime(int64_t ms)
+{
+	EngineCommand cmd;
+	cmd.type = EngineCommand::Type::Seek;
+	cmd.frame = ms * engine.getSampleRate() / 1000;
+	engine.submit(std::move(cmd));
+}
+
+int64_t SoundboardSource::getDuration()
+{
+	return engine.getDuration() * 1000 / engine.getSampleRate();
+}
+
+obs_media_state SoundboardSource::getMediaState()
+{
+	switch (engine.getState()) {
+	case EngineState::Playing:
+		return OBS_MEDIA_STATE_PLAYING;
+	case EngineState::Paused:
+		return OBS_MEDIA_STATE_PAUSED;
+	case EngineState::Stopped:
+		return OBS_MEDIA_STATE_STOPPED;
+	case EngineState::Ended:
+		return OBS_MEDIA_STATE_ENDED;
+	case EngineState::None:
+		break;
+	}
+
+	return OBS_MEDIA_STATE_NONE;
+}
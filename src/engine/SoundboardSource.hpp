@@ -0,0 +1,76 @@
+#pragma once
+
+#include "PlaybackEngine.hpp"
+
+#include <obs.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define SOUNDBOARD_SOURCE_ID "soundboard_source"
+
+// One sound of a layer or variation pad, with the clip it plays already
+// taken from the cache.
+struct SoundLayer {
+	std::shared_ptr<ClipEntry> clip;
+	float gain = 1.0f;
+	int64_t offsetMs = 0;
+};
+
+// Private input source that plays the soundboard engine. It implements the
+// media callbacks so the regular media controls work with it.
+class SoundboardSource {
+	obs_source_t *source;
+	PlaybackEngine engine;
+
+	std::atomic<bool> active = true;
+	std::thread thread;
+
+	// Exhaustion counts that were already logged, only touched by the
+	// render thread.
+	uint64_t reportedVoices = 0;
+	uint64_t reportedScheduled = 0;
+	uint64_t reportedArena = 0;
+
+	void renderThread();
+	void dispatchEvents(uint32_t events);
+	void logExhaustion();
+
+public:
+	SoundboardSource(obs_source_t *source, uint32_t sampleRate, size_t channels, const EngineConfig &config);
+	~SoundboardSource();
+
+	static void registerSource();
+	static SoundboardSource *fromSource(obs_source_t *source);
+
+	PlaybackEngine &getEngine() { return engine; }
+
+	void play(const std::string &path, const PlayOptions &options);
+	void play(std::shared_ptr<ClipEntry> clip, const PlayOptions &options);
+	// Starts all layers with a single command, so they are sample aligned.
+	void playLayers(const std::vector<SoundLayer> &layers, const PlayOptions &options);
+	void enqueue(const std::string &path, float gain, uint32_t tag, bool autoStart);
+	void clearQueue();
+
+	// Sets the grid quantized sounds snap to, in beats per minute and
+	// beats per grid step.
+	void setTempo(double bpm, double gridBeats);
+
+	void playPause(bool pause);
+	void restart();
+	void stop();
+	void next();
+	void previous();
+	int64_t getTime();
+	void setTime(int64_t ms);
+	int64_t getDuration();
+	obs_media_state getMediaState();
+
+	// Latency, render time and voice statistics, one line each.
+	std::vector<std::string> getStatsReport();
+	// The clip cache is shared by every source, so it is reported once.
+	static std::vector<std::string> getCacheReport();
+};
@@ -0,0 +1,47 @@
+#include "VariationGroup.hpp"
+
+#include <random>
+
+namespace {
+int randomIndex(int count)
+{
+	thread_local std::minstd_rand generator(std::random_device{}());
+	return std::uniform_int_distribution<int>(0, count - 1)(generator);
+}
+} // namespace
+
+int VariationGroup::next(int count)
+{
+	if (count <= 0)
+		return -1;
+
+	VariationMode current = getMode();
+	int previous = last.load(std::memory_order_relaxed);
+	int picked;
+
+	// Hotkeys can press the same pad from several threads, so the
+	// selection is claimed with a compare and swap instead of a lock.
+	do {
+		switch (current) {
+		case VariationMode::Random:
+			picked = randomIndex(count);
+			break;
+		case VariationMode::RandomNoRepeat:
+			if (count == 1 || previous < 0 || previous >= count) {
+				picked = randomIndex(count);
+			} else {
+				picked = randomIndex(count - 1);
+
+				if (picked >= previous)
+					picked++;
+			}
+			break;
+		case VariationMode::RoundRobin:
+		default:
+			picked = (previous + 1) % count;
+			break;
+		}
+	} while (!last.compare_exchange_weak(previous, picked, std::memory_order_relaxed));
+
+	return picked;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+enum class VariationMode { RoundRobin, Random, RandomNoRepeat };
+
+// Which variation of a group plays next. The pad and every board it was
+// published on share one, so a hotkey thread and the UI pick from the same
+// rotation. Any thread can pick, without taking a lock.
+class VariationGroup {
+	std::atomic<VariationMode> mode = VariationMode::RoundRobin;
+	std::atomic<int> last = -1;
+
+public:
+	void setMode(VariationMode newMode) { mode.store(newMode, std::memory_order_relaxed); }
+	VariationMode getMode() const { return mode.load(std::memory_order_relaxed); }
+
+	// Picks the index of the variation to play out of count sounds, or -1
+	// if there are none.
+	int next(int count);
+
+	// Index of the variation picked last, saved with the pad so round robin
+	// goes on where it stopped.
+	void setIndex(int index) { last.store(index, std::memory_order_relaxed); }
+	int getIndex() const { return last.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,303 @@
+#include "ClipStore.hpp"
+
+#include <obs.hpp>
+
+#include <algorithm>
+
+#define QT_UTF8(str) QString::fromUtf8(str, -1)
+#define QT_TO_UTF8(str) str.toUtf8().constData()
+
+StringPool::StringPool()
+{
+	intern(QString());
+}
+
+uint32_t StringPool::intern(const QString &str)
+{
+	auto it = ids.constFind(str);
+
+	if (it != ids.constEnd())
+		return it.value();
+
+	uint32_t id = (uint32_t)strings.size();
+	strings.append(str);
+	ids.insert(str, id);
+
+	return id;
+}
+
+uint32_t StringPool::find(const QString &str) const
+{
+	return ids.value(str, npos);
+}
+
+ClipStore &ClipStore::get()
+{
+	static ClipStore store;
+	return store;
+}
+
+void ClipStore::add(uint32_t handle, const QString &uuid, const QString &name, const QString &path)
+{
+	size_t index = handleIndex(handle);
+
+	if (index >= handles.size()) {
+		size_t size = index + 1;
+
+		handles.resize(size, invalidHandle);
+		uuids.resize(size);
+		names.resize(size);
+		paths.resize(size);
+		buses.resize(size);
+		volumes.resize(size);
+		flags.resize(size);
+		padTypes.resize(size);
+		probeStates.resize(size);
+		probeContainers.resize(size);
+		probeCodecs.resize(size);
+		probeErrors.resize(size);
+		probeRates.resize(size);
+		probeChannels.resize(size);
+		probeDurations.resize(size);
+		probeSizes.resize(size);
+		probeModified.resize(size);
+	}
+
+	handles[index] = handle;
+	uuids[index] = strings.intern(uuid);
+	names[index] = strings.intern(name);
+	paths[index] = strings.intern(path);
+	buses[index] = 0;
+	volumes[index] = 1.0f;
+	flags[index] = 0;
+	padTypes[index] = 0;
+	probeStates[index] = NotProbed;
+	probeSizes[index] = -1;
+	probeModified[index] = -1;
+
+	uuidHandles.insert(uuids[index], handle);
+	count++;
+}
+
+void ClipStore::remove(uint32_t handle)
+{
+	size_t index = handleIndex(handle);
+
+	if (index >= handles.size() || handles[index] != handle)
+		return;
+
+	uuidHandles.remove(uuids[index]);
+	handles[index] = invalidHandle;
+	count--;
+}
+
+void ClipStore::clear()
+{
+	// Assigning empty columns gives their memory back, clearing them would
+	// keep it.
+	*this = ClipStore();
+}
+
+void ClipStore::setPath(uint32_t handle, const QString &path)
+{
+	size_t index = handleIndex(handle);
+	uint32_t id = strings.intern(path);
+
+	if (paths[index] != id)
+		probeStates[index] = NotProbed;
+
+	paths[index] = id;
+}
+
+void ClipStore::setProbe(uint32_t handle, const AudioProbe &probe, int64_t size, int64_t modified)
+{
+	size_t index = handleIndex(handle);
+
+	probeStates[index] = probe.playable ? Playable : Unplayable;
+	probeContainers[index] = strings.intern(QT_UTF8(probe.container.c_str()));
+	probeCodecs[index] = strings.intern(QT_UTF8(probe.codec.c_str()));
+	probeErrors[index] = strings.intern(QT_UTF8(probe.error.c_str()));
+	probeRates[index] = probe.sampleRate;
+	probeChannels[index] = (uint8_t)std::min<uint32_t>(probe.channels, UINT8_MAX);
+	probeDurations[index] = probe.durationMs;
+	probeSizes[index] = size;
+	probeModified[index] = modified;
+}
+
+AudioProbe ClipStore::getProbe(uint32_t handle) const
+{
+	size_t index = handleIndex(handle);
+	AudioProbe probe;
+
+	if (probeStates[index] == NotProbed)
+		return probe;
+
+	probe.playable = probeStates[index] == Playable;
+	probe.container = QT_TO_UTF8(strings.get(probeContainers[index]));
+	probe.codec = QT_TO_UTF8(strings.get(probeCodecs[index]));
+	probe.error = QT_TO_UTF8(strings.get(probeErrors[index]));
+	probe.sampleRate = probeRates[index];
+	probe.channels = probeChannels[index];
+	probe.durationMs = probeDurations[index];
+
+	return probe;
+}
+
+bool ClipStore::isProbeCurrent(uint32_t handle, int64_t size, int64_t modified) const
+{
+	size_t index = handleIndex(handle);
+	return probeStates[index] != NotProbed && probeSizes[index] == size && probeModified[index] == modified;
+}
+
+ProbeSummary ClipStore::summarizeProbes() const
+{
+	ProbeSummary summary;
+
+	for (size_t i = 0; i < handles.size(); i++) {
+		if (handles[i] == invalidHandle || probeStates[i] == NotProbed)
+			continue;
+
+		summary.probed++;
+
+		if (probeStates[i] == Unplayable)
+			summary.unplayable++;
+		else
+			summary.durationMs += probeDurations[i];
+	}
+
+	return summary;
+}
+
+void ClipStore::setFlag(uint32_t handle, Flag flag, bool enable)
+{
+	uint8_t &value = flags[handleIndex(handle)];
+	value = (uint8_t)(enable ? value | flag : value & ~flag);
+}
+
+void ClipStore::save(uint32_t handle, obs_data_t *settings) const
+{
+	size_t index = handleIndex(handle);
+
+	obs_data_set_string(settings, "name", QT_TO_UTF8(strings.get(names[index])));
+	obs_data_set_string(settings, "path", QT_TO_UTF8(strings.get(paths[index])));
+	obs_data_set_bool(settings, "loop", flags[index] & Loop);
+	obs_data_set_bool(settings, "overlap", flags[index] & Overlap);
+	obs_data_set_bool(settings, "quantize", flags[index] & Quantize);
+	obs_data_set_double(settings, "volume", (double)volumes[index]);
+	obs_data_set_string(settings, "bus", QT_TO_UTF8(strings.get(buses[index])));
+
+	if (probeStates[index] == NotProbed)
+		return;
+
+	OBSDataAutoRelease probe = obs_data_create();
+	obs_data_set_bool(probe, "playable", probeStates[index] == Playable);
+	obs_data_set_string(probe, "container", QT_TO_UTF8(strings.get(probeContainers[index])));
+	obs_data_set_string(probe, "codec", QT_TO_UTF8(strings.get(probeCodecs[index])));
+	obs_data_set_int(probe, "sample_rate", probeRates[index]);
+	obs_data_set_int(probe, "channels", probeChannels[index]);
+	obs_data_set_int(probe, "duration_ms", probeDurations[index]);
+	obs_data_set_string(probe, "error", QT_TO_UTF8(strings.get(probeErrors[index])));
+	obs_data_set_int(probe, "file_size", probeSizes[index]);
+	obs_data_set_int(probe, "file_modified", probeModified[index]);
+	obs_data_set_obj(settings, "probe", probe);
+}
+
+void ClipStore::load(uint32_t handle, obs_data_t *settings)
+{
+	size_t index = handleIndex(handle);
+
+	obs_data_set_default_double(settings, "volume", 1.0);
+
+	setFlag(handle, Loop, obs_data_get_bool(settings, "loop"));
+	setFlag(handle, Overlap, obs_data_get_bool(settings, "overlap"));
+	setFlag(handle, Quantize, obs_data_get_bool(settings, "quantize"));
+	volumes[index] = (float)obs_data_get_double(settings, "volume");
+	buses[index] = strings.intern(QString::fromUtf8(obs_data_get_string(settings, "bus")));
+
+	// The probe of the last session is kept as long as the file did not
+	// change, so a large board is not probed again on every start.
+	OBSDataAutoRelease probeData = obs_data_get_obj(settings, "probe");
+
+	if (!probeData)
+		return;
+
+	AudioProbe probe;
+	probe.playable = obs_data_get_bool(probeData, "playable");
+	probe.container = obs_data_get_string(probeData, "container");
+	probe.codec = obs_data_get_string(probeData, "codec");
+	probe.sampleRate = (uint32_t)obs_data_get_int(probeData, "sample_rate");
+	probe.channels = (uint32_t)obs_data_get_int(probeData, "channels");
+	probe.durationMs = obs_data_get_int(probeData, "duration_ms");
+	probe.error = obs_data_get_string(probeData, "error");
+	setProbe(handle, probe, obs_data_get_int(probeData, "file_size"), obs_data_get_int(probeData, "file_modified"));
+}
+
+uint32_t ClipStore::findByUUID(const QString &uuid) const
+{
+	uint32_t id = strings.find(uuid);
+	return id == StringPool::npos ? invalidHandle : uuidHandles.value(id, invalidHandle);
+}
+
+uint32_t ClipStore::findByName(const QString &name) const
+{
+	uint32_t id = strings.find(name);
+
+	if (id == StringPool::npos)
+		return invalidHandle;
+
+	for (size_t i = 0; i < names.size(); i++) {
+		if (names[i] == id && handles[i] != invalidHandle)
+			return handles[i];
+	}
+
+	return invalidHandle;
+}
+
+std::vector<uint32_t> ClipStore::findByPath(const QString &path) const
+{
+	std::vector<uint32_t> found;
+	uint32_t id = strings.find(path);
+
+	if (id == StringPool::npos)
+		return found;
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (paths[i] == id && handles[i] != invalidHandle)
+			found.push_back(handles[i]);
+	}
+
+	return found;
+}
+
+bool ClipStore::isPathUsed(const QString &path, uint32_t ignore) const
+{
+	uint32_t id = strings.find(path);
+
+	if (id == StringPool::npos)
+		return false;
+
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (paths[i] == id && handles[i] != invalidHandle && handles[i] != ignore)
+			return true;
+	}
+
+	return false;
+}
+
+size_t ClipStore::memoryUsage() const
+{
+	size_t ids = handles.capacity() + uuids.capacity() + names.capacity() + paths.capacity() + buses.capacity();
+	ids += probeContainers.capacity() + probeCodecs.capacity() + probeErrors.capacity() + probeRates.capacity();
+	size_t times = probeDurations.capacity() + probeSizes.capacity() + probeModified.capacity();
+	size_t bytes = ids * sizeof(uint32_t) + times * sizeof(int64_t) + volumes.capacity() * sizeof(float) +
+		       flags.capacity() + padTypes.capacity() + probeStates.capacity() + probeChannels.capacity();
+
+	// Each string is counted with its list entry and hash node, which is
+	// close to what QList and QHash allocate.
+	for (size_t i = 0; i < strings.size(); i++) {
+		size_t characters = (size_t)strings.get((uint32_t)i).capacity();
+		bytes += sizeof(QString) * 2 + sizeof(uint32_t) + characters * sizeof(QChar);
+	}
+
+	return bytes;
+}
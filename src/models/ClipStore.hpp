@@ -0,0 +1,136 @@
+#pragma once
+
+#include "engine/AudioDecoder.hpp"
+#include "engine/HandleTable.hpp"
+
+#include <obs.h>
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+// Interns strings, so equal strings share one id and one copy. Strings are
+// kept until the store that owns the pool is cleared.
+class StringPool {
+	QList<QString> strings;
+	QHash<QString, uint32_t> ids;
+
+public:
+	static constexpr uint32_t npos = UINT32_MAX;
+
+	// The empty string always has id 0.
+	StringPool();
+
+	uint32_t intern(const QString &str);
+	// Returns npos if the string was never interned.
+	uint32_t find(const QString &str) const;
+	const QString &get(uint32_t id) const { return strings[id]; }
+	size_t size() const { return (size_t)strings.size(); }
+};
+
+// Totals over the probes of every sound.
+struct ProbeSummary {
+	size_t probed = 0;
+	size_t unplayable = 0;
+	int64_t durationMs = 0;
+};
+
+// The settings of every sound, kept column by column and addressed by the
+// slot of the sound's handle, so scanning one setting over the whole board
+// reads one packed array. Names, paths, buses, UUIDs and the strings of the
+// probes are interned, comparing them while scanning compares integers.
+// MediaObj is the Qt side of a sound and reads and writes its settings here.
+// Only used on the UI thread.
+class ClipStore {
+public:
+	enum Flag : uint8_t {
+		Loop = 1 << 0,
+		Overlap = 1 << 1,
+		Quantize = 1 << 2,
+	};
+
+private:
+	// Handle of the sound in each slot, invalidHandle for a free slot.
+	std::vector<uint32_t> handles;
+	std::vector<uint32_t> uuids;
+	std::vector<uint32_t> names;
+	std::vector<uint32_t> paths;
+	std::vector<uint32_t> buses;
+	std::vector<float> volumes;
+	std::vector<uint8_t> flags;
+	std::vector<uint8_t> padTypes;
+
+	// Result of probing each sound's file, stamped with the size and
+	// modification time of the file it was taken from.
+	enum ProbeState : uint8_t { NotProbed, Playable, Unplayable };
+	std::vector<uint8_t> probeStates;
+	std::vector<uint32_t> probeContainers;
+	std::vector<uint32_t> probeCodecs;
+	std::vector<uint32_t> probeErrors;
+	std::vector<uint32_t> probeRates;
+	std::vector<uint8_t> probeChannels;
+	std::vector<int64_t> probeDurations;
+	std::vector<int64_t> probeSizes;
+	std::vector<int64_t> probeModified;
+
+	StringPool strings;
+	QHash<uint32_t, uint32_t> uuidHandles;
+	size_t count = 0;
+
+public:
+	static ClipStore &get();
+
+	void add(uint32_t handle, const QString &uuid, const QString &name, const QString &path);
+	void remove(uint32_t handle);
+	// Frees the columns and starts a new string pool, which removing sounds
+	// never shrinks. Only called once every sound was removed.
+	void clear();
+
+	const QString &getUUID(uint32_t handle) const { return strings.get(uuids[handleIndex(handle)]); }
+	const QString &getName(uint32_t handle) const { return strings.get(names[handleIndex(handle)]); }
+	const QString &getPath(uint32_t handle) const { return strings.get(paths[handleIndex(handle)]); }
+	const QString &getBus(uint32_t handle) const { return strings.get(buses[handleIndex(handle)]); }
+	float getVolume(uint32_t handle) const { return volumes[handleIndex(handle)]; }
+	bool hasFlag(uint32_t handle, Flag flag) const { return flags[handleIndex(handle)] & flag; }
+	uint8_t getPadType(uint32_t handle) const { return padTypes[handleIndex(handle)]; }
+
+	void setName(uint32_t handle, const QString &name) { names[handleIndex(handle)] = strings.intern(name); }
+	// Changing the path drops the probe.
+	void setPath(uint32_t handle, const QString &path);
+	void setBus(uint32_t handle, const QString &bus) { buses[handleIndex(handle)] = strings.intern(bus); }
+	void setVolume(uint32_t handle, float volume) { volumes[handleIndex(handle)] = volume; }
+	void setFlag(uint32_t handle, Flag flag, bool enable);
+	void setPadType(uint32_t handle, uint8_t type) { padTypes[handleIndex(handle)] = type; }
+
+	void setProbe(uint32_t handle, const AudioProbe &probe, int64_t size, int64_t modified);
+	AudioProbe getProbe(uint32_t handle) const;
+	bool isProbed(uint32_t handle) const { return probeStates[handleIndex(handle)] != NotProbed; }
+	bool isProbeCurrent(uint32_t handle, int64_t size, int64_t modified) const;
+	int64_t getProbeSize(uint32_t handle) const { return probeSizes[handleIndex(handle)]; }
+	int64_t getProbeModified(uint32_t handle) const { return probeModified[handleIndex(handle)]; }
+	ProbeSummary summarizeProbes() const;
+
+	// Writes the sound's settings and probe to its saved data. Loading reads
+	// them back into a sound that was added with the saved name and path.
+	void save(uint32_t handle, obs_data_t *settings) const;
+	void load(uint32_t handle, obs_data_t *settings);
+
+	// Return invalidHandle if no sound matches.
+	uint32_t findByUUID(const QString &uuid) const;
+	uint32_t findByName(const QString &name) const;
+	std::vector<uint32_t> findByPath(const QString &path) const;
+	bool isPathUsed(const QString &path, uint32_t ignore = invalidHandle) const;
+	bool contains(uint32_t handle) const
+	{
+		size_t index = handleIndex(handle);
+		return index < handles.size() && handles[index] == handle;
+	}
+
+	// Number of sounds in the store.
+	size_t size() const { return count; }
+	// Memory held by the columns and the interned strings, in bytes.
+	size_t memoryUsage() const;
+};
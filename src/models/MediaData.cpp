@@ -1,31 +1,62 @@
 #include "MediaData.hpp"
+#include "ClipStore.hpp"
+#include "engine/BoardSnapshot.hpp"
 #include <util/platform.h>
 #include <util/util.hpp>
 #include <obs-module.h>
 
+#include <QCoreApplication>
+
 #define QTStr(str) QString(obs_module_text(str))
 #define QT_UTF8(str) QString::fromUtf8(str, -1)
 #define QT_TO_UTF8(str) str.toUtf8().constData()
 
+MediaSignals *MediaSignals::get()
+{
+	static MediaSignals instance;
+	return &instance;
+}
+
+MediaObj *MediaLayer::getMedia() const
+{
+	return MediaObj::fromId(media);
+}
+
 std::vector<MediaObj *> MediaObj::mediaItems;
+HandleTable<MediaObj *> MediaObj::handles;
 
-MediaObj::MediaObj(const QString &name_, const QString &path_) : name(name_), path(path_)
+MediaObj::MediaObj(const QString &name, const QString &path) : id(handles.insert(this))
 {
-	BPtr<char> uuid_ = os_generate_uuid();
-	uuid = uuid_.Get();
+	BPtr<char> uuid = os_generate_uuid();
+	ClipStore::get().add(id, uuid.Get(), name, path);
 
 	QString hotkeyName = QTStr("SoundHotkey").arg(name);
 
+	// The hotkey gets the sound's handle rather than the sound, a press
+	// that races with the sound being deleted is dropped.
 	auto playSound = [](void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed) {
-		MediaObj *sound = static_cast<MediaObj *>(data);
+		uint32_t id = (uint32_t)(uintptr_t)data;
+
+		if (!pressed)
+			return;
+
+		// Take the time on the hotkey thread, so the sound is scheduled for
+		// the moment the key was pressed. Sounds and pads play from the
+		// published board right away. Only the playlist and clips the
+		// board has not pinned yet go through the UI.
+		uint64_t timestamp = os_gettime_ns();
 
-		if (pressed)
-			QMetaObject::invokeMethod(sound, &MediaObj::pressed);
-		else
-			QMetaObject::invokeMethod(sound, &MediaObj::released);
+		if (triggerBoardClip(id, timestamp))
+			return;
+
+		QMetaObject::invokeMethod(qApp, [id, timestamp]() {
+			if (MediaObj *sound = MediaObj::fromId(id))
+				sound->pressed(timestamp);
+		});
 	};
 
-	hotkey = obs_hotkey_register_frontend(QT_TO_UTF8(hotkeyName), QT_TO_UTF8(hotkeyName), playSound, this);
+	hotkey = obs_hotkey_register_frontend(QT_TO_UTF8(hotkeyName), QT_TO_UTF8(hotkeyName), playSound,
+					      (void *)(uintptr_t)id);
 
 	mediaItems.emplace_back(this);
 }
@@ -33,61 +64,84 @@ MediaObj::MediaObj(const QString &name_, const QString &path_) : name(name_), pa
 MediaObj::~MediaObj()
 {
 	obs_hotkey_unregister(hotkey);
+	ClipStore::get().remove(id);
+	handles.remove(id);
 	mediaItems.erase(std::remove(mediaItems.begin(), mediaItems.end(), this), mediaItems.end());
 }
 
 MediaObj *MediaObj::findByName(const QString &name)
 {
-	for (auto &media : mediaItems) {
-		if (media->name == name)
-			return media;
-	}
+	return handles.get(ClipStore::get().findByName(name));
+}
+
+bool MediaObj::isPathUsed(const QString &path, const MediaObj *ignore)
+{
+	return ClipStore::get().isPathUsed(path, ignore ? ignore->id : invalidHandle);
+}
+
+std::vector<MediaObj *> MediaObj::findByPath(const QString &path)
+{
+	std::vector<MediaObj *> found;
+
+	for (uint32_t handle : ClipStore::get().findByPath(path))
+		found.push_back(handles.get(handle));
 
-	return nullptr;
+	return found;
 }
 
-MediaObj *MediaObj::findByUUID(const QString &uuid)
+const std::vector<MediaObj *> &MediaObj::getAll()
 {
-	for (auto &media : mediaItems) {
-		if (media->uuid == uuid)
-			return media;
-	}
+	return mediaItems;
+}
 
-	return nullptr;
+MediaObj *MediaObj::findByUUID(const QString &uuid)
+{
+	return handles.get(ClipStore::get().findByUUID(uuid));
 }
 
 QString MediaObj::getUUID()
 {
-	return uuid;
+	return ClipStore::get().getUUID(id);
+}
+
+uint32_t MediaObj::getId()
+{
+	return id;
+}
+
+MediaObj *MediaObj::fromId(uint32_t id)
+{
+	return handles.get(id);
 }
 
 void MediaObj::setName(const QString &newName)
 {
-	if (newName.isEmpty() || name == newName)
+	if (newName.isEmpty() || getName() == newName)
 		return;
 
-	name = newName;
+	ClipStore::get().setName(id, newName);
 
-	QString hotkeyName = QTStr("SoundHotkey").arg(name);
+	QString hotkeyName = QTStr("SoundHotkey").arg(newName);
 	obs_hotkey_set_name(hotkey, QT_TO_UTF8(hotkeyName));
 	obs_hotkey_set_description(hotkey, QT_TO_UTF8(hotkeyName));
 
-	emit renamed(this);
+	emit MediaSignals::get()->renamed(this);
 }
 
 QString MediaObj::getName()
 {
-	return name;
+	return ClipStore::get().getName(id);
 }
 
 void MediaObj::setPath(const QString &newPath)
 {
-	path = newPath;
+	ClipStore::get().setPath(id, newPath);
+	emit MediaSignals::get()->changed(this);
 }
 
 QString MediaObj::getPath()
 {
-	return path;
+	return ClipStore::get().getPath(id);
 }
 
 obs_hotkey_id MediaObj::getHotkey()
@@ -97,30 +151,150 @@ obs_hotkey_id MediaObj::getHotkey()
 
 void MediaObj::setLoopEnabled(bool enable)
 {
-	loop = enable;
+	ClipStore::get().setFlag(id, ClipStore::Loop, enable);
+	emit MediaSignals::get()->changed(this);
 }
 
 bool MediaObj::loopEnabled()
 {
-	return loop;
+	return ClipStore::get().hasFlag(id, ClipStore::Loop);
+}
+
+void MediaObj::setOverlapEnabled(bool enable)
+{
+	ClipStore::get().setFlag(id, ClipStore::Overlap, enable);
+	emit MediaSignals::get()->changed(this);
+}
+
+bool MediaObj::overlapEnabled()
+{
+	return ClipStore::get().hasFlag(id, ClipStore::Overlap);
+}
+
+void MediaObj::setQuantizeEnabled(bool enable)
+{
+	ClipStore::get().setFlag(id, ClipStore::Quantize, enable);
+	emit MediaSignals::get()->changed(this);
+}
+
+bool MediaObj::quantizeEnabled()
+{
+	return ClipStore::get().hasFlag(id, ClipStore::Quantize);
 }
 
 void MediaObj::setVolume(float newVolume)
 {
-	volume = newVolume;
+	ClipStore::get().setVolume(id, newVolume);
+	emit MediaSignals::get()->changed(this);
 }
 
 float MediaObj::getVolume()
 {
-	return volume;
+	return ClipStore::get().getVolume(id);
+}
+
+void MediaObj::setBus(const QString &newBus)
+{
+	ClipStore::get().setBus(id, newBus);
+	emit MediaSignals::get()->changed(this);
+}
+
+QString MediaObj::getBus()
+{
+	return ClipStore::get().getBus(id);
+}
+
+void MediaObj::setPadType(PadType type)
+{
+	ClipStore::get().setPadType(id, (uint8_t)type);
+	emit MediaSignals::get()->changed(this);
+}
+
+PadType MediaObj::getPadType()
+{
+	return (PadType)ClipStore::get().getPadType(id);
+}
+
+bool MediaObj::isPad()
+{
+	return getPadType() != PadType::Sound;
+}
+
+void MediaObj::setLayers(const QList<MediaLayer> &newLayers)
+{
+	layers = newLayers;
+	emit MediaSignals::get()->changed(this);
+}
+
+QList<MediaLayer> MediaObj::getLayers()
+{
+	return layers;
+}
+
+void MediaObj::setVariationMode(VariationMode mode)
+{
+	getVariationGroup()->setMode(mode);
+}
+
+VariationMode MediaObj::getVariationMode()
+{
+	return variations ? variations->getMode() : VariationMode::RoundRobin;
+}
+
+int MediaObj::nextVariation(int count)
+{
+	return getVariationGroup()->next(count);
+}
+
+void MediaObj::setVariationIndex(int index)
+{
+	getVariationGroup()->setIndex(index);
+}
+
+int MediaObj::getVariationIndex()
+{
+	return variations ? variations->getIndex() : -1;
+}
+
+std::shared_ptr<VariationGroup> MediaObj::getVariationGroup()
+{
+	if (!variations)
+		variations = std::make_shared<VariationGroup>();
+
+	return variations;
+}
+
+void MediaObj::pressed(uint64_t timestamp)
+{
+	emit MediaSignals::get()->hotkeyPressed(this, timestamp);
+}
+
+void MediaObj::setProbe(const AudioProbe &result, qint64 size, qint64 modified)
+{
+	ClipStore::get().setProbe(id, result, size, modified);
+}
+
+AudioProbe MediaObj::getProbe()
+{
+	return ClipStore::get().getProbe(id);
+}
+
+bool MediaObj::isProbed()
+{
+	return ClipStore::get().isProbed(id);
+}
+
+bool MediaObj::isProbeCurrent(qint64 size, qint64 modified)
+{
+	return ClipStore::get().isProbeCurrent(id, size, modified);
 }
 
-void MediaObj::pressed()
+qint64 MediaObj::getProbeSize()
 {
-	emit hotkeyPressed(this);
+	return ClipStore::get().getProbeSize(id);
 }
 
-void MediaObj::released()
+qint64 MediaObj::getProbeModified()
 {
-	emit hotkeyReleased(this);
+	return ClipStore::get().getProbeModified(id);
 }
@@ -2,27 +2,73 @@
 
 #include <obs.hpp>
 
+#include "engine/AudioDecoder.hpp"
+#include "engine/HandleTable.hpp"
+#include "engine/VariationGroup.hpp"
+
+#include <QList>
 #include <QObject>
+#include <memory>
 #include <vector>
 
-class MediaObj : public QObject {
+class MediaObj;
+
+enum class PadType {
+	Sound,
+	// Starts all of its sounds at once.
+	Layers,
+	// Picks one of its sounds each time it is pressed.
+	Variations,
+};
+
+// A sound played by a pad, the offset is in milliseconds. The sound is
+// referred to by its handle, so a deleted sound is simply skipped.
+struct MediaLayer {
+	uint32_t media = invalidHandle;
+	int offset = 0;
+	float gain = 1.0f;
+
+	// Returns nullptr if the sound was deleted.
+	MediaObj *getMedia() const;
+};
+
+// The signals of every sound. One object for the whole board, so a sound
+// does not need a QObject of its own.
+class MediaSignals : public QObject {
 	Q_OBJECT
 
+public:
+	static MediaSignals *get();
+
+signals:
+	// The hotkey could not play the sound from the published board.
+	void hotkeyPressed(MediaObj *obj, uint64_t timestamp);
+
+	// A setting that is published with the board changed.
+	void changed(MediaObj *obj);
+
+	void renamed(MediaObj *obj);
+};
+
+// A sound on the board. Its settings and probe are kept in the ClipStore,
+// the object itself only holds what a pad needs and the sound's hotkey.
+class MediaObj {
 private:
 	static std::vector<MediaObj *> mediaItems;
+	static HandleTable<MediaObj *> handles;
+
+	// The name, path and other settings are kept in the ClipStore under
+	// this handle.
+	uint32_t id;
 
-	QString uuid;
+	QList<MediaLayer> layers;
 
-	QString name = "";
-	QString path = "";
-	bool loop = false;
-	float volume = 1.0f;
+	// Created when the sound first becomes a variation group.
+	std::shared_ptr<VariationGroup> variations;
 
 	obs_hotkey_id hotkey = OBS_INVALID_HOTKEY_ID;
 
-private slots:
-	void pressed();
-	void released();
+	void pressed(uint64_t timestamp);
 
 public:
 	MediaObj(const QString &name, const QString &path);
@@ -30,8 +76,17 @@ public:
 
 	static MediaObj *findByUUID(const QString &uuid);
 	static MediaObj *findByName(const QString &name);
+	static bool isPathUsed(const QString &path, const MediaObj *ignore = nullptr);
+	static std::vector<MediaObj *> findByPath(const QString &path);
+	// Every sound, including removed ones that are not deleted yet.
+	static const std::vector<MediaObj *> &getAll();
 
 	QString getUUID();
+	// Handle of the sound for the session. Voices are tagged with it, and
+	// hotkeys and other threads refer to the sound by it.
+	uint32_t getId();
+	// Returns nullptr if the sound was deleted.
+	static MediaObj *fromId(uint32_t id);
 
 	void setName(const QString &newName);
 	QString getName();
@@ -44,12 +99,44 @@ public:
 	void setLoopEnabled(bool enable);
 	bool loopEnabled();
 
+	void setOverlapEnabled(bool enable);
+	bool overlapEnabled();
+
+	void setQuantizeEnabled(bool enable);
+	bool quantizeEnabled();
+
 	void setVolume(float volume);
 	float getVolume();
 
-signals:
-	void hotkeyPressed(MediaObj *obj);
-	void hotkeyReleased(MediaObj *obj);
-
-	void renamed(MediaObj *obj);
+	// Name of the bus the sound plays on, empty for the main bus.
+	void setBus(const QString &newBus);
+	QString getBus();
+
+	void setPadType(PadType type);
+	PadType getPadType();
+	bool isPad();
+
+	void setLayers(const QList<MediaLayer> &newLayers);
+	QList<MediaLayer> getLayers();
+
+	void setVariationMode(VariationMode mode);
+	VariationMode getVariationMode();
+
+	// Picks the index of the variation to play out of count sounds.
+	int nextVariation(int count);
+	void setVariationIndex(int index);
+	int getVariationIndex();
+	// The selection state, shared with the published board so hotkeys pick
+	// from the same rotation as the UI.
+	std::shared_ptr<VariationGroup> getVariationGroup();
+
+	// Result of probing the sound's file, stamped with the size and
+	// modification time of the file it was taken from. Changing the path
+	// drops it.
+	void setProbe(const AudioProbe &result, qint64 size, qint64 modified);
+	AudioProbe getProbe();
+	bool isProbed();
+	bool isProbeCurrent(qint64 size, qint64 modified);
+	qint64 getProbeSize();
+	qint64 getProbeModified();
 };
@@ -0,0 +1,198 @@
+#include "TestSupport.hpp"
+#include "fake-obs.hpp"
+#include "engine/RealtimeCheck.hpp"
+
+#include <util/platform.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace {
+int failures = 0;
+
+#ifdef ENABLE_RT_CHECKS
+// Logging, file I/O and sleeping in the fake libobs count as blocking calls.
+struct BlockingHook {
+	BlockingHook()
+	{
+		fake_obs::setBlockingHook([](const char *what) { RT_BLOCKING(what); });
+	}
+} blockingHook;
+#endif
+
+void putU16(std::vector<uint8_t> &out, uint16_t value)
+{
+	out.push_back((uint8_t)value);
+	out.push_back((uint8_t)(value >> 8));
+}
+
+void putU32(std::vector<uint8_t> &out, uint32_t value)
+{
+	putU16(out, (uint16_t)value);
+	putU16(out, (uint16_t)(value >> 16));
+}
+
+void putTag(std::vector<uint8_t> &out, const char *tag)
+{
+	out.insert(out.end(), tag, tag + 4);
+}
+
+struct TempDir {
+	std::string path;
+
+	TempDir()
+	{
+		std::string pattern = (std::filesystem::temp_directory_path() / "soundboard-test-XXXXXX").string();
+		std::vector<char> name(pattern.begin(), pattern.end());
+		name.push_back('\0');
+
+		if (mkdtemp(name.data()))
+			path = name.data();
+	}
+
+	~TempDir()
+	{
+		std::error_code error;
+
+		if (!path.empty())
+			std::filesystem::remove_all(path, error);
+	}
+};
+} // namespace
+
+void test::fail(const char *file, int line, const char *cond)
+{
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+	failures++;
+}
+
+int test::result()
+{
+	if (failures)
+		fprintf(stderr, "%d checks failed\n", failures);
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+const std::string &test::tempDir()
+{
+	static TempDir dir;
+	return dir.path;
+}
+
+bool test::writeWav(const std::string &path, uint32_t sampleRate, size_t channels, size_t frames, WavFormat format,
+		    const std::function<float(size_t frame, size_t channel)> &generator)
+{
+	const uint16_t bits = format == WavFormat::F32 ? 32 : format == WavFormat::S24 ? 24 : 16;
+	const uint32_t blockAlign = (uint32_t)channels * bits / 8;
+	const uint32_t dataBytes = (uint32_t)frames * blockAlign;
+
+	std::vector<uint8_t> out;
+	out.reserve(44 + dataBytes);
+
+	putTag(out, "RIFF");
+	putU32(out, 36 + dataBytes);
+	putTag(out, "WAVE");
+	putTag(out, "fmt ");
+	putU32(out, 16);
+	putU16(out, format == WavFormat::F32 ? 3 : 1);
+	putU16(out, (uint16_t)channels);
+	putU32(out, sampleRate);
+	putU32(out, sampleRate * blockAlign);
+	putU16(out, (uint16_t)blockAlign);
+	putU16(out, bits);
+	putTag(out, "data");
+	putU32(out, dataBytes);
+
+	for (size_t f = 0; f < frames; f++) {
+		for (size_t c = 0; c < channels; c++) {
+			float sample = generator(f, c);
+
+			if (format == WavFormat::F32) {
+				uint32_t value;
+				memcpy(&value, &sample, sizeof(value));
+				putU32(out, value);
+			} else if (format == WavFormat::S24) {
+				float clamped = std::fmax(-1.0f, std::fmin(1.0f, sample));
+				uint32_t value = (uint32_t)(int32_t)std::lrint(clamped * 8388607.0f);
+				putU16(out, (uint16_t)value);
+				out.push_back((uint8_t)(value >> 16));
+			} else {
+				float clamped = std::fmax(-1.0f, std::fmin(1.0f, sample));
+				putU16(out, (uint16_t)(int16_t)std::lrint(clamped * 32767.0f));
+			}
+		}
+	}
+
+	FILE *file = os_fopen(path.c_str(), "wb");
+
+	if (!file)
+		return false;
+
+	bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+	return fclose(file) == 0 && written;
+}
+
+bool test::waitForClip(const std::shared_ptr<ClipEntry> &clip, int timeoutMs)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	while (clip && clip->getState() == ClipEntry::State::Pending) {
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return clip && clip->getState() == ClipEntry::State::Ready;
+}
+
+bool test::isQuick(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quick") == 0)
+			return true;
+	}
+
+	return false;
+}
+
+test::JsonLine::JsonLine(const char *bench)
+{
+	line = "{\"bench\":\"";
+	line += bench;
+	line += "\"";
+}
+
+test::JsonLine &test::JsonLine::add(const char *key, double value)
+{
+	char number[64];
+	snprintf(number, sizeof(number), "%.6g", std::isfinite(value) ? value : 0.0);
+
+	line += ",\"";
+	line += key;
+	line += "\":";
+	line += number;
+	return *this;
+}
+
+test::JsonLine &test::JsonLine::add(const char *key, const char *value)
+{
+	line += ",\"";
+	line += key;
+	line += "\":\"";
+	line += value;
+	line += "\"";
+	return *this;
+}
+
+void test::JsonLine::print()
+{
+	printf("%s}\n", line.c_str());
+	fflush(stdout);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "engine/ClipCache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Fails the test with the location of the check, without stopping it, so
+// one run reports every broken check.
+#define CHECK(cond)                                                                     \
+	do {                                                                            \
+		if (!(cond))                                                            \
+			test::fail(__FILE__, __LINE__, #cond);                          \
+	} while (false)
+
+namespace test {
+
+void fail(const char *file, int line, const char *cond);
+// Exit code of the test, non-zero if a check failed.
+int result();
+
+// Directory for the files of one test, removed when the process exits.
+const std::string &tempDir();
+
+// Writes a 16-bit, 24-bit or 32-bit float WAV file. The generator returns
+// the sample of a frame and channel, in the -1 to 1 range.
+enum class WavFormat { S16, S24, F32 };
+bool writeWav(const std::string &path, uint32_t sampleRate, size_t channels, size_t frames, WavFormat format,
+	      const std::function<float(size_t frame, size_t channel)> &generator);
+
+// Waits until the decode thread is done with the clip, up to the timeout.
+bool waitForClip(const std::shared_ptr<ClipEntry> &clip, int timeoutMs = 5000);
+
+// True if the bench was started with --quick, to run as a smoke test at
+// small sizes.
+bool isQuick(int argc, char **argv);
+
+// Prints one result as a line of JSON, so runs can be collected and
+// compared by scripts.
+class JsonLine {
+	std::string line;
+
+public:
+	explicit JsonLine(const char *bench);
+	JsonLine &add(const char *key, double value);
+	JsonLine &add(const char *key, const char *value);
+	void print();
+};
+
+} // namespace test
@@ -0,0 +1,199 @@
+// Times the board operations that scale with the number of sounds: adding,
+// probing, finding, scanning, renaming, saving, loading and clearing, from
+// 100 to 100k sounds, and reports what each sound costs in memory.
+
+#include "TestSupport.hpp"
+#include "models/ClipStore.hpp"
+
+#include <obs.hpp>
+
+#include <chrono>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double elapsedNs(Clock::time_point start, size_t count)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() /
+	       (double)(count ? count : 1);
+}
+
+void report(const char *op, size_t clips, double nsPerOp)
+{
+	test::JsonLine("board").add("op", op).add("clips", (double)clips).add("ns_per_op", nsPerOp).print();
+}
+
+QString soundName(size_t i)
+{
+	return QString("Sound %1").arg(i);
+}
+
+QString soundPath(size_t i)
+{
+	return QString("/sounds/folder%1/sound%2.wav").arg(i / 500).arg(i);
+}
+
+// Most sounds share a few formats, every tenth one failed to probe.
+AudioProbe soundProbe(size_t i)
+{
+	AudioProbe probe;
+
+	if (i % 10 == 9) {
+		probe.error = "Invalid data found when processing input";
+		return probe;
+	}
+
+	probe.playable = true;
+	probe.container = i % 2 ? "WAV" : "MP3";
+	probe.codec = i % 2 ? "pcm_s16le" : "mp3";
+	probe.sampleRate = i % 3 ? 48000 : 44100;
+	probe.channels = 2;
+	probe.durationMs = (int64_t)(i % 5000) + 100;
+	return probe;
+}
+
+void benchBoard(size_t count)
+{
+	HandleTable<size_t> table;
+	ClipStore store;
+	std::vector<uint32_t> handles;
+	handles.reserve(count);
+
+	auto start = Clock::now();
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t handle = table.insert(i);
+		store.add(handle, QString("uuid-%1").arg(i), soundName(i), soundPath(i));
+		handles.push_back(handle);
+	}
+
+	report("add", count, elapsedNs(start, count));
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < count; i++)
+		store.setProbe(handles[i], soundProbe(i), (int64_t)i * 1000, (int64_t)i);
+
+	report("probe", count, elapsedNs(start, count));
+
+	// The engine stats walk the whole board.
+	start = Clock::now();
+	ProbeSummary probes = store.summarizeProbes();
+	report("scan_probes", count, elapsedNs(start, count));
+	CHECK(probes.probed == count);
+	CHECK(probes.unplayable == count / 10);
+
+	// Lookups are spread over the whole board, so a linear scan shows up.
+	const size_t lookups = std::min<size_t>(count, 1000);
+	size_t found = 0;
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < lookups; i++)
+		found += store.findByName(soundName(i * count / lookups)) != invalidHandle;
+
+	report("find_name", count, elapsedNs(start, lookups));
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < lookups; i++)
+		found += store.isPathUsed(soundPath(i * count / lookups));
+
+	report("find_path", count, elapsedNs(start, lookups));
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < lookups; i++)
+		found += store.findByUUID(QString("uuid-%1").arg(i * count / lookups)) != invalidHandle;
+
+	report("find_uuid", count, elapsedNs(start, lookups));
+	CHECK(found == lookups * 3);
+
+	// What the list asks for when rows are drawn or hovered.
+	start = Clock::now();
+	size_t playable = 0;
+
+	for (size_t i = 0; i < lookups; i++) {
+		uint32_t handle = handles[i * count / lookups];
+		playable += store.getProbe(handle).playable && !store.getUUID(handle).isEmpty();
+	}
+
+	report("tooltip", count, elapsedNs(start, lookups));
+	CHECK(playable > 0);
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < lookups; i++)
+		store.setName(handles[i * count / lookups], QString("Renamed %1").arg(i));
+
+	report("rename", count, elapsedNs(start, lookups));
+
+	start = Clock::now();
+	OBSDataArrayAutoRelease saved = obs_data_array_create();
+
+	for (uint32_t handle : handles) {
+		OBSDataAutoRelease settings = obs_data_create();
+		store.save(handle, settings);
+		obs_data_array_push_back(saved, settings);
+	}
+
+	report("save", count, elapsedNs(start, count));
+
+	HandleTable<size_t> loadedTable;
+	ClipStore loaded;
+	uint32_t lastLoaded = invalidHandle;
+
+	start = Clock::now();
+
+	for (size_t i = 0; i < obs_data_array_count(saved); i++) {
+		OBSDataAutoRelease settings = obs_data_array_item(saved, i);
+		uint32_t handle = loadedTable.insert(i);
+
+		loaded.add(handle, QString("uuid-%1").arg(i), QString::fromUtf8(obs_data_get_string(settings, "name")),
+			   QString::fromUtf8(obs_data_get_string(settings, "path")));
+		loaded.load(handle, settings);
+		lastLoaded = handle;
+	}
+
+	report("load", count, elapsedNs(start, count));
+	CHECK(loaded.size() == count);
+	CHECK(loaded.summarizeProbes().probed == count);
+	CHECK(loaded.getProbe(lastLoaded).codec == soundProbe(count - 1).codec);
+
+	test::JsonLine("board")
+		.add("op", "memory")
+		.add("clips", (double)count)
+		.add("bytes_per_clip", (double)store.memoryUsage() / (double)count)
+		.print();
+
+	// Removing every sound keeps the columns and the interned strings, only
+	// clearing the store gives them back.
+	for (uint32_t handle : handles)
+		store.remove(handle);
+
+	size_t removedBytes = store.memoryUsage();
+
+	start = Clock::now();
+	store.clear();
+	report("clear", count, elapsedNs(start, count));
+	CHECK(store.size() == 0 && store.findByName(soundName(0)) == invalidHandle);
+
+	test::JsonLine("board")
+		.add("op", "memory_cleared")
+		.add("clips", (double)count)
+		.add("bytes_removed", (double)removedBytes)
+		.add("bytes_cleared", (double)store.memoryUsage())
+		.print();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const size_t maxCount = test::isQuick(argc, argv) ? 1000 : 100000;
+
+	for (size_t count = 100; count <= maxCount; count *= 10)
+		benchBoard(count);
+
+	return test::result();
+}
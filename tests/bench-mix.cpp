@@ -0,0 +1,193 @@
+// Measures the CPU time of one audio tick with 8, 32 and 128 voices playing,
+// and the cost of the mix kernels and the limiter on their own.
+
+#include "TestSupport.hpp"
+#include "engine/Limiter.hpp"
+#include "engine/MixKernels.hpp"
+#include "engine/PlaybackEngine.hpp"
+
+#include <media-io/audio-io.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t sampleRate = 48000;
+constexpr size_t blockFrames = AUDIO_OUTPUT_FRAMES;
+
+double tickNs()
+{
+	return (double)blockFrames * 1e9 / sampleRate;
+}
+
+double noise(size_t frame, size_t channel)
+{
+	uint32_t x = (uint32_t)(frame * 2654435761u) ^ (uint32_t)(channel * 40503u);
+	x ^= x >> 13;
+	x *= 0x5bd1e995u;
+	x ^= x >> 15;
+	return ((double)(x & 0xffff) / 32768.0 - 1.0) * 0.3;
+}
+
+struct Planes {
+	std::vector<float> samples;
+	float *planes[MAX_AUDIO_CHANNELS] = {};
+
+	explicit Planes(size_t channels) : samples(channels * blockFrames)
+	{
+		for (size_t c = 0; c < channels; c++)
+			planes[c] = samples.data() + c * blockFrames;
+	}
+};
+
+void benchEngine(ClipCache &cache, const std::string &path, const char *format, size_t channels, size_t voices,
+		 int ticks)
+{
+	EngineConfig config;
+	config.maxVoices = voices;
+	config.maxScheduled = voices * 8;
+	config.maxFrames = blockFrames;
+
+	PlaybackEngine engine(sampleRate, channels, config);
+	std::shared_ptr<ClipEntry> clip = cache.acquire(path);
+	CHECK(test::waitForClip(clip));
+
+	for (size_t i = 0; i < voices; i++) {
+		EngineCommand cmd;
+		cmd.type = EngineCommand::Type::Play;
+		cmd.clip = clip;
+		cmd.options.mode = TriggerMode::Overlap;
+		cmd.options.loop = true;
+		cmd.options.gain = 1.0f / (float)voices;
+		cmd.options.tag = (uint32_t)i + 1;
+		engine.submit(std::move(cmd));
+	}
+
+	Planes out(channels);
+	uint64_t timestamp = 1000000000ULL;
+
+	// The first tick starts the voices.
+	engine.render(out.planes, blockFrames, timestamp);
+
+	std::vector<double> times;
+	times.reserve((size_t)ticks);
+
+	for (int i = 0; i < ticks; i++) {
+		timestamp += (uint64_t)tickNs();
+
+		auto start = Clock::now();
+		engine.render(out.planes, blockFrames, timestamp);
+		times.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+					.count());
+	}
+
+	CHECK(engine.getSnapshot().activeVoices == voices);
+
+	std::sort(times.begin(), times.end());
+	double mean = 0.0;
+
+	for (double time : times)
+		mean += time / (double)times.size();
+
+	test::JsonLine("tick")
+		.add("format", format)
+		.add("channels", (double)channels)
+		.add("voices", (double)voices)
+		.add("mean_us", mean / 1e3)
+		.add("p99_us", times[std::min(times.size() - 1, times.size() * 99 / 100)] / 1e3)
+		.add("cpu_percent", mean / tickNs() * 100.0)
+		.print();
+}
+
+void benchKernel(size_t channels, int ticks)
+{
+	AudioBuffer buffer;
+	buffer.sampleRate = sampleRate;
+	buffer.frames = blockFrames;
+	buffer.planes.assign(channels, std::vector<float>(blockFrames));
+
+	for (size_t c = 0; c < channels; c++) {
+		for (size_t i = 0; i < blockFrames; i++)
+			buffer.planes[c][i] = (float)noise(i, c);
+	}
+
+	Planes out(channels);
+	MixKernel kernel = getMixKernel(channels);
+	MeterSums meter;
+
+	auto start = Clock::now();
+
+	for (int i = 0; i < ticks; i++)
+		kernel(out.planes, 0, buffer, 0, blockFrames, 0.5f, meter);
+
+	double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	test::JsonLine("kernel")
+		.add("channels", (double)channels)
+		.add("ns_per_frame", ns / ticks / blockFrames)
+		.print();
+}
+
+void benchLimiter(size_t channels, int ticks)
+{
+	Limiter limiter(sampleRate, channels);
+	Planes out(channels);
+
+	// Loud enough that the limiter works on every tick.
+	std::vector<float> input(blockFrames * 16);
+
+	for (size_t f = 0; f < input.size(); f++)
+		input[f] = (float)(noise(f, 0) * 5.0);
+
+	auto start = Clock::now();
+
+	for (int i = 0; i < ticks; i++) {
+		const float *block = input.data() + (size_t)(i % 16) * blockFrames;
+
+		for (size_t c = 0; c < channels; c++)
+			std::copy(block, block + blockFrames, out.planes[c]);
+
+		limiter.process(out.planes, blockFrames);
+	}
+
+	double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+
+	test::JsonLine("limiter")
+		.add("channels", (double)channels)
+		.add("ns_per_frame", ns / ticks / blockFrames)
+		.print();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const int ticks = test::isQuick(argc, argv) ? 20 : 2000;
+
+	for (size_t channels : {1, 2, 6, 8})
+		benchKernel(channels, ticks);
+
+	for (size_t channels : {2, 6})
+		benchLimiter(channels, ticks);
+
+	for (size_t channels : {2, 6}) {
+		ClipCache cache(sampleRate, channels);
+
+		std::string s16 = test::tempDir() + "/s16-" + std::to_string(channels) + ".wav";
+		std::string f32 = test::tempDir() + "/f32-" + std::to_string(channels) + ".wav";
+		CHECK(test::writeWav(s16, sampleRate, channels, sampleRate, test::WavFormat::S16,
+				     [](size_t f, size_t c) { return (float)noise(f, c); }));
+		CHECK(test::writeWav(f32, sampleRate, channels, sampleRate, test::WavFormat::F32,
+				     [](size_t f, size_t c) { return (float)noise(f, c); }));
+
+		for (size_t voices : {8, 32, 128}) {
+			benchEngine(cache, s16, "s16", channels, voices, ticks);
+			benchEngine(cache, f32, "f32", channels, voices, ticks);
+		}
+	}
+
+	return test::result();
+}
@@ -0,0 +1,139 @@
+// Times a hotkey press until its sound leaves the source, through the same
+// path a real press takes: the hotkey callback plays the sound from the
+// published board and the source's render thread outputs it.
+
+#include "TestSupport.hpp"
+#include "fake-obs.hpp"
+#include "engine/BoardSnapshot.hpp"
+#include "engine/SoundboardSource.hpp"
+
+#include <util/platform.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> pressTime = 0;
+std::atomic<uint64_t> soundTime = 0;
+std::atomic<bool> silent = true;
+
+void onAudio(obs_source_t *, const struct obs_source_audio *audio)
+{
+	const float *samples = reinterpret_cast<const float *>(audio->data[0]);
+	bool sounding = std::any_of(samples, samples + audio->frames, [](float s) { return s != 0.0f; });
+
+	if (sounding && pressTime && !soundTime)
+		soundTime = os_gettime_ns();
+
+	silent = !sounding;
+}
+
+void onHotkey(void *data, obs_hotkey_id, obs_hotkey_t *, bool pressed)
+{
+	if (!pressed)
+		return;
+
+	uint64_t timestamp = os_gettime_ns();
+	pressTime = timestamp;
+	triggerBoardClip((uint32_t)(uintptr_t)data, timestamp);
+}
+
+bool waitFor(const std::atomic<bool> &flag, int timeoutMs)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	while (!flag) {
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	return true;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+
+	std::sort(values.begin(), values.end());
+	return values[std::min(values.size() - 1, (size_t)(p * (double)values.size()))];
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const int presses = test::isQuick(argc, argv) ? 10 : 200;
+	const uint32_t sampleRate = 48000;
+
+	fake_obs::setAudio(sampleRate, SPEAKERS_STEREO);
+	fake_obs::setAudioCallback(onAudio);
+	SoundboardSource::registerSource();
+
+	OBSDataAutoRelease settings = obs_data_create();
+	OBSSourceAutoRelease source = obs_source_create_private(SOUNDBOARD_SOURCE_ID, "bench", settings);
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+	CHECK(sbs != nullptr);
+
+	// Short enough to end within a block, so every press starts from silence.
+	std::string path = test::tempDir() + "/click.wav";
+	CHECK(test::writeWav(path, sampleRate, 2, 256, test::WavFormat::S16, [](size_t, size_t) { return 0.5f; }));
+
+	std::shared_ptr<ClipEntry> clip = ClipCache::get()->acquire(path);
+	CHECK(test::waitForClip(clip));
+
+	const uint32_t handle = 1;
+	auto board = std::make_unique<BoardSnapshot>();
+	board->clips.resize(handleIndex(handle) + 1);
+	board->clips[handleIndex(handle)].handle = handle;
+	board->clips[handleIndex(handle)].clip = clip;
+	board->buses.emplace_back(source);
+	publishBoard(std::move(board));
+
+	obs_hotkey_id hotkey = obs_hotkey_register_frontend("bench", "bench", onHotkey, (void *)(uintptr_t)handle);
+	std::vector<double> latencies;
+
+	for (int i = 0; i < presses && sbs; i++) {
+		waitFor(silent, 1000);
+		soundTime = 0;
+		fake_obs::pressHotkey(hotkey, true);
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+		while (!soundTime && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+		CHECK(soundTime != 0);
+
+		if (soundTime)
+			latencies.push_back((double)(soundTime - pressTime) / 1e6);
+
+		pressTime = 0;
+		fake_obs::pressHotkey(hotkey, false);
+
+		// Presses land at different points of the render block.
+		std::this_thread::sleep_for(std::chrono::microseconds(3000 + (i * 7919) % 20000));
+	}
+
+	test::JsonLine("trigger")
+		.add("presses", (double)latencies.size())
+		.add("output_p50_ms", percentile(latencies, 0.5))
+		.add("output_p99_ms", percentile(latencies, 0.99))
+		.add("output_max_ms", percentile(latencies, 1.0))
+		.add("engine_p50_ms", sbs ? sbs->getEngine().getTriggerLatency().getPercentile(0.5) / 1e6 : 0.0)
+		.add("engine_p99_ms", sbs ? sbs->getEngine().getTriggerLatency().getPercentile(0.99) / 1e6 : 0.0)
+		.print();
+
+	obs_hotkey_unregister(hotkey);
+	fake_obs::setAudioCallback(nullptr);
+	publishBoard(nullptr);
+	clip.reset();
+	source = nullptr;
+	ClipCache::shutdown();
+
+	return test::result();
+}
@@ -0,0 +1,951 @@
+#include "fake-obs.hpp"
+
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+struct obs_source {
+	std::atomic<long> refs = 1;
+	const obs_source_info *info = nullptr;
+	std::string name;
+	obs_data_t *settings = nullptr;
+	void *data = nullptr;
+};
+
+struct obs_data_item {
+	enum class Type { Null, Int, Double, Bool, String, Object, Array };
+
+	Type type = Type::Null;
+	long long i = 0;
+	double d = 0.0;
+	bool b = false;
+	std::string s;
+	obs_data_t *obj = nullptr;
+	obs_data_array_t *array = nullptr;
+};
+
+struct obs_data {
+	std::atomic<long> refs = 1;
+	// Kept in insertion order, like the JSON libobs writes.
+	std::vector<std::pair<std::string, obs_data_item>> values;
+	std::map<std::string, obs_data_item> defaults;
+	std::string json;
+};
+
+struct obs_data_array {
+	std::atomic<long> refs = 1;
+	std::vector<obs_data_t *> items;
+};
+
+struct audio_output {
+	audio_output_info info;
+};
+
+namespace {
+struct Hotkey {
+	std::string name;
+	std::string description;
+	obs_hotkey_func func = nullptr;
+	void *data = nullptr;
+};
+
+std::mutex mutex;
+std::unordered_map<std::string, obs_source_info> sourceTypes;
+std::unordered_map<obs_hotkey_id, Hotkey> hotkeys;
+obs_hotkey_id nextHotkey = 0;
+
+audio_output audio = {{"fake", 48000, AUDIO_FORMAT_FLOAT_PLANAR, SPEAKERS_STEREO}};
+fake_obs::AudioCallback audioCallback;
+
+std::atomic<int> logLevel = LOG_WARNING;
+std::atomic<uint64_t> warnings = 0;
+std::mutex logMutex;
+std::vector<std::string> logged;
+
+std::atomic<fake_obs::BlockingHook> blockingHook = nullptr;
+
+void blocking(const char *what)
+{
+	if (fake_obs::BlockingHook hook = blockingHook.load())
+		hook(what);
+}
+
+void clearItem(obs_data_item &item)
+{
+	if (item.obj)
+		obs_data_release(item.obj);
+	if (item.array)
+		obs_data_array_release(item.array);
+
+	item = obs_data_item();
+}
+
+obs_data_item *findItem(obs_data_t *data, const char *name)
+{
+	for (auto &value : data->values) {
+		if (value.first == name)
+			return &value.second;
+	}
+
+	return nullptr;
+}
+
+const obs_data_item *getItem(obs_data_t *data, const char *name)
+{
+	if (!data || !name)
+		return nullptr;
+
+	if (const obs_data_item *item = findItem(data, name))
+		return item;
+
+	auto it = data->defaults.find(name);
+	return it != data->defaults.end() ? &it->second : nullptr;
+}
+
+obs_data_item &setItem(obs_data_t *data, const char *name)
+{
+	obs_data_item *item = findItem(data, name);
+
+	if (item) {
+		clearItem(*item);
+		return *item;
+	}
+
+	data->values.emplace_back(name, obs_data_item());
+	return data->values.back().second;
+}
+
+// Just enough of a JSON reader for settings files: objects, arrays,
+// strings with simple escapes, numbers, booleans and null.
+class JsonReader {
+	const char *p;
+
+	void skipSpace()
+	{
+		while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+			p++;
+	}
+
+	bool parseString(std::string &out)
+	{
+		if (*p != '"')
+			return false;
+
+		for (p++; *p && *p != '"'; p++) {
+			if (*p != '\\') {
+				out += *p;
+				continue;
+			}
+
+			switch (*++p) {
+			case 'n':
+				out += '\n';
+				break;
+			case 't':
+				out += '\t';
+				break;
+			case 'r':
+				out += '\r';
+				break;
+			case 'u':
+				// Only code points below 0x80 are needed.
+				out += (char)strtol(std::string(p + 1, 4).c_str(), nullptr, 16);
+				p += 4;
+				break;
+			default:
+				out += *p;
+			}
+		}
+
+		if (*p != '"')
+			return false;
+
+		p++;
+		return true;
+	}
+
+	bool parseValue(obs_data_item &item)
+	{
+		skipSpace();
+
+		if (*p == '{') {
+			item.type = obs_data_item::Type::Object;
+			item.obj = obs_data_create();
+			return parseObject(item.obj);
+		}
+
+		if (*p == '[') {
+			item.type = obs_data_item::Type::Array;
+			item.array = obs_data_array_create();
+			p++;
+			skipSpace();
+
+			if (*p == ']') {
+				p++;
+				return true;
+			}
+
+			for (;;) {
+				skipSpace();
+				obs_data_t *obj = obs_data_create();
+				obs_data_array_push_back(item.array, obj);
+				obs_data_release(obj);
+
+				if (*p != '{' || !parseObject(obj))
+					return false;
+
+				skipSpace();
+
+				if (*p == ']') {
+					p++;
+					return true;
+				}
+
+				if (*p++ != ',')
+					return false;
+			}
+		}
+
+		if (*p == '"') {
+			item.type = obs_data_item::Type::String;
+			return parseString(item.s);
+		}
+
+		if (strncmp(p, "true", 4) == 0 || strncmp(p, "false", 5) == 0) {
+			item.type = obs_data_item::Type::Bool;
+			item.b = *p == 't';
+			p += item.b ? 4 : 5;
+			return true;
+		}
+
+		if (strncmp(p, "null", 4) == 0) {
+			p += 4;
+			return true;
+		}
+
+		const char *start = p;
+		char *end = nullptr;
+		double value = strtod(start, &end);
+
+		if (end == start)
+			return false;
+
+		p = end;
+
+		if (std::string(start, p).find_first_of(".eE") == std::string::npos) {
+			item.type = obs_data_item::Type::Int;
+			item.i = strtoll(start, nullptr, 10);
+		} else {
+			item.type = obs_data_item::Type::Double;
+			item.d = value;
+		}
+
+		return true;
+	}
+
+public:
+	explicit JsonReader(const char *json) : p(json) {}
+
+	bool parseObject(obs_data_t *data)
+	{
+		skipSpace();
+
+		if (*p++ != '{')
+			return false;
+
+		skipSpace();
+
+		if (*p == '}') {
+			p++;
+			return true;
+		}
+
+		for (;;) {
+			skipSpace();
+			std::string name;
+
+			if (!parseString(name))
+				return false;
+
+			skipSpace();
+
+			if (*p++ != ':')
+				return false;
+
+			obs_data_item &item = setItem(data, name.c_str());
+
+			if (!parseValue(item))
+				return false;
+
+			skipSpace();
+
+			if (*p == '}') {
+				p++;
+				return true;
+			}
+
+			if (*p++ != ',')
+				return false;
+		}
+	}
+};
+
+void writeString(std::ostringstream &out, const std::string &str)
+{
+	out << '"';
+
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			out << "\\\"";
+			break;
+		case '\\':
+			out << "\\\\";
+			break;
+		case '\n':
+			out << "\\n";
+			break;
+		default:
+			out << c;
+		}
+	}
+
+	out << '"';
+}
+
+void writeObject(std::ostringstream &out, obs_data_t *data)
+{
+	out << '{';
+
+	for (size_t i = 0; i < data->values.size(); i++) {
+		const obs_data_item &item = data->values[i].second;
+
+		if (i)
+			out << ',';
+
+		writeString(out, data->values[i].first);
+		out << ':';
+
+		switch (item.type) {
+		case obs_data_item::Type::Null:
+			out << "null";
+			break;
+		case obs_data_item::Type::Int:
+			out << item.i;
+			break;
+		case obs_data_item::Type::Double:
+			// Always written with a fraction, so it reads back as a double.
+			if (std::floor(item.d) == item.d && std::fabs(item.d) < 1e15)
+				out << (long long)item.d << ".0";
+			else
+				out << item.d;
+			break;
+		case obs_data_item::Type::Bool:
+			out << (item.b ? "true" : "false");
+			break;
+		case obs_data_item::Type::String:
+			writeString(out, item.s);
+			break;
+		case obs_data_item::Type::Object:
+			writeObject(out, item.obj);
+			break;
+		case obs_data_item::Type::Array:
+			out << '[';
+			for (size_t j = 0; j < item.array->items.size(); j++) {
+				if (j)
+					out << ',';
+				writeObject(out, item.array->items[j]);
+			}
+			out << ']';
+			break;
+		}
+	}
+
+	out << '}';
+}
+} // namespace
+
+/* Test controls */
+
+void fake_obs::setAudio(uint32_t sampleRate, enum speaker_layout speakers)
+{
+	audio.info.samples_per_sec = sampleRate;
+	audio.info.speakers = speakers;
+}
+
+void fake_obs::setAudioCallback(AudioCallback callback)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	audioCallback = std::move(callback);
+}
+
+bool fake_obs::pressHotkey(obs_hotkey_id id, bool pressed)
+{
+	Hotkey hotkey;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = hotkeys.find(id);
+
+		if (it == hotkeys.end())
+			return false;
+
+		hotkey = it->second;
+	}
+
+	hotkey.func(hotkey.data, id, nullptr, pressed);
+	return true;
+}
+
+size_t fake_obs::getHotkeyCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return hotkeys.size();
+}
+
+void fake_obs::setLogLevel(int level)
+{
+	logLevel = level;
+}
+
+uint64_t fake_obs::getWarningCount()
+{
+	return warnings;
+}
+
+size_t fake_obs::getLogCount(const char *text)
+{
+	std::lock_guard<std::mutex> lock(logMutex);
+	auto contains = [text](const std::string &message) {
+		return message.find(text) != std::string::npos;
+	};
+
+	return (size_t)std::count_if(logged.begin(), logged.end(), contains);
+}
+
+void fake_obs::setBlockingHook(BlockingHook hook)
+{
+	blockingHook = hook;
+}
+
+/* Logging and modules */
+
+void blog(int log_level, const char *format, ...)
+{
+	blocking("log");
+
+	char message[4096];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	if (log_level <= LOG_WARNING)
+		warnings++;
+
+	{
+		std::lock_guard<std::mutex> lock(logMutex);
+		logged.emplace_back(message);
+	}
+
+	if (log_level <= logLevel)
+		fprintf(stderr, "%s\n", message);
+}
+
+const char *obs_module_text(const char *lookup)
+{
+	return lookup;
+}
+
+/* Sources */
+
+void obs_register_source_s(const struct obs_source_info *info, size_t size)
+{
+	obs_source_info copy = {};
+	memcpy(&copy, info, std::min(size, sizeof(copy)));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	sourceTypes[info->id] = copy;
+}
+
+obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings)
+{
+	const obs_source_info *info = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = sourceTypes.find(id);
+
+		if (it == sourceTypes.end())
+			return nullptr;
+
+		info = &it->second;
+	}
+
+	obs_source_t *source = new obs_source;
+	source->info = info;
+	source->name = name ? name : "";
+	source->settings = obs_data_create();
+
+	if (settings) {
+		for (const auto &value : settings->values) {
+			obs_data_item &item = setItem(source->settings, value.first.c_str());
+			item = value.second;
+
+			if (item.obj)
+				obs_data_addref(item.obj);
+			if (item.array)
+				obs_data_array_addref(item.array);
+		}
+	}
+
+	if (info->get_defaults)
+		info->get_defaults(source->settings);
+	if (info->create)
+		source->data = info->create(source->settings, source);
+
+	return source;
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source)
+{
+	if (source)
+		source->refs++;
+
+	return source;
+}
+
+void obs_source_release(obs_source_t *source)
+{
+	if (!source || --source->refs > 0)
+		return;
+
+	if (source->info->destroy && source->data)
+		source->info->destroy(source->data);
+
+	obs_data_release(source->settings);
+	delete source;
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? source->name.c_str() : nullptr;
+}
+
+const char *obs_source_get_unversioned_id(const obs_source_t *source)
+{
+	return source ? source->info->id : nullptr;
+}
+
+void *obs_obj_get_data(void *obj)
+{
+	return obj ? static_cast<obs_source_t *>(obj)->data : nullptr;
+}
+
+void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *data)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (audioCallback)
+		audioCallback(source, data);
+}
+
+void obs_source_media_started(obs_source_t *) {}
+
+void obs_source_media_ended(obs_source_t *) {}
+
+audio_t *obs_get_audio(void)
+{
+	return &audio;
+}
+
+const struct audio_output_info *audio_output_get_info(const audio_t *output)
+{
+	return output ? &output->info : nullptr;
+}
+
+/* Hotkeys */
+
+obs_hotkey_id obs_hotkey_register_frontend(const char *name, const char *description, obs_hotkey_func func,
+					   void *data)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	obs_hotkey_id id = nextHotkey++;
+	hotkeys[id] = Hotkey{name ? name : "", description ? description : "", func, data};
+	return id;
+}
+
+void obs_hotkey_unregister(obs_hotkey_id id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	hotkeys.erase(id);
+}
+
+void obs_hotkey_set_name(obs_hotkey_id id, const char *name)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = hotkeys.find(id);
+
+	if (it != hotkeys.end())
+		it->second.name = name;
+}
+
+void obs_hotkey_set_description(obs_hotkey_id id, const char *desc)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = hotkeys.find(id);
+
+	if (it != hotkeys.end())
+		it->second.description = desc;
+}
+
+// Key bindings are not modeled, hotkeys save as an empty list.
+obs_data_array_t *obs_hotkey_save(obs_hotkey_id)
+{
+	return obs_data_array_create();
+}
+
+void obs_hotkey_load(obs_hotkey_id, obs_data_array_t *) {}
+
+/* Settings data */
+
+obs_data_t *obs_data_create(void)
+{
+	return new obs_data;
+}
+
+obs_data_t *obs_data_create_from_json(const char *json_string)
+{
+	obs_data_t *data = obs_data_create();
+
+	if (!json_string || !JsonReader(json_string).parseObject(data)) {
+		blog(LOG_ERROR, "obs_data_create_from_json: Failed to parse JSON");
+		obs_data_release(data);
+		return nullptr;
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json_file(const char *json_file)
+{
+	std::ifstream file(json_file, std::ios::binary);
+
+	if (!file)
+		return nullptr;
+
+	std::stringstream json;
+	json << file.rdbuf();
+	return obs_data_create_from_json(json.str().c_str());
+}
+
+void obs_data_addref(obs_data_t *data)
+{
+	if (data)
+		data->refs++;
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	if (!data || --data->refs > 0)
+		return;
+
+	for (auto &value : data->values)
+		clearItem(value.second);
+	for (auto &value : data->defaults)
+		clearItem(value.second);
+
+	delete data;
+}
+
+const char *obs_data_get_json(obs_data_t *data)
+{
+	std::ostringstream out;
+	writeObject(out, data);
+	data->json = out.str();
+	return data->json.c_str();
+}
+
+bool obs_data_save_json(obs_data_t *data, const char *file)
+{
+	std::ofstream out(file, std::ios::binary);
+	out << obs_data_get_json(data);
+	return (bool)out;
+}
+
+bool obs_data_has_user_value(obs_data_t *data, const char *name)
+{
+	return data && name && findItem(data, name);
+}
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::String;
+	item.s = val ? val : "";
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::Int;
+	item.i = val;
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::Double;
+	item.d = val;
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::Bool;
+	item.b = val;
+}
+
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::Object;
+	item.obj = obj;
+	obs_data_addref(obj);
+}
+
+void obs_data_set_array(obs_data_t *data, const char *name, obs_data_array_t *array)
+{
+	obs_data_item &item = setItem(data, name);
+	item.type = obs_data_item::Type::Array;
+	item.array = array;
+	obs_data_array_addref(array);
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val)
+{
+	obs_data_item &item = data->defaults[name];
+	item.type = obs_data_item::Type::String;
+	item.s = val ? val : "";
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val)
+{
+	obs_data_item &item = data->defaults[name];
+	item.type = obs_data_item::Type::Int;
+	item.i = val;
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val)
+{
+	obs_data_item &item = data->defaults[name];
+	item.type = obs_data_item::Type::Double;
+	item.d = val;
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+	obs_data_item &item = data->defaults[name];
+	item.type = obs_data_item::Type::Bool;
+	item.b = val;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+	return item && item->type == obs_data_item::Type::String ? item->s.c_str() : "";
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+
+	if (!item)
+		return 0;
+	if (item->type == obs_data_item::Type::Double)
+		return (long long)item->d;
+
+	return item->type == obs_data_item::Type::Int ? item->i : 0;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+
+	if (!item)
+		return 0.0;
+	if (item->type == obs_data_item::Type::Int)
+		return (double)item->i;
+
+	return item->type == obs_data_item::Type::Double ? item->d : 0.0;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+	return item && item->type == obs_data_item::Type::Bool && item->b;
+}
+
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+
+	if (!item || item->type != obs_data_item::Type::Object)
+		return nullptr;
+
+	obs_data_addref(item->obj);
+	return item->obj;
+}
+
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name)
+{
+	const obs_data_item *item = getItem(data, name);
+
+	if (!item || item->type != obs_data_item::Type::Array)
+		return nullptr;
+
+	obs_data_array_addref(item->array);
+	return item->array;
+}
+
+obs_data_array_t *obs_data_array_create(void)
+{
+	return new obs_data_array;
+}
+
+void obs_data_array_addref(obs_data_array_t *array)
+{
+	if (array)
+		array->refs++;
+}
+
+void obs_data_array_release(obs_data_array_t *array)
+{
+	if (!array || --array->refs > 0)
+		return;
+
+	for (obs_data_t *item : array->items)
+		obs_data_release(item);
+
+	delete array;
+}
+
+size_t obs_data_array_count(obs_data_array_t *array)
+{
+	return array ? array->items.size() : 0;
+}
+
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx)
+{
+	if (!array || idx >= array->items.size())
+		return nullptr;
+
+	obs_data_addref(array->items[idx]);
+	return array->items[idx];
+}
+
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj)
+{
+	obs_data_addref(obj);
+	array->items.push_back(obj);
+	return array->items.size() - 1;
+}
+
+/* Platform */
+
+FILE *os_fopen(const char *path, const char *mode)
+{
+	blocking("file open");
+	return fopen(path, mode);
+}
+
+int os_fseeki64(FILE *file, int64_t offset, int origin)
+{
+	blocking("file seek");
+	return fseeko(file, (off_t)offset, origin);
+}
+
+int64_t os_ftelli64(FILE *file)
+{
+	return (int64_t)ftello(file);
+}
+
+int os_unlink(const char *path)
+{
+	blocking("file removal");
+	return remove(path);
+}
+
+uint64_t os_gettime_ns(void)
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+bool os_sleepto_ns(uint64_t time_target)
+{
+	blocking("sleep");
+
+	uint64_t now = os_gettime_ns();
+
+	if (time_target < now)
+		return false;
+
+	std::this_thread::sleep_for(std::chrono::nanoseconds(time_target - now));
+	return true;
+}
+
+void os_sleep_ms(uint32_t duration)
+{
+	blocking("sleep");
+	std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+}
+
+char *os_generate_uuid(void)
+{
+	thread_local std::mt19937_64 generator(std::random_device{}());
+	uint64_t high = generator();
+	uint64_t low = generator();
+	char uuid[37];
+
+	snprintf(uuid, sizeof(uuid), "%08x-%04x-4%03x-%04x-%012llx", (unsigned)(high >> 32),
+		 (unsigned)(high >> 16) & 0xffff, (unsigned)high & 0xfff, ((unsigned)(low >> 48) & 0x3fff) | 0x8000,
+		 (unsigned long long)low & 0xffffffffffffULL);
+
+	return bstrdup(uuid);
+}
+
+void os_set_thread_name(const char *name)
+{
+#ifdef __linux__
+	char shortName[16];
+	snprintf(shortName, sizeof(shortName), "%s", name);
+	pthread_setname_np(pthread_self(), shortName);
+#else
+	(void)name;
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <obs.h>
+
+#include <cstdint>
+#include <functional>
+
+// Controls for the fake libobs, used by the tests and benchmarks to stand
+// in for the parts of OBS the plugin talks to.
+namespace fake_obs {
+
+// Sets the format of the fake audio output, as seen by new sources.
+void setAudio(uint32_t sampleRate, enum speaker_layout speakers);
+
+// Called with every block a source outputs, on the thread that outputs it.
+using AudioCallback = std::function<void(obs_source_t *source, const struct obs_source_audio *audio)>;
+void setAudioCallback(AudioCallback callback);
+
+// Calls the hotkey's callback the way the hotkey thread would. Returns false
+// if no hotkey with the id is registered.
+bool pressHotkey(obs_hotkey_id id, bool pressed);
+size_t getHotkeyCount();
+
+// Messages up to this level are printed, LOG_WARNING by default.
+void setLogLevel(int level);
+// Number of warnings and errors logged so far.
+uint64_t getWarningCount();
+// Number of messages logged so far at any level that contain the text.
+size_t getLogCount(const char *text);
+
+// Called with a short description of every fake call that can block, such
+// as logging, file I/O and sleeping. The tests pass it on to the real-time
+// checks.
+using BlockingHook = void (*)(const char *what);
+void setBlockingHook(BlockingHook hook);
+
+} // namespace fake_obs
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_AUDIO_MIXES 6
+#define MAX_AUDIO_CHANNELS 8
+#define AUDIO_OUTPUT_FRAMES 1024
+
+enum audio_format {
+	AUDIO_FORMAT_UNKNOWN,
+	AUDIO_FORMAT_U8BIT,
+	AUDIO_FORMAT_16BIT,
+	AUDIO_FORMAT_32BIT,
+	AUDIO_FORMAT_FLOAT,
+	AUDIO_FORMAT_U8BIT_PLANAR,
+	AUDIO_FORMAT_16BIT_PLANAR,
+	AUDIO_FORMAT_32BIT_PLANAR,
+	AUDIO_FORMAT_FLOAT_PLANAR,
+};
+
+enum speaker_layout {
+	SPEAKERS_UNKNOWN,
+	SPEAKERS_MONO,
+	SPEAKERS_STEREO,
+	SPEAKERS_2POINT1,
+	SPEAKERS_4POINT0,
+	SPEAKERS_4POINT1,
+	SPEAKERS_5POINT1,
+	SPEAKERS_7POINT1 = 8,
+};
+
+typedef struct audio_output audio_t;
+
+struct audio_output_info {
+	const char *name;
+	uint32_t samples_per_sec;
+	enum audio_format format;
+	enum speaker_layout speakers;
+};
+
+const struct audio_output_info *audio_output_get_info(const audio_t *audio);
+
+static inline uint32_t get_audio_channels(enum speaker_layout speakers)
+{
+	switch (speakers) {
+	case SPEAKERS_MONO:
+		return 1;
+	case SPEAKERS_STEREO:
+		return 2;
+	case SPEAKERS_2POINT1:
+		return 3;
+	case SPEAKERS_4POINT0:
+		return 4;
+	case SPEAKERS_4POINT1:
+		return 5;
+	case SPEAKERS_5POINT1:
+		return 6;
+	case SPEAKERS_7POINT1:
+		return 8;
+	case SPEAKERS_UNKNOWN:
+		return 0;
+	}
+
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the lookup string itself, there are no locale files.
+const char *obs_module_text(const char *lookup);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+// The parts of libobs the soundboard engine and models use, declared with
+// the same signatures as the real headers.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "media-io/audio-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	LOG_ERROR = 100,
+	LOG_WARNING = 200,
+	LOG_INFO = 300,
+	LOG_DEBUG = 400,
+};
+
+void blog(int log_level, const char *format, ...);
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_data_array obs_data_array_t;
+
+#define MAX_AV_PLANES 8
+
+/* Sources */
+
+enum obs_source_type {
+	OBS_SOURCE_TYPE_INPUT,
+	OBS_SOURCE_TYPE_FILTER,
+	OBS_SOURCE_TYPE_TRANSITION,
+	OBS_SOURCE_TYPE_SCENE,
+};
+
+enum obs_icon_type {
+	OBS_ICON_TYPE_UNKNOWN,
+	OBS_ICON_TYPE_IMAGE,
+	OBS_ICON_TYPE_COLOR,
+	OBS_ICON_TYPE_SLIDESHOW,
+	OBS_ICON_TYPE_AUDIO_INPUT,
+	OBS_ICON_TYPE_AUDIO_OUTPUT,
+};
+
+enum obs_media_state {
+	OBS_MEDIA_STATE_NONE,
+	OBS_MEDIA_STATE_PLAYING,
+	OBS_MEDIA_STATE_OPENING,
+	OBS_MEDIA_STATE_BUFFERING,
+	OBS_MEDIA_STATE_PAUSED,
+	OBS_MEDIA_STATE_STOPPED,
+	OBS_MEDIA_STATE_ENDED,
+	OBS_MEDIA_STATE_ERROR,
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+#define OBS_SOURCE_CAP_DISABLED (1 << 10)
+#define OBS_SOURCE_CONTROLLABLE_MEDIA (1 << 13)
+
+struct obs_source_audio {
+	const uint8_t *data[MAX_AV_PLANES];
+	uint32_t frames;
+	enum speaker_layout speakers;
+	enum audio_format format;
+	uint32_t samples_per_sec;
+	uint64_t timestamp;
+};
+
+struct obs_source_info {
+	const char *id;
+	enum obs_source_type type;
+	uint32_t output_flags;
+	const char *(*get_name)(void *type_data);
+	void *(*create)(obs_data_t *settings, obs_source_t *source);
+	void (*destroy)(void *data);
+	void (*get_defaults)(obs_data_t *settings);
+	void (*media_play_pause)(void *data, bool pause);
+	void (*media_restart)(void *data);
+	void (*media_stop)(void *data);
+	void (*media_next)(void *data);
+	void (*media_previous)(void *data);
+	int64_t (*media_get_duration)(void *data);
+	int64_t (*media_get_time)(void *data);
+	void (*media_set_time)(void *data, int64_t miliseconds);
+	enum obs_media_state (*media_get_state)(void *data);
+	enum obs_icon_type icon_type;
+};
+
+void obs_register_source_s(const struct obs_source_info *info, size_t size);
+#define obs_register_source(info) obs_register_source_s(info, sizeof(struct obs_source_info))
+
+obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings);
+obs_source_t *obs_source_get_ref(obs_source_t *source);
+void obs_source_release(obs_source_t *source);
+const char *obs_source_get_name(const obs_source_t *source);
+const char *obs_source_get_unversioned_id(const obs_source_t *source);
+void *obs_obj_get_data(void *obj);
+void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio);
+void obs_source_media_started(obs_source_t *source);
+void obs_source_media_ended(obs_source_t *source);
+
+audio_t *obs_get_audio(void);
+
+/* Hotkeys */
+
+typedef size_t obs_hotkey_id;
+typedef struct obs_hotkey obs_hotkey_t;
+
+#define OBS_INVALID_HOTKEY_ID (~(obs_hotkey_id)0)
+
+typedef void (*obs_hotkey_func)(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+
+obs_hotkey_id obs_hotkey_register_frontend(const char *name, const char *description, obs_hotkey_func func,
+					   void *data);
+void obs_hotkey_unregister(obs_hotkey_id id);
+void obs_hotkey_set_name(obs_hotkey_id id, const char *name);
+void obs_hotkey_set_description(obs_hotkey_id id, const char *desc);
+obs_data_array_t *obs_hotkey_save(obs_hotkey_id id);
+void obs_hotkey_load(obs_hotkey_id id, obs_data_array_t *data);
+
+/* Settings data */
+
+obs_data_t *obs_data_create(void);
+obs_data_t *obs_data_create_from_json(const char *json_string);
+obs_data_t *obs_data_create_from_json_file(const char *json_file);
+void obs_data_addref(obs_data_t *data);
+void obs_data_release(obs_data_t *data);
+const char *obs_data_get_json(obs_data_t *data);
+bool obs_data_save_json(obs_data_t *data, const char *file);
+bool obs_data_has_user_value(obs_data_t *data, const char *name);
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj);
+void obs_data_set_array(obs_data_t *data, const char *name, obs_data_array_t *array);
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+double obs_data_get_double(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name);
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name);
+
+obs_data_array_t *obs_data_array_create(void);
+void obs_data_array_addref(obs_data_array_t *array);
+void obs_data_array_release(obs_data_array_t *array);
+size_t obs_data_array_count(obs_data_array_t *array);
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx);
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "obs.h"
+
+#include <utility>
+
+// Reference holders with the names and behavior of the libobs C++ helpers.
+// The plain holders take a new reference, the AutoRelease holders adopt the
+// reference they are given.
+
+namespace fake_obs {
+inline void addref(obs_source_t *source)
+{
+	obs_source_get_ref(source);
+}
+
+inline void addref(obs_data_t *data)
+{
+	obs_data_addref(data);
+}
+
+inline void addref(obs_data_array_t *array)
+{
+	obs_data_array_addref(array);
+}
+
+inline void release(obs_source_t *source)
+{
+	obs_source_release(source);
+}
+
+inline void release(obs_data_t *data)
+{
+	obs_data_release(data);
+}
+
+inline void release(obs_data_array_t *array)
+{
+	obs_data_array_release(array);
+}
+} // namespace fake_obs
+
+template<typename T> class OBSRefAutoRelease;
+
+template<typename T> class OBSRef {
+	T val = nullptr;
+
+	friend class OBSRefAutoRelease<T>;
+
+public:
+	OBSRef() = default;
+	OBSRef(T val_) : val(val_)
+	{
+		if (val)
+			fake_obs::addref(val);
+	}
+	OBSRef(const OBSRef &ref) : OBSRef(ref.val) {}
+	OBSRef(OBSRef &&ref) noexcept : val(std::exchange(ref.val, nullptr)) {}
+	OBSRef(OBSRefAutoRelease<T> &&ref) noexcept;
+	~OBSRef()
+	{
+		if (val)
+			fake_obs::release(val);
+	}
+
+	OBSRef &operator=(T valIn)
+	{
+		if (valIn)
+			fake_obs::addref(valIn);
+		if (val)
+			fake_obs::release(val);
+		val = valIn;
+		return *this;
+	}
+	OBSRef &operator=(const OBSRef &ref) { return *this = ref.val; }
+	OBSRef &operator=(OBSRef &&ref) noexcept
+	{
+		std::swap(val, ref.val);
+		return *this;
+	}
+
+	operator T() const { return val; }
+	T Get() const { return val; }
+};
+
+template<typename T> class OBSRefAutoRelease {
+	T val = nullptr;
+
+	friend class OBSRef<T>;
+
+public:
+	OBSRefAutoRelease() = default;
+	OBSRefAutoRelease(T val_) : val(val_) {}
+	OBSRefAutoRelease(const OBSRefAutoRelease &) = delete;
+	OBSRefAutoRelease(OBSRefAutoRelease &&ref) noexcept : val(std::exchange(ref.val, nullptr)) {}
+	~OBSRefAutoRelease()
+	{
+		if (val)
+			fake_obs::release(val);
+	}
+
+	OBSRefAutoRelease &operator=(T valIn)
+	{
+		if (val)
+			fake_obs::release(val);
+		val = valIn;
+		return *this;
+	}
+	OBSRefAutoRelease &operator=(const OBSRefAutoRelease &) = delete;
+	OBSRefAutoRelease &operator=(OBSRefAutoRelease &&ref) noexcept
+	{
+		std::swap(val, ref.val);
+		return *this;
+	}
+
+	operator T() const { return val; }
+	T Get() const { return val; }
+};
+
+template<typename T> OBSRef<T>::OBSRef(OBSRefAutoRelease<T> &&ref) noexcept : val(std::exchange(ref.val, nullptr)) {}
+
+using OBSSource = OBSRef<obs_source_t *>;
+using OBSData = OBSRef<obs_data_t *>;
+using OBSDataArray = OBSRef<obs_data_array_t *>;
+
+using OBSSourceAutoRelease = OBSRefAutoRelease<obs_source_t *>;
+using OBSDataAutoRelease = OBSRefAutoRelease<obs_data_t *>;
+using OBSDataArrayAutoRelease = OBSRefAutoRelease<obs_data_array_t *>;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+static inline void *bmalloc(size_t size)
+{
+	return malloc(size ? size : 1);
+}
+
+static inline void *bzalloc(size_t size)
+{
+	return calloc(1, size ? size : 1);
+}
+
+static inline void bfree(void *ptr)
+{
+	free(ptr);
+}
+
+static inline char *bstrdup(const char *str)
+{
+	if (!str)
+		return NULL;
+
+	size_t size = strlen(str) + 1;
+	return (char *)memcpy(bmalloc(size), str, size);
+}
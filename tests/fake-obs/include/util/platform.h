@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FILE *os_fopen(const char *path, const char *mode);
+int os_fseeki64(FILE *file, int64_t offset, int origin);
+int64_t os_ftelli64(FILE *file);
+int os_unlink(const char *path);
+uint64_t os_gettime_ns(void);
+bool os_sleepto_ns(uint64_t time_target);
+void os_sleep_ms(uint32_t duration);
+char *os_generate_uuid(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+// Profiling is not recorded, the scopes only have to compile.
+struct ScopeProfiler {
+	explicit ScopeProfiler(const char *) {}
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define ProfileScope(name) ScopeProfiler PROFILE_CONCAT(scopeProfiler, __LINE__)(name)
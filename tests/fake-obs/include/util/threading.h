@@ -0,0 +1,11 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void os_set_thread_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
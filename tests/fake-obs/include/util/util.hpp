@@ -0,0 +1,16 @@
+#pragma once
+
+#include "bmem.h"
+
+template<typename T> class BPtr {
+	T *ptr = nullptr;
+
+public:
+	BPtr(T *p = nullptr) : ptr(p) {}
+	BPtr(const BPtr &) = delete;
+	BPtr &operator=(const BPtr &) = delete;
+	~BPtr() { bfree(ptr); }
+
+	T *Get() const { return ptr; }
+	operator T *() const { return ptr; }
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+static inline uint64_t util_mul_div64(uint64_t num, uint64_t mul, uint64_t div)
+{
+	return (uint64_t)((unsigned __int128)num * mul / div);
+}
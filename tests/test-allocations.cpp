@@ -0,0 +1,176 @@
+// Drives a playback engine past the capacity of every pool, with commands
+// of every kind and changing block sizes, and checks that rendering never
+// touches the heap. Needs ENABLE_RT_CHECKS to see the allocations.
+
+#include "TestSupport.hpp"
+#include "fake-obs.hpp"
+#include "engine/PlaybackEngine.hpp"
+#include "engine/RealtimeCheck.hpp"
+
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+constexpr size_t channels = 2;
+constexpr int ticks = 2000;
+
+const char *violationText = "Real-time violation";
+
+std::vector<EngineCommand> makeCommands(const std::vector<std::shared_ptr<ClipEntry>> &clips, int tick)
+{
+	std::vector<EngineCommand> commands;
+
+	// More plays per block than the engine has voices, so voices are stolen.
+	for (int i = 0; i < 6; i++) {
+		EngineCommand cmd;
+		cmd.type = EngineCommand::Type::Play;
+		cmd.clip = clips[(size_t)(tick + i) % clips.size()];
+		cmd.options.mode = i % 3 ? TriggerMode::Overlap : TriggerMode::Replace;
+		cmd.options.loop = i == 0;
+		cmd.options.gain = 0.1f;
+		cmd.options.tag = (uint32_t)(tick * 8 + i + 1);
+		commands.push_back(std::move(cmd));
+	}
+
+	EngineCommand cmd;
+
+	switch (tick % 8) {
+	case 0:
+		cmd.type = EngineCommand::Type::PlayLayers;
+		cmd.layerCount = EngineCommand::maxLayers;
+
+		for (size_t l = 0; l < cmd.layerCount; l++) {
+			cmd.layers[l].clip = clips[l % clips.size()];
+			cmd.layers[l].offset = l * 200;
+		}
+		break;
+	case 1:
+		// More queued sounds than the queue holds.
+		cmd.type = EngineCommand::Type::Enqueue;
+		cmd.clip = clips[(size_t)tick % clips.size()];
+		cmd.autoStart = tick % 16 == 1;
+		break;
+	case 2:
+		// Quantized plays wait for the grid, more of them than the
+		// schedule holds.
+		for (size_t i = 0; i < 20; i++) {
+			EngineCommand quantized;
+			quantized.type = EngineCommand::Type::Play;
+			quantized.clip = clips[i % clips.size()];
+			quantized.options.quantize = true;
+			quantized.options.mode = TriggerMode::Overlap;
+			commands.push_back(std::move(quantized));
+		}
+
+		cmd.type = EngineCommand::Type::Resume;
+		break;
+	case 3:
+		cmd.type = EngineCommand::Type::SetTempo;
+		cmd.tempo = tick % 16 == 3 ? 30.0 : 140.0;
+		cmd.gridBeats = 1.0;
+		break;
+	case 4:
+		cmd.type = EngineCommand::Type::Seek;
+		cmd.frame = tick % 1000;
+		break;
+	case 5:
+		cmd.type = tick % 16 == 5 ? EngineCommand::Type::Pause : EngineCommand::Type::Resume;
+		break;
+	case 6:
+		cmd.type = tick % 16 == 6 ? EngineCommand::Type::Next : EngineCommand::Type::Previous;
+		break;
+	default:
+		cmd.type = tick % 64 == 7 ? EngineCommand::Type::Stop : EngineCommand::Type::Restart;
+		break;
+	}
+
+	commands.push_back(std::move(cmd));
+	return commands;
+}
+} // namespace
+
+int main()
+{
+	EngineConfig config;
+	config.maxVoices = 8;
+	config.maxScheduled = 16;
+	config.maxQueueItems = 8;
+	config.maxFrames = 1024;
+
+	PlaybackEngine engine(sampleRate, channels, config);
+	ClipCache cache(sampleRate, channels);
+
+	// Both sample formats, and lengths shorter and longer than a block.
+	std::vector<std::shared_ptr<ClipEntry>> clips;
+	const size_t lengths[] = {300, 5000, 48000};
+
+	for (size_t i = 0; i < std::size(lengths); i++) {
+		for (test::WavFormat format : {test::WavFormat::S16, test::WavFormat::F32}) {
+			std::string path = test::tempDir() + "/clip" + std::to_string(clips.size()) + ".wav";
+			CHECK(test::writeWav(path, sampleRate, channels, lengths[i], format,
+					     [](size_t, size_t) { return 0.25f; }));
+
+			clips.push_back(cache.acquire(path));
+			CHECK(test::waitForClip(clips.back()));
+		}
+	}
+
+	std::vector<float> samples(channels * config.maxFrames);
+	float *planes[MAX_AUDIO_CHANNELS] = {};
+
+	for (size_t c = 0; c < channels; c++)
+		planes[c] = samples.data() + c * config.maxFrames;
+
+	// Block sizes that do not line up with the clips or the grid.
+	const size_t blockSizes[] = {1024, 480, 1, 441, 64, 1000};
+	const size_t before = fake_obs::getLogCount(violationText);
+	uint64_t timestamp = 1000000000ULL;
+
+	for (int tick = 0; tick < ticks; tick++) {
+		for (EngineCommand &cmd : makeCommands(clips, tick))
+			engine.submit(std::move(cmd));
+
+		size_t frames = blockSizes[(size_t)tick % std::size(blockSizes)];
+
+		{
+			RealtimeScope scope;
+			engine.render(planes, frames, timestamp);
+		}
+
+		logRealtimeViolations();
+
+		timestamp += (uint64_t)frames * 1000000000ULL / sampleRate;
+
+		// Half way through, the board removes its clips while they play.
+		// The cache keeps them until the voices are done with them.
+		if (tick == ticks / 2) {
+			for (size_t i = 1; i < clips.size(); i++)
+				cache.remove(clips[i]->getPath());
+
+			clips.resize(1);
+		}
+	}
+
+	size_t violations = fake_obs::getLogCount(violationText) - before;
+	CHECK(violations == 0);
+
+	// Running out is counted, never handled by growing.
+	PoolUsage voices = engine.getVoiceUsage();
+	PoolUsage scheduled = engine.getScheduleUsage();
+	PoolUsage arena = engine.getArenaUsage();
+
+	CHECK(voices.exhausted > 0);
+	CHECK(voices.highWater == voices.capacity);
+	CHECK(scheduled.exhausted > 0);
+	CHECK(scheduled.highWater == scheduled.capacity);
+	CHECK(arena.highWater <= arena.capacity);
+	CHECK(arena.exhausted == 0);
+	CHECK(engine.getSnapshot().activeVoices <= config.maxVoices);
+	CHECK(engine.getSnapshot().queueSize <= config.maxQueueItems);
+
+	fprintf(stderr, "voices: %zu/%zu, stolen %llu; schedule: %zu/%zu, dropped %llu; arena: %zu/%zu bytes\n",
+		voices.highWater, voices.capacity, (unsigned long long)voices.exhausted, scheduled.highWater,
+		scheduled.capacity, (unsigned long long)scheduled.exhausted, arena.highWater, arena.capacity);
+
+	return test::result();
+}
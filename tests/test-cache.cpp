@@ -0,0 +1,80 @@
+// Checks that copies of a clip share one buffer, and that a file changed in
+// place gets the hash of its new contents once it is reloaded.
+
+#include "TestSupport.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+
+float tone(size_t frame, size_t channel)
+{
+	return (float)((frame + channel * 5) % 100) / 100.0f - 0.5f;
+}
+
+float otherTone(size_t frame, size_t channel)
+{
+	return -tone(frame, channel);
+}
+
+// Waits until the reloaded version of the file replaces the given entry.
+std::shared_ptr<ClipEntry> waitForReload(ClipCache &cache, const std::shared_ptr<ClipEntry> &old)
+{
+	for (int i = 0; i < 5000; i++) {
+		std::shared_ptr<ClipEntry> entry = cache.find(old->getPath());
+
+		if (entry != old)
+			return entry;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return old;
+}
+
+void testShared(test::WavFormat format)
+{
+	ClipCache cache(sampleRate, 2);
+	std::string a = test::tempDir() + "/a.wav";
+	std::string b = test::tempDir() + "/b.wav";
+	std::string c = test::tempDir() + "/c.wav";
+	CHECK(test::writeWav(a, sampleRate, 2, 2000, format, tone));
+	CHECK(test::writeWav(b, sampleRate, 2, 2000, format, tone));
+	CHECK(test::writeWav(c, sampleRate, 2, 2000, format, otherTone));
+
+	std::shared_ptr<ClipEntry> clipA = cache.acquire(a);
+	std::shared_ptr<ClipEntry> clipB = cache.acquire(b);
+	std::shared_ptr<ClipEntry> clipC = cache.acquire(c);
+	CHECK(test::waitForClip(clipA));
+	CHECK(test::waitForClip(clipB));
+	CHECK(test::waitForClip(clipC));
+
+	CHECK(clipA->getBuffer() == clipB->getBuffer());
+	CHECK(clipA->getContentHash() == clipB->getContentHash());
+	CHECK(clipA->getContentHash() != clipC->getContentHash());
+	CHECK(cache.getStats().shared == 1);
+
+	// The file changes in place. Its old clip keeps the hash of the samples
+	// it plays, the reloaded one gets the hash of the new contents.
+	uint64_t oldHash = clipB->getContentHash();
+	CHECK(test::writeWav(b, sampleRate, 2, 2000, format, otherTone));
+	cache.reload(b);
+
+	std::shared_ptr<ClipEntry> reloaded = waitForReload(cache, clipB);
+	CHECK(reloaded != clipB && test::waitForClip(reloaded));
+	CHECK(clipB->isDropped());
+	CHECK(clipB->getContentHash() == oldHash);
+	CHECK(reloaded->getContentHash() == clipC->getContentHash());
+	CHECK(reloaded->getBuffer() == clipC->getBuffer());
+}
+} // namespace
+
+int main()
+{
+	testShared(test::WavFormat::S16);
+	testShared(test::WavFormat::F32);
+
+	return test::result();
+}
@@ -0,0 +1,144 @@
+// Renders the trigger scripts in golden/ and compares the hash of each render
+// with the one the script expects, so any change to what the mixer, the
+// limiter or the scheduler output shows up. The sounds the scripts play are
+// generated here, from integer math only, so they are the same everywhere.
+//
+// Run with the directory of the scripts. With --update the hashes are
+// printed instead of checked, to copy into the scripts after an intended
+// change to the output.
+
+#include "TestSupport.hpp"
+#include "engine/OfflineRender.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+
+// Triangle wave with a period of the given number of frames.
+float triangle(size_t frame, size_t period)
+{
+	size_t phase = frame % period;
+	size_t half = period / 2;
+	float ramp = phase < half ? (float)phase / (float)half : (float)(period - phase) / (float)half;
+	return ramp * 2.0f - 1.0f;
+}
+
+bool writeSounds(const std::string &dir)
+{
+	bool ok = true;
+
+	ok &= test::writeWav(dir + "/click.wav", sampleRate, 2, 96, test::WavFormat::F32,
+			     [](size_t frame, size_t) { return frame < 48 ? 0.8f : -0.4f; });
+	ok &= test::writeWav(dir + "/tone.wav", sampleRate, 2, 12000, test::WavFormat::S16,
+			     [](size_t frame, size_t channel) { return 0.6f * triangle(frame, 109 + channel * 2); });
+	ok &= test::writeWav(dir + "/bed.wav", sampleRate, 2, sampleRate, test::WavFormat::S16,
+			     [](size_t frame, size_t) { return 0.3f * triangle(frame, 480); });
+	ok &= test::writeWav(dir + "/surround.wav", sampleRate, 6, 9000, test::WavFormat::F32,
+			     [](size_t frame, size_t channel) { return 0.5f * triangle(frame, 60 + channel * 17); });
+
+	return ok;
+}
+
+std::vector<std::string> findScripts(const std::string &dir)
+{
+	std::vector<std::string> names;
+	std::error_code error;
+
+	for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+		if (entry.path().extension() == ".json")
+			names.push_back(entry.path().filename().string());
+	}
+
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+// A render reports its progress and stops, without leaving a file, once
+// it is canceled.
+void testCancel(const std::string &dir)
+{
+	std::vector<OfflineTrigger> triggers(1);
+	triggers[0].path = dir + "/bed.wav";
+
+	OfflineRenderSettings settings;
+	uint64_t lastFrames = 0;
+	uint64_t lastTotal = 0;
+	settings.progress = [&](uint64_t frames, uint64_t totalFrames) {
+		lastFrames = frames;
+		lastTotal = totalFrames;
+		return frames < sampleRate / 4;
+	};
+
+	std::string output = dir + "/canceled.wav";
+	OfflineRenderResult result = renderOffline(triggers, settings, output);
+
+	CHECK(result.canceled);
+	CHECK(!result.success);
+	CHECK(lastFrames >= sampleRate / 4 && lastFrames < sampleRate / 2);
+	CHECK(lastTotal == sampleRate);
+	CHECK(!std::filesystem::exists(output));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <golden dir> [--update]\n", argv[0]);
+		return 2;
+	}
+
+	const std::string goldenDir = argv[1];
+	const bool update = argc > 2 && strcmp(argv[2], "--update") == 0;
+	const std::string workDir = test::tempDir();
+
+	CHECK(writeSounds(workDir));
+	testCancel(workDir);
+
+	std::vector<std::string> scripts = findScripts(goldenDir);
+	CHECK(!scripts.empty());
+
+	for (const std::string &name : scripts) {
+		// Scripts name their sounds relative to themselves, so each one
+		// is copied next to the generated sounds.
+		std::string scriptPath = workDir + "/" + name;
+		std::error_code copyError;
+		std::filesystem::copy_file(goldenDir + "/" + name, scriptPath,
+					   std::filesystem::copy_options::overwrite_existing, copyError);
+		CHECK(!copyError);
+
+		RenderScript script;
+		std::string error;
+
+		if (!loadRenderScript(scriptPath, script, error)) {
+			test::fail(__FILE__, __LINE__, error.c_str());
+			continue;
+		}
+
+		OfflineRenderResult result = renderOffline(script.triggers, script.settings, workDir + "/out.wav");
+
+		if (!result.success) {
+			test::fail(__FILE__, __LINE__, result.error.c_str());
+			continue;
+		}
+
+		std::string hash = formatRenderHash(result.hash);
+
+		if (update) {
+			printf("%s: \"expected_hash\": \"%s\"\n", name.c_str(), hash.c_str());
+			continue;
+		}
+
+		if (hash != script.expectedHash)
+			fprintf(stderr, "%s: rendered %s, expected %s\n", name.c_str(), hash.c_str(),
+				script.expectedHash.c_str());
+
+		CHECK(hash == script.expectedHash);
+	}
+
+	return test::result();
+}
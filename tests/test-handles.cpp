@@ -0,0 +1,272 @@
+// Fires hotkey triggers from several threads while the UI thread keeps
+// deleting sounds, reusing their slots and publishing new boards. A handle
+// is only ever played while its sound is on the board, a clip that was
+// replaced on disk is left to the UI until the board pins the new one, and
+// layer pads and variation groups play without the UI.
+
+#include "TestSupport.hpp"
+#include "fake-obs.hpp"
+#include "engine/BoardSnapshot.hpp"
+#include "engine/SoundboardSource.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+constexpr size_t liveSounds = 8;
+constexpr size_t staleSlots = 64;
+constexpr size_t triggerThreads = 3;
+constexpr int rounds = 2000;
+
+struct Handles {
+	std::atomic<uint32_t> live[liveSounds] = {};
+	// Handles whose sound was deleted before the board that left them out
+	// was published.
+	std::atomic<uint32_t> stale[staleSlots] = {};
+	std::atomic<bool> done = false;
+
+	std::atomic<uint64_t> livePlayed = 0;
+	std::atomic<uint64_t> stalePlayed = 0;
+};
+
+void publish(HandleTable<int> &table, const std::vector<uint32_t> &handles,
+	     const std::vector<std::shared_ptr<ClipEntry>> &clips, obs_source_t *source)
+{
+	auto board = std::make_unique<BoardSnapshot>();
+	board->buses.emplace_back(source);
+
+	for (size_t i = 0; i < handles.size(); i++) {
+		uint32_t index = handleIndex(handles[i]);
+
+		if (!table.contains(handles[i]))
+			continue;
+
+		if (index >= board->clips.size())
+			board->clips.resize(index + 1);
+
+		ClipDescriptor &desc = board->clips[index];
+		desc.handle = handles[i];
+		desc.clip = clips[i % clips.size()];
+		desc.gain = 0.0f;
+		desc.mode = TriggerMode::Overlap;
+	}
+
+	publishBoard(std::move(board));
+}
+
+void triggerLoop(Handles &handles, unsigned seed)
+{
+	std::minstd_rand random(seed);
+
+	for (uint64_t i = 0; !handles.done; i++) {
+		// Mostly stale handles, live ones only now and then so the
+		// command queue keeps up.
+		if (i % 16 == 0) {
+			uint32_t handle = handles.live[random() % liveSounds].load();
+
+			if (triggerBoardClip(handle, 0))
+				handles.livePlayed++;
+		} else {
+			uint32_t handle = handles.stale[random() % staleSlots].load();
+
+			if (handle != invalidHandle && triggerBoardClip(handle, 0))
+				handles.stalePlayed++;
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+}
+
+// A clip replaced by a newer version of its file is not played from the
+// board that pinned the old one, the next board plays the new one.
+void testReloaded(obs_source_t *source, const std::string &path)
+{
+	ClipCache *cache = ClipCache::get();
+	std::shared_ptr<ClipEntry> clip = cache->acquire(path);
+	CHECK(test::waitForClip(clip));
+
+	HandleTable<int> table;
+	std::vector<uint32_t> handles{table.insert(1)};
+	publish(table, handles, {clip}, source);
+	CHECK(triggerBoardClip(handles[0], 0));
+
+	cache->reload(path);
+
+	for (int i = 0; i < 5000 && !clip->isDropped(); i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	CHECK(clip->isDropped());
+	CHECK(!triggerBoardClip(handles[0], 0));
+
+	std::shared_ptr<ClipEntry> reloaded = cache->find(path);
+	CHECK(reloaded && reloaded != clip);
+	publish(table, handles, {reloaded}, source);
+	CHECK(triggerBoardClip(handles[0], 0));
+}
+
+// A variation group picks on the hotkey thread and moves on the rotation it
+// shares with its pad. A group with a clip that cannot play is left to the
+// UI, without picking.
+void testGroup(obs_source_t *source, const std::vector<std::shared_ptr<ClipEntry>> &clips)
+{
+	HandleTable<int> table;
+	uint32_t handle = table.insert(1);
+	auto group = std::make_shared<VariationGroup>();
+
+	auto publishGroup = [&](const std::vector<std::shared_ptr<ClipEntry>> &variations) {
+		auto board = std::make_unique<BoardSnapshot>();
+		board->buses.emplace_back(source);
+		board->groups.push_back(group);
+		board->clips.resize(handleIndex(handle) + 1);
+
+		ClipDescriptor &desc = board->clips[handleIndex(handle)];
+		desc.handle = handle;
+		desc.type = BoardPad::Variations;
+		desc.group = 0;
+
+		for (const std::shared_ptr<ClipEntry> &clip : variations)
+			desc.pads.push_back({clip, 0.0f});
+
+		publishBoard(std::move(board));
+	};
+
+	publishGroup(clips);
+
+	for (int i = 0; i < (int)clips.size() * 2; i++) {
+		CHECK(triggerBoardClip(handle, 0));
+		CHECK(group->getIndex() == i % (int)clips.size());
+	}
+
+	std::vector<std::shared_ptr<ClipEntry>> missing = clips;
+	missing.push_back(nullptr);
+	publishGroup(missing);
+
+	int index = group->getIndex();
+	CHECK(!triggerBoardClip(handle, 0));
+	CHECK(group->getIndex() == index);
+}
+
+// A layer pad plays all of its layers from the board, or none of them if
+// one of its clips cannot play.
+void testLayers(obs_source_t *source, const std::vector<std::shared_ptr<ClipEntry>> &clips)
+{
+	HandleTable<int> table;
+	uint32_t handle = table.insert(1);
+
+	auto publishLayers = [&](const std::vector<std::shared_ptr<ClipEntry>> &layers) {
+		auto board = std::make_unique<BoardSnapshot>();
+		board->buses.emplace_back(source);
+		board->clips.resize(handleIndex(handle) + 1);
+
+		ClipDescriptor &desc = board->clips[handleIndex(handle)];
+		desc.handle = handle;
+		desc.type = BoardPad::Layers;
+
+		for (size_t i = 0; i < layers.size(); i++)
+			desc.pads.push_back({layers[i], 0.0f, (int64_t)i * 10});
+
+		publishBoard(std::move(board));
+	};
+
+	takeBoardTrigger();
+	publishLayers(clips);
+	CHECK(triggerBoardClip(handle, 0));
+	CHECK(takeBoardTrigger() == handle);
+	CHECK(takeBoardTrigger() == invalidHandle);
+
+	std::vector<std::shared_ptr<ClipEntry>> missing = clips;
+	missing.push_back(nullptr);
+	publishLayers(missing);
+	CHECK(!triggerBoardClip(handle, 0));
+	CHECK(takeBoardTrigger() == invalidHandle);
+}
+} // namespace
+
+int main()
+{
+	fake_obs::setAudio(sampleRate, SPEAKERS_STEREO);
+	SoundboardSource::registerSource();
+
+	OBSDataAutoRelease settings = obs_data_create();
+	OBSSourceAutoRelease source = obs_source_create_private(SOUNDBOARD_SOURCE_ID, "handles", settings);
+	CHECK(SoundboardSource::fromSource(source) != nullptr);
+
+	std::vector<std::string> paths;
+	std::vector<std::shared_ptr<ClipEntry>> clips;
+
+	for (size_t i = 0; i < 3; i++) {
+		paths.push_back(test::tempDir() + "/sound" + std::to_string(i) + ".wav");
+		CHECK(test::writeWav(paths.back(), sampleRate, 2, 200 + i * 100, test::WavFormat::S16,
+				     [](size_t, size_t) { return 0.25f; }));
+
+		clips.push_back(ClipCache::get()->acquire(paths.back()));
+		CHECK(test::waitForClip(clips.back()));
+	}
+
+	testReloaded(source, paths[0]);
+	clips[0] = ClipCache::get()->find(paths[0]);
+	testGroup(source, clips);
+	testLayers(source, clips);
+
+	// The table is owned by this thread, like the UI owns the sounds.
+	HandleTable<int> table;
+	Handles shared;
+	std::vector<uint32_t> live;
+
+	for (size_t i = 0; i < liveSounds; i++) {
+		live.push_back(table.insert((int)i));
+		shared.live[i] = live.back();
+	}
+
+	publish(table, live, clips, source);
+
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < triggerThreads; t++)
+		threads.emplace_back(triggerLoop, std::ref(shared), (unsigned)t + 1);
+
+	std::minstd_rand random(42);
+	uint64_t deleted = 0;
+
+	for (int round = 0; round < rounds; round++) {
+		// Deletes a sound, publishes the board without it and only then
+		// hands its handle to the triggers as stale. The new sound usually
+		// reuses the slot with a new generation.
+		size_t victim = random() % liveSounds;
+		uint32_t old = live[victim];
+
+		table.remove(old);
+		live[victim] = table.insert(round);
+		publish(table, live, clips, source);
+
+		shared.live[victim] = live[victim];
+		shared.stale[deleted++ % staleSlots] = old;
+
+		if (round % 8 == 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+
+	shared.done = true;
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	CHECK(shared.stalePlayed == 0);
+	CHECK(shared.livePlayed > 0);
+
+	fprintf(stderr, "%llu sounds deleted, %llu live triggers played, %llu stale triggers played\n",
+		(unsigned long long)deleted, (unsigned long long)shared.livePlayed.load(),
+		(unsigned long long)shared.stalePlayed.load());
+
+	publishBoard(nullptr);
+	clips.clear();
+	source = nullptr;
+	ClipCache::shutdown();
+
+	return test::result();
+}
@@ -0,0 +1,125 @@
+// Checks that the limiter delays quiet audio by exactly its latency and keeps
+// loud audio under the ceiling, between samples as well as on them.
+
+#include "TestSupport.hpp"
+#include "engine/Limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+constexpr double pi = 3.14159265358979323846;
+
+// Process the signal in uneven blocks, the way a source gets its ticks.
+std::vector<std::vector<float>> run(Limiter &limiter, std::vector<std::vector<float>> signal)
+{
+	const size_t frames = signal[0].size();
+	const size_t blocks[] = {1024, 480, 7, 300};
+	size_t next = 0;
+
+	for (size_t done = 0; done < frames; next++) {
+		size_t count = std::min(blocks[next % std::size(blocks)], frames - done);
+		float *planes[8] = {};
+
+		for (size_t c = 0; c < signal.size(); c++)
+			planes[c] = signal[c].data() + done;
+
+		limiter.process(planes, count);
+		done += count;
+	}
+
+	return signal;
+}
+
+// Highest magnitude at 4x the sample rate, with a longer filter than the
+// limiter's own.
+float truePeak(const std::vector<float> &samples)
+{
+	const int halfWidth = 16;
+	float peak = 0.0f;
+
+	for (size_t i = halfWidth; i + halfWidth < samples.size(); i++) {
+		for (int phase = 0; phase < 4; phase++) {
+			double x = (double)phase / 4.0;
+			double sum = 0.0;
+
+			for (int k = -halfWidth + 1; k <= halfWidth; k++) {
+				double t = x - k;
+				double window = 0.5 * (1.0 + std::cos(pi * t / halfWidth));
+				double sinc = t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+				sum += samples[i + k] * sinc * window;
+			}
+
+			peak = std::max(peak, (float)std::fabs(sum));
+		}
+	}
+
+	return peak;
+}
+
+void testLatency()
+{
+	Limiter limiter(sampleRate, 2);
+	std::vector<std::vector<float>> signal(2, std::vector<float>(4096, 0.0f));
+	signal[0][100] = 0.5f;
+	signal[1][2000] = -0.5f;
+
+	std::vector<std::vector<float>> out = run(limiter, signal);
+	size_t latency = limiter.getLatency();
+
+	// Below the ceiling the audio comes out unchanged, just later.
+	for (size_t c = 0; c < 2; c++) {
+		for (size_t i = 0; i + latency < 4096; i++)
+			CHECK(out[c][i + latency] == signal[c][i]);
+	}
+}
+
+void testCeiling(size_t channels)
+{
+	const float ceiling = std::pow(10.0f, -1.0f / 20.0f);
+	const size_t frames = sampleRate;
+
+	Limiter limiter(sampleRate, channels);
+	std::vector<std::vector<float>> signal(channels, std::vector<float>(frames));
+
+	// A sine close to a quarter of the rate peaks between samples, the bursts
+	// make the gain move all the time. Their edges are smooth, a hard step
+	// rings further than any short filter can see.
+	for (size_t c = 0; c < channels; c++) {
+		for (size_t i = 0; i < frames; i++) {
+			size_t pos = i % 7200;
+			double edge = pos < 2400 ? std::min(1.0, (double)std::min(pos, 2400 - pos) / 96.0) : 0.0;
+			double level = 0.5 + 3.5 * edge;
+			signal[c][i] = (float)(level * std::sin(2.0 * pi * 11987.0 * i / sampleRate + 0.7 * c));
+		}
+	}
+
+	std::vector<std::vector<float>> out = run(limiter, signal);
+
+	for (size_t c = 0; c < channels; c++) {
+		float samplePeak = 0.0f;
+
+		for (float sample : out[c])
+			samplePeak = std::max(samplePeak, std::fabs(sample));
+
+		float peak = truePeak(out[c]);
+
+		if (peak > ceiling * 1.01f)
+			fprintf(stderr, "channel %zu: true peak %f over ceiling %f\n", c, peak, ceiling);
+
+		CHECK(samplePeak <= ceiling);
+		CHECK(peak <= ceiling * 1.01f);
+	}
+}
+} // namespace
+
+int main()
+{
+	testLatency();
+	testCeiling(2);
+	testCeiling(6);
+
+	return test::result();
+}
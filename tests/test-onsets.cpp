@@ -0,0 +1,164 @@
+// Renders triggers offline and checks that every sound starts on the exact
+// frame it was scheduled for, whatever the block size, and that quantized
+// sounds snap to the tempo grid.
+
+#include "TestSupport.hpp"
+#include "engine/Limiter.hpp"
+#include "engine/OfflineRender.hpp"
+
+#include <util/platform.h>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+constexpr size_t channels = 2;
+constexpr size_t wavHeaderBytes = 44;
+
+// The first channel of a rendered file.
+std::vector<float> readRender(const std::string &path)
+{
+	std::vector<float> samples;
+	FILE *file = os_fopen(path.c_str(), "rb");
+
+	if (!file)
+		return samples;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, wavHeaderBytes, SEEK_SET);
+
+	std::vector<float> interleaved((size_t)(size - (long)wavHeaderBytes) / sizeof(float));
+	size_t read = fread(interleaved.data(), sizeof(float), interleaved.size(), file);
+	fclose(file);
+
+	for (size_t i = 0; i + channels <= read; i += channels)
+		samples.push_back(interleaved[i]);
+
+	return samples;
+}
+
+// Frames where the signal rises over the threshold.
+std::vector<size_t> findOnsets(const std::vector<float> &samples, float threshold)
+{
+	std::vector<size_t> onsets;
+
+	for (size_t i = 0; i < samples.size(); i++) {
+		bool above = std::fabs(samples[i]) > threshold;
+		bool wasAbove = i > 0 && std::fabs(samples[i - 1]) > threshold;
+
+		if (above && !wasAbove)
+			onsets.push_back(i);
+	}
+
+	return onsets;
+}
+
+OfflineTrigger makeTrigger(const std::string &path, uint64_t timeMs, bool quantize = false)
+{
+	OfflineTrigger trigger;
+	trigger.path = path;
+	trigger.timeMs = timeMs;
+	trigger.options.mode = TriggerMode::Overlap;
+	trigger.options.quantize = quantize;
+	return trigger;
+}
+
+void testScheduledOnsets(const std::string &click, size_t latency)
+{
+	const uint64_t times[] = {0, 5, 21, 333, 1000, 1002};
+
+	// Block sizes that put the onsets at different offsets into a block.
+	for (size_t blockFrames : {1024, 480, 441, 64}) {
+		std::vector<OfflineTrigger> triggers;
+
+		for (uint64_t timeMs : times)
+			triggers.push_back(makeTrigger(click, timeMs));
+
+		OfflineRenderSettings settings;
+		settings.sampleRate = sampleRate;
+		settings.channels = channels;
+		settings.blockFrames = blockFrames;
+		settings.durationMs = 1100;
+
+		std::string output = test::tempDir() + "/scheduled.wav";
+		OfflineRenderResult result = renderOffline(triggers, settings, output);
+		CHECK(result.success);
+
+		std::vector<size_t> onsets = findOnsets(readRender(output), 0.1f);
+		CHECK(onsets.size() == std::size(times));
+
+		for (size_t i = 0; i < onsets.size() && i < std::size(times); i++) {
+			size_t expected = (size_t)(times[i] * sampleRate / 1000) + latency;
+
+			if (onsets[i] != expected)
+				fprintf(stderr, "block %zu: onset %zu at %zu, expected %zu\n", blockFrames, i,
+					onsets[i], expected);
+
+			CHECK(onsets[i] == expected);
+		}
+	}
+}
+
+void testQuantizedOnsets(const std::string &bed, const std::string &click, size_t latency)
+{
+	OfflineRenderSettings settings;
+	settings.sampleRate = sampleRate;
+	settings.channels = channels;
+	settings.durationMs = 1000;
+	settings.tempo = 120.0;
+	settings.gridBeats = 0.5;
+
+	const size_t gridFrames = sampleRate / 4;
+
+	// The first quantized sound on a silent board starts the grid, the ones
+	// after it wait for the next point of the grid.
+	std::vector<OfflineTrigger> triggers = {
+		makeTrigger(bed, 100, true),
+		makeTrigger(click, 130, true),
+		makeTrigger(click, 400, true),
+		makeTrigger(click, 500, false),
+	};
+
+	std::string output = test::tempDir() + "/quantized.wav";
+	OfflineRenderResult result = renderOffline(triggers, settings, output);
+	CHECK(result.success);
+
+	std::vector<float> samples = readRender(output);
+	std::vector<size_t> bedOnsets = findOnsets(samples, 0.1f);
+	std::vector<size_t> clickOnsets = findOnsets(samples, 0.5f);
+
+	const size_t origin = 100 * sampleRate / 1000;
+
+	CHECK(!bedOnsets.empty() && bedOnsets.front() == origin + latency);
+	CHECK(clickOnsets.size() == 3);
+
+	if (clickOnsets.size() == 3) {
+		CHECK(clickOnsets[0] == origin + gridFrames + latency);
+		CHECK(clickOnsets[1] == 500 * sampleRate / 1000 + latency);
+		CHECK(clickOnsets[2] == origin + 2 * gridFrames + latency);
+	}
+}
+} // namespace
+
+int main()
+{
+	// Short enough that sounds a few milliseconds apart do not overlap.
+	std::string click = test::tempDir() + "/click.wav";
+	CHECK(test::writeWav(click, sampleRate, channels, 64, test::WavFormat::F32,
+			     [](size_t, size_t) { return 0.5f; }));
+
+	// A quiet bed that keeps the tempo grid running.
+	std::string bed = test::tempDir() + "/bed.wav";
+	CHECK(test::writeWav(bed, sampleRate, channels, sampleRate, test::WavFormat::S16,
+			     [](size_t, size_t) { return 0.25f; }));
+
+	// Output is delayed by the master limiter's lookahead.
+	size_t latency = Limiter(sampleRate, channels).getLatency();
+
+	testScheduledOnsets(click, latency);
+	testQuantizedOnsets(bed, click, latency);
+
+	return test::result();
+}
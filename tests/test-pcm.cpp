@@ -0,0 +1,228 @@
+// Checks that uncompressed files are mapped and survive the file being
+// removed or truncated, that every format converts to the samples that were
+// written, and that interleaved samples mix the same for any channel count as
+// a plain loop would.
+
+#include "TestSupport.hpp"
+#include "engine/MixKernels.hpp"
+#include "engine/PcmReader.hpp"
+
+#include <media-io/audio-io.h>
+#include <util/platform.h>
+
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+
+float sampleAt(size_t frame, size_t channel)
+{
+	return (float)((frame * 7 + channel * 13) % 64) / 64.0f - 0.5f;
+}
+
+void testMixInterleaved(size_t channels, size_t count)
+{
+	const float gain = 0.75f;
+	const size_t offset = 3;
+
+	std::vector<float> src(channels * count);
+
+	for (size_t i = 0; i < count; i++) {
+		for (size_t c = 0; c < channels; c++)
+			src[i * channels + c] = sampleAt(i, c);
+	}
+
+	std::vector<float> samples(channels * (count + offset), 0.25f);
+	float *planes[MAX_AUDIO_CHANNELS] = {};
+
+	for (size_t c = 0; c < channels; c++)
+		planes[c] = samples.data() + c * (count + offset);
+
+	MeterSums meter;
+	mixInterleaved(planes, offset, src.data(), channels, count, gain, meter);
+
+	float peak = 0.0f;
+
+	for (size_t c = 0; c < channels; c++) {
+		for (size_t i = 0; i < offset; i++)
+			CHECK(planes[c][i] == 0.25f);
+
+		for (size_t i = 0; i < count; i++) {
+			float value = sampleAt(i, c) * gain;
+			peak = std::max(peak, std::fabs(value));
+			CHECK(std::fabs(planes[c][offset + i] - (0.25f + value)) < 1e-6f);
+		}
+	}
+
+	CHECK(meter.samples == channels * count);
+	CHECK(meter.peak == peak);
+}
+
+void testRead(test::WavFormat format)
+{
+	std::string path = test::tempDir() + "/read.wav";
+	CHECK(test::writeWav(path, sampleRate, 2, 1001, format, sampleAt));
+
+	std::shared_ptr<AudioBuffer> buffer = readPcmFile(path, sampleRate, 2);
+	CHECK(buffer != nullptr);
+
+	if (!buffer)
+		return;
+
+	// The mapping outlives the file.
+	CHECK(os_unlink(path.c_str()) == 0);
+	CHECK(buffer->isPcm());
+	CHECK(buffer->frames == 1001);
+	CHECK(buffer->channels() == 2);
+
+	std::vector<float> converted(buffer->frames * 2);
+	convertPcm(converted.data(), *buffer, 0, buffer->frames);
+
+	for (size_t i = 0; i < buffer->frames; i++) {
+		for (size_t c = 0; c < 2; c++)
+			CHECK(std::fabs(converted[i * 2 + c] - sampleAt(i, c)) < 1e-4f);
+	}
+
+	// Short blocks at the end of the buffer take the scalar tail of the
+	// kernels and must not read past the samples.
+	for (size_t count = 1; count <= 5; count++) {
+		size_t offset = buffer->frames - count;
+		convertPcm(converted.data(), *buffer, offset, count);
+
+		for (size_t i = 0; i < count * 2; i++)
+			CHECK(std::fabs(converted[i] - sampleAt(offset + i / 2, i % 2)) < 1e-4f);
+	}
+
+	// Anything that would have to be converted is left to the decoder.
+	CHECK(test::writeWav(path, sampleRate, 1, 100, format, sampleAt));
+	CHECK(readPcmFile(path, sampleRate, 2) == nullptr);
+	CHECK(readPcmFile(path, 44100, 1) == nullptr);
+}
+
+// A file cut short after its header was written plays what is there.
+void testTruncated()
+{
+	std::string path = test::tempDir() + "/truncated.wav";
+	CHECK(test::writeWav(path, sampleRate, 2, 1000, test::WavFormat::S16, sampleAt));
+
+	FILE *file = fopen(path.c_str(), "rb");
+	std::vector<char> data(44 + 4 * 1000);
+	CHECK(file && fread(data.data(), 1, data.size(), file) == data.size());
+
+	if (file)
+		fclose(file);
+
+	file = fopen(path.c_str(), "wb");
+	CHECK(file && fwrite(data.data(), 1, 44 + 4 * 250 + 3, file) == 44 + 4 * 250 + 3);
+
+	if (file)
+		fclose(file);
+
+	std::shared_ptr<AudioBuffer> buffer = readPcmFile(path, sampleRate, 2);
+	CHECK(buffer && buffer->frames == 250);
+}
+
+// A file truncated in place while it is mapped plays silence where its
+// samples were cut off, instead of crashing the reader.
+void testTruncatedWhileMapped()
+{
+	std::string path = test::tempDir() + "/mapped.wav";
+	CHECK(test::writeWav(path, sampleRate, 2, sampleRate, test::WavFormat::S16, sampleAt));
+
+	std::shared_ptr<AudioBuffer> buffer = readPcmFile(path, sampleRate, 2);
+	CHECK(buffer && buffer->frames == sampleRate);
+
+	if (!buffer)
+		return;
+
+	std::error_code error;
+	std::filesystem::resize_file(path, 44 + 4 * 250, error);
+	CHECK(!error);
+
+	std::vector<float> converted(buffer->frames * 2);
+	convertPcm(converted.data(), *buffer, 0, buffer->frames);
+
+	// Where nothing is mapped the samples were copied and stay as they were.
+	bool mapped = buffer->pcm->isMapped();
+
+	for (size_t i = 0; i < buffer->frames; i++) {
+		for (size_t c = 0; c < 2; c++) {
+			float expected = i < 250 || !mapped ? sampleAt(i, c) : 0.0f;
+			CHECK(std::fabs(converted[i * 2 + c] - expected) < 1e-4f);
+		}
+	}
+}
+
+void putBE(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+	for (int i = bytes - 1; i >= 0; i--)
+		out.push_back((uint8_t)(value >> (i * 8)));
+}
+
+// 24-bit AIFF is the big endian format the kernels swap.
+void testAiff24()
+{
+	const size_t frames = 1001;
+	std::vector<uint8_t> out;
+
+	out.insert(out.end(), {'F', 'O', 'R', 'M'});
+	putBE(out, 4 + 26 + 16 + frames * 6, 4);
+	out.insert(out.end(), {'A', 'I', 'F', 'F', 'C', 'O', 'M', 'M'});
+	putBE(out, 18, 4);
+	putBE(out, 2, 2);
+	putBE(out, frames, 4);
+	putBE(out, 24, 2);
+	// 48000 as an 80-bit extended float.
+	putBE(out, 16383 + 15, 2);
+	putBE(out, (uint64_t)sampleRate << 48, 8);
+	out.insert(out.end(), {'S', 'S', 'N', 'D'});
+	putBE(out, 8 + frames * 6, 4);
+	putBE(out, 0, 8);
+
+	for (size_t i = 0; i < frames; i++) {
+		for (size_t c = 0; c < 2; c++)
+			putBE(out, (uint32_t)(int32_t)std::lrint(sampleAt(i, c) * 8388607.0f), 3);
+	}
+
+	std::string path = test::tempDir() + "/read.aiff";
+	FILE *file = fopen(path.c_str(), "wb");
+	CHECK(file && fwrite(out.data(), 1, out.size(), file) == out.size());
+
+	if (file)
+		fclose(file);
+
+	std::shared_ptr<AudioBuffer> buffer = readPcmFile(path, sampleRate, 2);
+	CHECK(buffer && buffer->pcmFormat == PcmFormat::S24BE && buffer->frames == frames);
+
+	if (!buffer)
+		return;
+
+	std::vector<float> converted(frames * 2);
+	convertPcm(converted.data(), *buffer, 0, frames);
+
+	for (size_t i = 0; i < frames; i++) {
+		for (size_t c = 0; c < 2; c++)
+			CHECK(std::fabs(converted[i * 2 + c] - sampleAt(i, c)) < 1e-6f);
+	}
+}
+} // namespace
+
+int main()
+{
+	for (size_t channels = 1; channels <= 8; channels++) {
+		for (size_t count : {0, 1, 3, 4, 7, 480})
+			testMixInterleaved(channels, count);
+	}
+
+	testRead(test::WavFormat::S16);
+	testRead(test::WavFormat::S24);
+	testRead(test::WavFormat::F32);
+	testTruncated();
+	testTruncatedWhileMapped();
+	testAiff24();
+
+	return test::result();
+}
@@ -0,0 +1,229 @@
+// Fires thousands of commands at a running soundboard source from several
+// threads at once, and checks that every one of them reaches the render
+// thread and that the render callback never allocates or blocks. Built with
+// ENABLE_RT_CHECKS, which the test build turns on by default.
+
+#include "TestSupport.hpp"
+#include "fake-obs.hpp"
+#include "engine/RealtimeCheck.hpp"
+#include "engine/SoundboardSource.hpp"
+
+#include <util/platform.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint32_t sampleRate = 48000;
+constexpr size_t producers = 4;
+constexpr size_t commandsPerProducer = 1500;
+
+const char *violationText = "Real-time violation";
+
+struct Clips {
+	std::shared_ptr<ClipEntry> s16;
+	std::shared_ptr<ClipEntry> f32;
+	std::shared_ptr<ClipEntry> blip;
+};
+
+EngineCommand makeCommand(const Clips &clips, size_t producer, size_t i)
+{
+	EngineCommand cmd;
+	cmd.options.tag = (uint32_t)(producer * commandsPerProducer + i + 1);
+	cmd.options.gain = 0.05f;
+
+	// Mostly overlapping plays, with every other kind of command mixed in.
+	switch (i % 10) {
+	case 0:
+		cmd.type = EngineCommand::Type::PlayLayers;
+		cmd.layers[0].clip = clips.s16;
+		cmd.layers[1].clip = clips.blip;
+		cmd.layers[1].offset = 100;
+		cmd.layerCount = 2;
+		break;
+	case 1:
+		cmd.type = EngineCommand::Type::Enqueue;
+		cmd.clip = clips.f32;
+		cmd.autoStart = true;
+		break;
+	case 2:
+		cmd.type = EngineCommand::Type::Play;
+		cmd.clip = clips.blip;
+		cmd.options.quantize = true;
+		break;
+	case 3:
+		cmd.type = i % 200 == 3 ? EngineCommand::Type::ClearQueue : EngineCommand::Type::Next;
+		break;
+	case 4:
+		cmd.type = i % 100 == 4 ? EngineCommand::Type::Stop : EngineCommand::Type::Play;
+		cmd.clip = clips.f32;
+		cmd.options.loop = true;
+		break;
+	case 5:
+		cmd.type = EngineCommand::Type::SetTempo;
+		cmd.tempo = 90.0 + (double)(i % 60);
+		cmd.gridBeats = 0.25;
+		break;
+	default:
+		cmd.type = EngineCommand::Type::Play;
+		cmd.clip = i % 2 ? clips.s16 : clips.f32;
+		cmd.options.mode = TriggerMode::Overlap;
+		break;
+	}
+
+	return cmd;
+}
+
+#ifdef ENABLE_RT_CHECKS
+// Runs the call in a real-time scope and returns whether it was reported
+// as the given kind of violation.
+bool isReported(const char *what, const std::function<void()> &call)
+{
+	std::string text = std::string(violationText) + " in render callback: " + what;
+	size_t before = fake_obs::getLogCount(text.c_str());
+	fake_obs::setLogLevel(LOG_ERROR);
+
+	{
+		RealtimeScope scope;
+		call();
+	}
+
+	logRealtimeViolations();
+	fake_obs::setLogLevel(LOG_WARNING);
+	return fake_obs::getLogCount(text.c_str()) > before;
+}
+#endif
+
+// Checks that every kind of violation is seen at all, so a passing run
+// means something.
+void testDetection()
+{
+#ifdef ENABLE_RT_CHECKS
+	// Called directly, a new expression could be optimized away.
+	CHECK(isReported("heap allocation", []() { operator delete(operator new(16)); }));
+	CHECK(isReported("log", []() { blog(LOG_DEBUG, "Logged from the render callback"); }));
+	CHECK(isReported("sleep", []() { os_sleep_ms(0); }));
+
+#ifdef __linux__
+	// Caught in the C library, without being marked.
+	std::mutex mutex;
+	CHECK(isReported("mutex lock", [&]() { std::lock_guard<std::mutex> lock(mutex); }));
+	CHECK(isReported("sleep", []() { std::this_thread::sleep_for(std::chrono::microseconds(1)); }));
+
+	int fd = open("/dev/null", O_WRONLY);
+	CHECK(fd >= 0);
+	CHECK(isReported("write", [fd]() { CHECK(write(fd, "x", 1) == 1); }));
+	close(fd);
+#endif
+#else
+	fprintf(stderr, "ENABLE_RT_CHECKS is off, only the command delivery is checked\n");
+#endif
+}
+
+bool waitForCount(const Histogram &histogram, uint64_t count, int timeoutMs)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	while (histogram.getCount() < count) {
+		if (std::chrono::steady_clock::now() > deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
+} // namespace
+
+int main()
+{
+	testDetection();
+
+	fake_obs::setAudio(sampleRate, SPEAKERS_STEREO);
+	SoundboardSource::registerSource();
+
+	OBSDataAutoRelease settings = obs_data_create();
+	OBSSourceAutoRelease source = obs_source_create_private(SOUNDBOARD_SOURCE_ID, "stress", settings);
+	SoundboardSource *sbs = SoundboardSource::fromSource(source);
+	CHECK(sbs != nullptr);
+
+	if (!sbs)
+		return test::result();
+
+	// Short clips, so voices end and are reused while the test runs.
+	std::string s16 = test::tempDir() + "/s16.wav";
+	std::string f32 = test::tempDir() + "/f32.wav";
+	std::string blipPath = test::tempDir() + "/blip.wav";
+	CHECK(test::writeWav(s16, sampleRate, 2, 2400, test::WavFormat::S16, [](size_t, size_t) { return 0.25f; }));
+	CHECK(test::writeWav(f32, sampleRate, 2, 4800, test::WavFormat::F32, [](size_t, size_t) { return 0.25f; }));
+	CHECK(test::writeWav(blipPath, sampleRate, 2, 300, test::WavFormat::S16,
+			     [](size_t, size_t) { return 0.25f; }));
+
+	Clips clips;
+	clips.s16 = ClipCache::get()->acquire(s16);
+	clips.f32 = ClipCache::get()->acquire(f32);
+	clips.blip = ClipCache::get()->acquire(blipPath);
+	CHECK(test::waitForClip(clips.s16));
+	CHECK(test::waitForClip(clips.f32));
+	CHECK(test::waitForClip(clips.blip));
+
+	PlaybackEngine &engine = sbs->getEngine();
+	const uint64_t dequeuedBefore = engine.getDequeueLatency().getCount();
+	const size_t violationsBefore = fake_obs::getLogCount(violationText);
+
+	std::atomic<uint64_t> accepted = 0;
+	std::atomic<uint64_t> rejected = 0;
+	std::vector<std::thread> threads;
+
+	for (size_t p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			for (size_t i = 0; i < commandsPerProducer; i++) {
+				EngineCommand cmd = makeCommand(clips, p, i);
+				cmd.options.triggerTime = os_gettime_ns();
+
+				if (engine.submit(std::move(cmd)))
+					accepted++;
+				else
+					rejected++;
+
+				// Bursts of commands, then a pause that lets a block or
+				// two render.
+				if (i % 25 == 24)
+					std::this_thread::sleep_for(std::chrono::microseconds(10000 + p * 1000));
+			}
+		});
+	}
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// Every accepted command is taken off the queue exactly once.
+	CHECK(waitForCount(engine.getDequeueLatency(), dequeuedBefore + accepted, 2000));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK(engine.getDequeueLatency().getCount() == dequeuedBefore + accepted);
+	CHECK(accepted + rejected == producers * commandsPerProducer);
+	CHECK(accepted > 0);
+
+	size_t violations = fake_obs::getLogCount(violationText) - violationsBefore;
+
+	if (violations)
+		fprintf(stderr, "%zu real-time violations in the render callback\n", violations);
+
+	CHECK(violations == 0);
+
+	fprintf(stderr, "%llu commands delivered, %llu rejected by a full queue\n", (unsigned long long)accepted.load(),
+		(unsigned long long)rejected.load());
+
+	return test::result();
+}